@@ -0,0 +1,325 @@
+/**
+ * @file bench_suite.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Host microbenchmarks of the display and timing hot paths
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <time.h>
+#include <getopt.h>
+#include "app.h"
+#include "hal_host.h"
+
+// Each benchmark runs batches until it has taken at least this long
+#define BENCH_MIN_NS 200000000
+#define BENCH_FIRST_BATCH 64
+#define BENCH_WARMUP_OPS 1000
+
+/**
+ * @brief One benchmark: a setup run before timing and the operation timed
+ *
+ */
+typedef struct
+{
+    const char *pszName;      // Name reported
+    void (*pfnSetup)(void);   // Puts the firmware in the state the operation needs
+    void (*pfnOp)(int64_t n); // One operation, n counts up from 0
+} BENCH_CASE;
+
+/**
+ * @brief What a benchmark measured
+ *
+ */
+typedef struct
+{
+    uint64_t nOps;    // Operations timed
+    int64_t tTotal;   // Nanoseconds they took
+    uint64_t nAllocs; // Heap allocations they made
+    uint64_t nBytes;  // Bytes they allocated
+} BENCH_RESULT;
+
+static volatile uint32_t nSink;
+static uint64_t nAllocCount;
+static uint64_t nAllocBytes;
+
+#if BENCH_COUNT_ALLOCS
+// The firmware is linked with --wrap for the allocator, so every call it
+// makes lands here first
+extern void *__real_malloc(size_t nSize);
+extern void *__real_calloc(size_t nCount, size_t nSize);
+extern void *__real_realloc(void *pData, size_t nSize);
+
+void *__wrap_malloc(size_t nSize)
+{
+    nAllocCount++;
+    nAllocBytes += nSize;
+    return __real_malloc(nSize);
+}
+
+void *__wrap_calloc(size_t nCount, size_t nSize)
+{
+    nAllocCount++;
+    nAllocBytes += nCount * nSize;
+    return __real_calloc(nCount, nSize);
+}
+
+void *__wrap_realloc(void *pData, size_t nSize)
+{
+    nAllocCount++;
+    nAllocBytes += nSize;
+    return __real_realloc(pData, nSize);
+}
+#endif
+
+static int64_t Now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/**
+ * @brief Bring the firmware up as APP_Main does, without the DFPlayer and
+ * without any logging
+ *
+ */
+static void Setup_App(void)
+{
+    HOST_Reset();
+    HOST_Settings_Erase();
+    HOST_Set_Log_Level('N');
+    HOST_Set_Run_Time(HAL_NO_DEADLINE);
+    Display_Initialize();
+    Schedule_Initialize();
+    APP_Initialize();
+}
+/**
+ * @brief Put the firmware in a running event, started at time 0
+ *
+ */
+static void Setup_Running(void)
+{
+    Setup_App();
+    Switch_To_State(APP_STATE_RUNNING);
+    APP_Tasks();
+}
+
+static void Op_Get_Segment_Mask(int64_t n)
+{
+    nSink += Get_Segment_Mask((char)n);
+}
+
+static void Op_getRGB(int64_t n)
+{
+    appData.stateApp = (APP_STATES)(n % (APP_STATE_CONFIG + 1));
+    nSink += getRGB();
+}
+/**
+ * @brief Show a new value and compose the first frame of its fade onto the
+ * mock strip, as the render task would straight after
+ *
+ * @param n Operation number, picks the digits so every scene is new
+ */
+static void Op_Timer_Display(int64_t n)
+{
+    Display_Right_Digits(Get_Digit_Mask((int)(n / 10) % 10), Get_Digit_Mask((int)n % 10));
+    Timer_Display();
+    Render_Service(HAL_Get_Time());
+}
+/**
+ * @brief Advance to the next half second slot and scroll to it
+ *
+ * @param n Operation number
+ */
+static void Op_ScrollCodebusters(int64_t n)
+{
+    appData.nElapsedTenths = (int32_t)(n * 5);
+    ScrollCodebusters();
+}
+/**
+ * @brief Advance a second and show the minutes remaining
+ *
+ * @param n Operation number
+ */
+static void Op_showCountdownTime(int64_t n)
+{
+    appData.nElapsedTenths = (int32_t)((n % appData.pTimeline->nLengthSeconds) * 10);
+    showCountdownTime();
+}
+/**
+ * @brief Advance a tenth and show the seconds remaining
+ *
+ * @param n Operation number
+ */
+static void Op_showSecondsCountdownTime(int64_t n)
+{
+    appData.nElapsedTenths = (int32_t)(n % (appData.pTimeline->nLengthSeconds * 10));
+    showSecondsCountdownTime();
+}
+/**
+ * @brief One pass of the APP_Main loop: sleep to the deadline, running
+ * whatever the other tasks have due on the way, then run the app.  A new
+ * event is started whenever one finishes.
+ *
+ * @param n Operation number
+ */
+static void Op_APP_Main_Loop(int64_t n)
+{
+    static int64_t tDeadline;
+
+    if (n == 0)
+    {
+        tDeadline = HAL_Get_Time();
+    }
+    if (appData.stateApp != APP_STATE_RUNNING)
+    {
+        Switch_To_State(APP_STATE_RUNNING);
+        tDeadline = HAL_Get_Time();
+    }
+    HAL_Wait_Until(tDeadline);
+    appData.nWakeups++;
+    tDeadline = APP_Tasks();
+}
+
+static const BENCH_CASE aCases[] = {
+    {"Get_Segment_Mask", &Setup_App, &Op_Get_Segment_Mask},
+    {"getRGB", &Setup_App, &Op_getRGB},
+    {"Timer_Display", &Setup_Running, &Op_Timer_Display},
+    {"ScrollCodebusters", &Setup_App, &Op_ScrollCodebusters},
+    {"showCountdownTime", &Setup_Running, &Op_showCountdownTime},
+    {"showSecondsCountdownTime", &Setup_Running, &Op_showSecondsCountdownTime},
+    {"APP_Main_loop", &Setup_Running, &Op_APP_Main_Loop},
+};
+/**
+ * @brief Time one benchmark, doubling the batch until it runs long enough
+ * to trust the clock
+ *
+ * @param pCase Benchmark to run
+ * @param pResult Where to put what was measured
+ */
+static void Bench_Run(const BENCH_CASE *pCase, BENCH_RESULT *pResult)
+{
+    int64_t n = 0;
+    uint64_t nBatch = BENCH_FIRST_BATCH;
+
+    pCase->pfnSetup();
+    for (; n < BENCH_WARMUP_OPS; n++)
+    {
+        pCase->pfnOp(n);
+    }
+    memset(pResult, 0, sizeof(*pResult));
+    while (pResult->tTotal < BENCH_MIN_NS)
+    {
+        uint64_t nAllocsBefore = nAllocCount;
+        uint64_t nBytesBefore = nAllocBytes;
+        int64_t tStart = Now_ns();
+
+        for (uint64_t nOp = 0; nOp < nBatch; nOp++, n++)
+        {
+            pCase->pfnOp(n);
+        }
+        pResult->tTotal += Now_ns() - tStart;
+        pResult->nOps += nBatch;
+        pResult->nAllocs += nAllocCount - nAllocsBefore;
+        pResult->nBytes += nAllocBytes - nBytesBefore;
+        nBatch *= 2;
+    }
+}
+
+static void Usage(const char *pszName)
+{
+    fprintf(stderr,
+            "usage: %s [-j] [-f name]\n"
+            "  -j  print the results as JSON\n"
+            "  -f  only run the benchmarks whose name contains name\n",
+            pszName);
+}
+
+int main(int argc, char **argv)
+{
+    BENCH_RESULT aResults[sizeof(aCases) / sizeof(aCases[0])];
+    const char *pszFilter = NULL;
+    bool bJSON = false;
+    bool bFirst = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "jf:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'j':
+            bJSON = true;
+            break;
+        case 'f':
+            pszFilter = optarg;
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (bJSON)
+    {
+        printf("{\n  \"unit\": \"ns/op\",\n  \"allocations_counted\": %s,\n  \"benchmarks\": [",
+               BENCH_COUNT_ALLOCS ? "true" : "false");
+    }
+    for (size_t nCase = 0; nCase < sizeof(aCases) / sizeof(aCases[0]); nCase++)
+    {
+        const BENCH_CASE *pCase = &aCases[nCase];
+        BENCH_RESULT *pResult = &aResults[nCase];
+        double dNsPerOp;
+        double dAllocsPerOp;
+
+        if (pszFilter != NULL && strstr(pCase->pszName, pszFilter) == NULL)
+        {
+            continue;
+        }
+        Bench_Run(pCase, pResult);
+        dNsPerOp = (double)pResult->tTotal / pResult->nOps;
+        dAllocsPerOp = (double)pResult->nAllocs / pResult->nOps;
+        if (bJSON)
+        {
+            printf("%s\n    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"ops\": %llu, "
+                   "\"allocs_per_op\": %.4f, \"bytes_per_op\": %.2f}",
+                   bFirst ? "" : ",", pCase->pszName, dNsPerOp, (unsigned long long)pResult->nOps, dAllocsPerOp,
+                   (double)pResult->nBytes / pResult->nOps);
+        }
+        else
+        {
+            printf("%-26s %10.2f ns/op %10llu ops %8.4f allocs/op %8.2f bytes/op\n", pCase->pszName, dNsPerOp,
+                   (unsigned long long)pResult->nOps, dAllocsPerOp, (double)pResult->nBytes / pResult->nOps);
+        }
+        bFirst = false;
+    }
+    if (bJSON)
+    {
+        printf("\n  ]\n}\n");
+    }
+    return 0;
+}
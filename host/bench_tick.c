@@ -0,0 +1,171 @@
+/**
+ * @file bench_tick.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Host benchmark of the per-tick timekeeping cost
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <time.h>
+#include <math.h>
+#include "app.h"
+#include "hal_host.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#endif
+
+#define BENCH_TICKS 2000000
+// Length of the event the ticks are spread over, as in the built in schedule
+#define EVENT_LENGTH (50 * 60)
+
+// Interval of the 24 Hz polling tick the integer math replaced
+#define BENCH_TICK_MS 41
+
+/**
+ * @brief Values the timekeeping produces for one tick, kept so the
+ * compiler can not throw the work away
+ */
+typedef struct
+{
+    int nChanged;
+    int nLast;
+} BENCH_SINK;
+
+static volatile int nSink;
+
+/**
+ * @brief Timekeeping of a tick as it was done in floating point
+ * (elapsed rounding, countdown seconds and tenths, scroll slot)
+ *
+ * @param tElapsed Microseconds since the start of the state
+ * @param pSink Tracks the last value shown
+ */
+static void Legacy_Tick(int64_t tElapsed, BENCH_SINK *pSink)
+{
+    double dElapsedSeconds = roundf((float)tElapsed / 100000.0) / 10.0;
+    double dElapsedSecondsTenths = roundf(tElapsed / 100000.0);
+    int nTenthsRemain = ceil(((float)EVENT_LENGTH * 10) - dElapsedSecondsTenths);
+    int nSecondsRemain = ceil(EVENT_LENGTH - dElapsedSeconds);
+    int slot = ((int)(round(2 * dElapsedSeconds)) - 1 + 14) % 14;
+
+    if (floor(dElapsedSeconds) != floor(pSink->nLast))
+    {
+        pSink->nChanged++;
+        pSink->nLast = dElapsedSeconds;
+    }
+    nSink = nTenthsRemain + trunc(nSecondsRemain / 10) + slot;
+}
+/**
+ * @brief The same timekeeping done in integer tenths of a second
+ *
+ * @param tElapsed Microseconds since the start of the state
+ * @param pSink Tracks the last value shown
+ */
+static void Integer_Tick(int64_t tElapsed, BENCH_SINK *pSink)
+{
+    int32_t nElapsedTenths = Elapsed_Tenths(tElapsed);
+    int32_t nTenthsRemain = (EVENT_LENGTH * 10) - nElapsedTenths;
+    int32_t nSecondsRemain = EVENT_LENGTH - nElapsedTenths / 10;
+    int slot = ((nElapsedTenths + 2) / 5 - 1 + 14) % 14;
+
+    if (nElapsedTenths / 10 != pSink->nLast)
+    {
+        pSink->nChanged++;
+        pSink->nLast = nElapsedTenths / 10;
+    }
+    nSink = nTenthsRemain + nSecondsRemain / 10 + slot;
+}
+
+static int64_t Now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/**
+ * @brief Time a tick kernel over a whole event worth of ticks
+ *
+ * @param pszName Name to report
+ * @param pfnTick Kernel to run
+ */
+static void Bench_Kernel(const char *pszName, void (*pfnTick)(int64_t, BENCH_SINK *))
+{
+    BENCH_SINK sink = {0, -1};
+    int64_t tStart = Now_ns();
+#ifdef HAVE_CYCLE_COUNTER
+    uint64_t nCycles = __rdtsc();
+#endif
+
+    for (int n = 0; n < BENCH_TICKS; n++)
+    {
+        // Spread the ticks over the whole event, ~1.5ms apart
+        pfnTick((int64_t)n * 1500, &sink);
+    }
+#ifdef HAVE_CYCLE_COUNTER
+    nCycles = __rdtsc() - nCycles;
+    printf("%-10s %8.2f ns/tick %8.1f cycles/tick (%d display changes)\n", pszName,
+           (double)(Now_ns() - tStart) / BENCH_TICKS, (double)nCycles / BENCH_TICKS, sink.nChanged);
+#else
+    printf("%-10s %8.2f ns/tick (%d display changes)\n", pszName,
+           (double)(Now_ns() - tStart) / BENCH_TICKS, sink.nChanged);
+#endif
+}
+/**
+ * @brief Time a full APP_Tasks step in a timed state
+ *
+ */
+static void Bench_APP_Tasks(void)
+{
+    int nTicks = (EVENT_LENGTH * 1000) / BENCH_TICK_MS;
+    int64_t tStart;
+
+    HOST_Reset();
+    HOST_Set_Log_Level('N');
+    Display_Initialize();
+    Schedule_Initialize();
+    APP_Initialize();
+    Switch_To_State(APP_STATE_RUNNING);
+    tStart = Now_ns();
+    for (int n = 0; n < nTicks; n++)
+    {
+        HOST_Advance_Time(BENCH_TICK_MS * 1000);
+        APP_Tasks();
+    }
+    printf("%-10s %8.2f ns/tick over %d ticks of a full event\n", "APP_Tasks",
+           (double)(Now_ns() - tStart) / nTicks, nTicks);
+}
+
+int main(void)
+{
+    Bench_Kernel("float", &Legacy_Tick);
+    Bench_Kernel("integer", &Integer_Tick);
+    Bench_APP_Tasks();
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file dlog_decode.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Turn the DLOG lines of a console capture back into log messages
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "app.h"
+
+// Longest console line passed through
+#define DECODE_LINE_MAX 1024
+// Backwards jumps of the 32 bit time further than this are a wrap, shorter ones a reset
+#define DECODE_WRAP_JUMP 0x80000000u
+
+/**
+ * @brief Copy a console capture from stdin to stdout with every DLOG
+ * record replaced by the message it stands for, in the ESP-IDF log format.
+ * Anything else is passed through untouched.
+ *
+ * @return int 0
+ */
+int main(void)
+{
+    char szLine[DECODE_LINE_MAX];
+    char szText[DLOG_TEXT_MAX];
+    uint64_t tHigh = 0;
+    uint32_t tLast = 0;
+    unsigned long nDecoded = 0;
+
+    while (fgets(szLine, sizeof(szLine), stdin) != NULL)
+    {
+        DLOG_RECORD record;
+
+        if (!Dlog_Decode(szLine, &record))
+        {
+            fputs(szLine, stdout);
+            continue;
+        }
+        // The record only keeps the low 32 bits of the time
+        if (record.tTime < tLast)
+        {
+            tHigh = (tLast - record.tTime >= DECODE_WRAP_JUMP) ? tHigh + ((uint64_t)1 << 32) : 0;
+        }
+        tLast = record.tTime;
+        Dlog_Format(&record, szText, sizeof(szText));
+        printf("%c (%llu) %s: %s\n", Dlog_Level(&record), (unsigned long long)((tHigh + record.tTime) / 1000),
+               Dlog_Tag(&record), szText);
+        nDecoded++;
+    }
+    fprintf(stderr, "%lu records decoded\n", nDecoded);
+    return 0;
+}
@@ -0,0 +1,23 @@
+# Record a golden trace with cbtimer_host and compare it with its baseline.
+#   cmake -DHOST=<cbtimer_host> -DTRACE_DIFF=<trace_diff> -DHOST_OPTIONS="<options>"
+#         -DEXPECTED=<baseline.trace> -DACTUAL=<new.trace> -P golden_test.cmake
+# Fails when the run fails or the traces differ.
+
+separate_arguments(HOST_OPTIONS UNIX_COMMAND "${HOST_OPTIONS}")
+
+execute_process(
+    COMMAND "${HOST}" ${HOST_OPTIONS} -q -T "${ACTUAL}"
+    OUTPUT_QUIET
+    RESULT_VARIABLE HOST_RESULT
+)
+if(NOT HOST_RESULT EQUAL 0)
+    message(FATAL_ERROR "cbtimer_host ${HOST_OPTIONS} failed: ${HOST_RESULT}")
+endif()
+
+execute_process(
+    COMMAND "${TRACE_DIFF}" "${EXPECTED}" "${ACTUAL}"
+    RESULT_VARIABLE DIFF_RESULT
+)
+if(NOT DIFF_RESULT EQUAL 0)
+    message(FATAL_ERROR "${ACTUAL} differs from ${EXPECTED}")
+endif()
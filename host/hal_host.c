@@ -0,0 +1,1587 @@
+/**
+ * @file hal_host.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Host (Linux) mock of the hardware abstraction layer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdarg.h>
+#include "app.h"
+#include "hal_host.h"
+#include "dfplayer.h"
+#include "sync.h"
+
+typedef struct
+{
+    int64_t tPress;   // Time the button goes down
+    int64_t tRelease; // Time the button comes back up
+} HOST_PRESS;
+
+typedef struct
+{
+    int64_t tAt; // Time the key is typed
+    char cKey;   // Key typed
+} HOST_KEY;
+
+typedef struct
+{
+    int64_t tReady;                      // Virtual time the frame arrives
+    uint8_t aFrame[DFPLAYER_CMD_LENGTH]; // Frame the DFPlayer sends
+} HOST_REPLY;
+
+typedef struct
+{
+    int64_t tReady;                     // Virtual time the packet arrives
+    bool bToLeader;                     // On its way to the simulated leader rather than the firmware
+    bool bArrived;                      // Reached the firmware, waiting for the sync service to take it
+    size_t nLength;                     // Bytes in aData
+    uint8_t aData[HAL_SYNC_PACKET_MAX]; // The packet
+} HOST_SYNC_PACKET;
+
+typedef struct
+{
+    HOST_SYNC_PACKET aPackets[HOST_MAX_SYNC_PACKETS]; // Packets on the link
+    int nPackets;                                     // Number of packets on the link
+    int64_t tLatency;                                 // Shortest time for a packet to cross the link
+    int64_t tJitter;                                  // Most extra time a packet can take
+    int32_t nDriftPPM;                                // How much faster the leader's clock runs
+    uint32_t nRandom;                                 // State of the jitter generator
+    int64_t tLeaderStart;                             // Virtual time the leader starts its event
+    int nLeaderSchedule;                              // Schedule the leader runs
+    bool bLeaderAnnounced;                            // The leader has announced its start
+    int64_t tLeaderClock;                             // The leader's clock at tLeaderClockAt
+    int64_t tLeaderClockAt;                           // Virtual time the leader's clock last started from
+    int64_t tLeaderDown;                              // Virtual time the leader restarts
+    int64_t tLeaderOff;                               // How long it is gone for
+    int64_t tLeaderBack;                              // Virtual time it is back, while it is gone
+} HOST_LINK;
+
+typedef struct
+{
+    char szKey[HOST_SETTING_KEY_LENGTH]; // Name of the setting, empty when the slot is free
+    size_t nLength;                      // Size of the value
+    uint8_t aData[HOST_SETTING_SIZE];    // Value
+} HOST_SETTING;
+
+typedef struct
+{
+    int64_t tNow;                          // Virtual clock in microseconds
+    int64_t tBoot;                         // Virtual time the firmware last started, HAL_Get_Time counts from here
+    int64_t tPowerOn;                      // Virtual time the power last came on, HAL_Get_Epoch counts from here
+    int64_t tRunEnd;                       // HAL_Wait_Until returns false at this time
+    bool bWakePending;                     // HAL_Wake_App was called
+    int nLeds;                             // LEDs in all the strips
+    int nStrips;                           // Number of strips
+    int anStripLeds[HAL_LED_MAX_STRIPS];   // LEDs in each strip
+    int anStripFirst[HAL_LED_MAX_STRIPS];  // First LED of each strip in aShown
+    uint8_t aShown[HOST_MAX_LEDS * 3];     // What the LEDs show after the last refresh
+    uint32_t nRefreshCount;                // Number of refreshes of the strip
+    HOST_FRAME_CALLBACK pfnFrame;          // Called on each refresh
+    HOST_PRESS aPresses[HOST_MAX_PRESSES]; // Scripted button presses
+    int nPresses;                          // Number of scripted presses
+    int64_t tBounce;                       // Spacing of the contact bounce, 0 for none
+    int64_t tLastRawEdge;                  // Time of the last raw edge delivered
+    HAL_DEBOUNCE debounce;                 // Debounce state, as kept by the interrupt
+    EVENT_RING ringButton;                 // Debounced edges waiting for the app
+    HOST_KEY aKeys[HOST_MAX_KEYS];         // Scripted console keys, in time order
+    int nKeys;                             // Number of scripted keys
+    int nNextKey;                          // Next key to type
+    EVENT_RING ringConsole;                // Keys waiting for the app
+    uint8_t aUART[HOST_UART_CAPTURE_SIZE]; // Bytes written to the DFPlayer
+    size_t nUARTLength;                    // Number of captured bytes
+    HAL_SERVICE pfnUARTService;            // Audio service, run as if it were a task
+    int64_t tUARTService;                  // When the audio service runs next
+    HAL_SERVICE pfnRenderService;          // Compositor, run as if it were a task
+    bool bRenderOff;                       // Never run the compositor, the LEDs stay as they are
+    int64_t tRenderService;                // When the compositor runs next
+    HOST_REPLY aReplies[HOST_MAX_REPLIES]; // Frames the DFPlayer is going to send
+    int nReplies;                          // Number of frames on the way
+    uint8_t aRX[HOST_UART_RX_SIZE];        // Bytes received and not yet read
+    size_t nRXLength;                      // Number of bytes waiting
+    int nFaultEvery;                       // Reject every nth command, 0 for never
+    uint32_t nCommands;                    // Commands the DFPlayer has seen
+    int64_t tDFPlayerOnline;               // When the DFPlayer finishes booting
+    int64_t tTrackHeard;                   // When the track played last starts to be heard
+    int64_t tTrackEnd;                     // When it finishes
+    bool bDFPlayerPowered;                 // The DFPlayer has been powered up since the power came on
+    uint8_t aRetained[HAL_RETAINED_SIZE];  // Memory kept through a warm reset
+    size_t nRetained;                      // Bytes kept in aRetained, 0 after a power loss
+    HAL_SERVICE pfnLogService;             // Deferred log drain, run as if it were a task
+    int64_t tLogService;                   // When the log drain runs next
+    HAL_SERVICE pfnSyncService;            // Clock sync, run as if it were a task
+    int64_t tSyncService;                  // When the clock sync runs next
+    HOST_LINK link;                        // Simulated sync link and the leader at its far end
+    HAL_POWER_STATS power;                 // Time under each power lock, as the board counts it
+    char cLogLevel;                        // Most verbose level to print
+} HOST_DATA;
+
+static HOST_DATA hostData = {.cLogLevel = 'I'};
+// The mock flash keeps its settings across HOST_Reset, as NVS does across a reset
+static HOST_SETTING aHostSettings[HOST_MAX_SETTINGS];
+static uint32_t nHostSettingsWrites;
+
+/**
+ * @brief Rank a log level letter so they can be compared
+ *
+ * @param cLevel ESP-IDF level letter (E, W, I, D, V)
+ * @return int Rank of the level, higher is more verbose
+ */
+static int HOST_Level_Rank(char cLevel)
+{
+    switch (cLevel)
+    {
+    case 'E':
+        return 1;
+    case 'W':
+        return 2;
+    case 'I':
+        return 3;
+    case 'D':
+        return 4;
+    case 'V':
+        return 5;
+    }
+    return 0;
+}
+/**
+ * @brief Print a log message stamped with the virtual time
+ *
+ * @param cLevel Level letter of the message
+ * @param pszTag Tag of the module logging
+ * @param pszFormat printf style format
+ */
+void HOST_Log(char cLevel, const char *pszTag, const char *pszFormat, ...)
+{
+    va_list args;
+
+    if (HOST_Level_Rank(cLevel) > HOST_Level_Rank(hostData.cLogLevel))
+    {
+        return;
+    }
+    fprintf(stderr, "%c (%lld) %s: ", cLevel, (long long)(hostData.tNow / 1000), pszTag);
+    va_start(args, pszFormat);
+    vfprintf(stderr, pszFormat, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+/**
+ * @brief Dump a buffer in hex
+ *
+ * @param pszTag Tag of the module logging
+ * @param pBuffer Bytes to dump
+ * @param nLength Number of bytes
+ */
+void HOST_Log_Buffer_Hex(const char *pszTag, const void *pBuffer, size_t nLength)
+{
+    const uint8_t *pBytes = pBuffer;
+
+    if (HOST_Level_Rank('I') > HOST_Level_Rank(hostData.cLogLevel))
+    {
+        return;
+    }
+    fprintf(stderr, "I (%lld) %s:", (long long)(hostData.tNow / 1000), pszTag);
+    for (size_t n = 0; n < nLength; n++)
+    {
+        fprintf(stderr, " %02x", pBytes[n]);
+    }
+    fputc('\n', stderr);
+}
+/**
+ * @brief Set the most verbose level of log message to print
+ *
+ * @param cLevel ESP-IDF level letter, 'N' to silence everything
+ */
+void HOST_Set_Log_Level(char cLevel)
+{
+    hostData.cLogLevel = cLevel;
+    Dlog_Set_Level(cLevel);
+}
+/**
+ * @brief Put the mock hardware back to its power on state
+ *
+ */
+void HOST_Reset(void)
+{
+    char cLogLevel = hostData.cLogLevel;
+    HOST_FRAME_CALLBACK pfnFrame = hostData.pfnFrame;
+    bool bRenderOff = hostData.bRenderOff;
+
+    memset(&hostData, 0, sizeof(hostData));
+    hostData.cLogLevel = cLogLevel;
+    hostData.pfnFrame = pfnFrame;
+    hostData.bRenderOff = bRenderOff;
+    hostData.tRunEnd = INT64_MAX;
+    hostData.tLastRawEdge = INT64_MIN;
+    hostData.tUARTService = HAL_NO_DEADLINE;
+    hostData.tRenderService = HAL_NO_DEADLINE;
+    hostData.tSyncService = HAL_NO_DEADLINE;
+    hostData.tLogService = HAL_NO_DEADLINE;
+    hostData.link.tLeaderStart = HAL_NO_DEADLINE;
+    hostData.link.tLeaderClock = HOST_SYNC_LEADER_CLOCK_US;
+    hostData.link.tLeaderDown = HAL_NO_DEADLINE;
+    hostData.link.tLeaderBack = HAL_NO_DEADLINE;
+    hostData.link.nRandom = 1;
+    hostData.debounce.tLastEdge = -HAL_BUTTON_DEBOUNCE_US;
+}
+/**
+ * @brief Restart the firmware, as the reset button or a power cut would.
+ * The mock flash is kept either way.  A warm reset keeps the retained
+ * memory, the epoch clock and the DFPlayer running; a power loss clears
+ * them, blanks the LEDs and leaves the clock stopped for a while.  The
+ * caller runs APP_Main again afterwards.
+ *
+ * @param bPowerLoss The power went away, rather than just the processor
+ * @param tOff How long the power stays off
+ */
+void HOST_Reboot(bool bPowerLoss, int64_t tOff)
+{
+    hostData.pfnUARTService = NULL;
+    hostData.tUARTService = HAL_NO_DEADLINE;
+    hostData.pfnRenderService = NULL;
+    hostData.tRenderService = HAL_NO_DEADLINE;
+    hostData.pfnSyncService = NULL;
+    hostData.tSyncService = HAL_NO_DEADLINE;
+    hostData.pfnLogService = NULL;
+    hostData.tLogService = HAL_NO_DEADLINE;
+    hostData.bWakePending = false;
+    memset(&hostData.ringButton, 0, sizeof(hostData.ringButton));
+    memset(&hostData.ringConsole, 0, sizeof(hostData.ringConsole));
+    hostData.nRXLength = 0;
+    if (bPowerLoss)
+    {
+        hostData.tNow += tOff;
+        hostData.tPowerOn = hostData.tNow;
+        memset(hostData.aShown, 0, sizeof(hostData.aShown));
+        hostData.nReplies = 0;
+        hostData.bDFPlayerPowered = false;
+        hostData.tTrackEnd = 0;
+        hostData.nRetained = 0;
+    }
+    hostData.tBoot = hostData.tNow;
+    // Presses while the firmware was down are missed
+    if (hostData.tLastRawEdge < hostData.tNow)
+    {
+        hostData.tLastRawEdge = hostData.tNow;
+    }
+    hostData.debounce.bPressed = false;
+    hostData.debounce.tLastEdge = hostData.tNow - HAL_BUTTON_DEBOUNCE_US;
+    memset(&hostData.power, 0, sizeof(hostData.power));
+}
+/**
+ * @brief Turn a time the firmware gave into virtual time
+ *
+ * @param tTime Microseconds since the firmware started, or HAL_NO_DEADLINE
+ * @return int64_t Virtual time, or HAL_NO_DEADLINE
+ */
+static int64_t HOST_Virtual_Time(int64_t tTime)
+{
+    return tTime == HAL_NO_DEADLINE ? tTime : tTime + hostData.tBoot;
+}
+/**
+ * @brief Set when the simulated run should stop
+ *
+ * @param tEnd Virtual time in microseconds
+ */
+void HOST_Set_Run_Time(int64_t tEnd)
+{
+    hostData.tRunEnd = tEnd;
+}
+/**
+ * @brief Set the virtual clock
+ *
+ * @param tNow New time in microseconds
+ */
+void HOST_Set_Time(int64_t tNow)
+{
+    hostData.tNow = tNow;
+}
+/**
+ * @brief Move the virtual clock forward
+ *
+ * @param tDelta Microseconds to advance
+ */
+void HOST_Advance_Time(int64_t tDelta)
+{
+    hostData.tNow += tDelta;
+}
+/**
+ * @brief Script a press of the button
+ *
+ * @param tPress Virtual time the button goes down
+ * @param tRelease Virtual time the button is let go
+ * @return true Press was added
+ * @return false Too many presses scripted
+ */
+bool HOST_Button_Script_Add(int64_t tPress, int64_t tRelease)
+{
+    int n;
+
+    if (hostData.nPresses >= HOST_MAX_PRESSES)
+    {
+        return false;
+    }
+    // Keep the presses sorted so the edges fire in order
+    for (n = hostData.nPresses; n > 0 && hostData.aPresses[n - 1].tPress > tPress; n--)
+    {
+        hostData.aPresses[n] = hostData.aPresses[n - 1];
+    }
+    hostData.aPresses[n].tPress = tPress;
+    hostData.aPresses[n].tRelease = tRelease;
+    hostData.nPresses++;
+    return true;
+}
+/**
+ * @brief Script a key typed on the console
+ *
+ * @param tAt Virtual time the key is typed
+ * @param cKey Key typed
+ * @return true Key was added
+ * @return false Too many keys scripted
+ */
+bool HOST_Console_Script_Add(int64_t tAt, char cKey)
+{
+    int n;
+
+    if (hostData.nKeys >= HOST_MAX_KEYS)
+    {
+        return false;
+    }
+    for (n = hostData.nKeys; n > 0 && hostData.aKeys[n - 1].tAt > tAt; n--)
+    {
+        hostData.aKeys[n] = hostData.aKeys[n - 1];
+    }
+    hostData.aKeys[n].tAt = tAt;
+    hostData.aKeys[n].cKey = cKey;
+    hostData.nKeys++;
+    return true;
+}
+/**
+ * @brief Make every scripted edge chatter like a real contact.  Each edge is
+ * followed by HOST_BOUNCE_COUNT short flips of the level before it settles.
+ *
+ * @param tBounce Microseconds between flips, 0 for clean edges
+ */
+void HOST_Set_Button_Bounce(int64_t tBounce)
+{
+    hostData.tBounce = tBounce;
+}
+/**
+ * @brief Make the mock DFPlayer answer some commands with an error
+ *
+ * @param nEvery Reject every nth command, 0 to accept them all
+ */
+void HOST_Set_DFPlayer_Faults(int nEvery)
+{
+    hostData.nFaultEvery = nEvery;
+}
+/**
+ * @brief Register a routine to be called every time the strip is refreshed
+ *
+ * @param pfnFrame Callback, NULL to disable
+ */
+void HOST_Set_Frame_Callback(HOST_FRAME_CALLBACK pfnFrame)
+{
+    hostData.pfnFrame = pfnFrame;
+}
+/**
+ * @brief Turn the compositor on or off.  Runs that only look at the state
+ * machine go several times faster without composing every frame of the
+ * fades.  Takes effect when the firmware next starts.
+ *
+ * @param bRender Run the compositor, as the firmware does
+ */
+void HOST_Set_Render(bool bRender)
+{
+    hostData.bRenderOff = !bRender;
+}
+/**
+ * @brief Get what the LEDs are currently showing
+ *
+ * @param pnLeds Returns the number of LEDs
+ * @return const uint8_t* R,G,B bytes for each LED
+ */
+const uint8_t *HOST_Get_LEDs(int *pnLeds)
+{
+    *pnLeds = hostData.nLeds;
+    return hostData.aShown;
+}
+/**
+ * @brief Get the number of times the strip has been refreshed
+ *
+ * @return uint32_t Refresh count
+ */
+uint32_t HOST_Get_Refresh_Count(void)
+{
+    return hostData.nRefreshCount;
+}
+/**
+ * @brief Get everything written to the DFPlayer UART
+ *
+ * @param pnLength Returns the number of bytes
+ * @return const uint8_t* Captured bytes
+ */
+const uint8_t *HOST_Get_UART_Capture(size_t *pnLength)
+{
+    *pnLength = hostData.nUARTLength;
+    return hostData.aUART;
+}
+
+/**
+ * @brief Count a power lock being taken or given back.  The host has one
+ * clock and never sleeps, so nothing else changes.
+ *
+ * @param eLock Lock
+ * @param bTake Taken rather than given back
+ */
+static void HOST_Power_Lock(HAL_POWER_LOCK eLock, bool bTake)
+{
+    HAL_Power_Account(&hostData.power, eLock, bTake, HAL_Get_Time());
+}
+/**
+ * @brief Nothing to configure, the locks are only counted
+ *
+ */
+void HAL_Power_Initialize(void)
+{
+}
+/**
+ * @brief Get the time spent under each power lock up to now
+ *
+ * @param pStats Where to put the times
+ */
+void HAL_Power_Get_Stats(HAL_POWER_STATS *pStats)
+{
+    *pStats = hostData.power;
+    HAL_Power_Settle(pStats, HAL_Get_Time());
+}
+/**
+ * @brief Nothing is measured per power mode on the host
+ *
+ */
+void HAL_Power_Log_Modes(void)
+{
+}
+/**
+ * @brief The host has no heap of its own to report, and the services run
+ * on the stack of whoever moves the virtual clock
+ *
+ * @param pStats Where to put the report, all zero
+ */
+void HAL_Memory_Get_Stats(HAL_MEMORY_STATS *pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+}
+/**
+ * @brief Size the in-memory LED strips.  The strips are kept one after the
+ * other, in strip order, in a single buffer.
+ *
+ * @param nStrips Number of strips
+ * @param anGpios GPIO of each strip (unused)
+ * @param anLeds Number of LEDs in each strip
+ */
+void HAL_LED_Initialize(int nStrips, const int *anGpios, const int *anLeds)
+{
+    int nLeds = 0;
+
+    if (nStrips > HAL_LED_MAX_STRIPS)
+    {
+        ESP_LOGE("hal", "%d strips exceeds HAL_LED_MAX_STRIPS", nStrips);
+        abort();
+    }
+    for (int nStrip = 0; nStrip < nStrips; nStrip++)
+    {
+        hostData.anStripFirst[nStrip] = nLeds;
+        hostData.anStripLeds[nStrip] = anLeds[nStrip];
+        nLeds += anLeds[nStrip];
+    }
+    if (nLeds > HOST_MAX_LEDS)
+    {
+        ESP_LOGE("hal", "Strips of %d LEDs exceed HOST_MAX_LEDS", nLeds);
+        abort();
+    }
+    hostData.nStrips = nStrips;
+    hostData.nLeds = nLeds;
+}
+
+/**
+ * @brief Latch the first LEDs of each strip into what the LEDs show.
+ * LEDs past the last one clocked out keep showing their old values.
+ *
+ * @param aFrame Color (0x00RRGGBB) of every LED, the strips one after the other
+ * @param anLeds Number of LEDs to send from the start of each strip
+ */
+void HAL_LED_Blit(const uint32_t *aFrame, const int *anLeds)
+{
+    HOST_Power_Lock(HAL_POWER_LOCK_LED, true);
+    for (int nStrip = 0; nStrip < hostData.nStrips; nStrip++)
+    {
+        int nLeds = anLeds[nStrip] < hostData.anStripLeds[nStrip] ? anLeds[nStrip] : hostData.anStripLeds[nStrip];
+        int nFirst = hostData.anStripFirst[nStrip];
+        uint8_t *pPixel = hostData.aShown + nFirst * 3;
+
+        for (int nLed = 0; nLed < nLeds; nLed++, pPixel += 3)
+        {
+            pPixel[0] = (uint8_t)(aFrame[nFirst + nLed] >> 16);
+            pPixel[1] = (uint8_t)(aFrame[nFirst + nLed] >> 8);
+            pPixel[2] = (uint8_t)aFrame[nFirst + nLed];
+        }
+    }
+    hostData.nRefreshCount++;
+    if (hostData.pfnFrame != NULL)
+    {
+        hostData.pfnFrame(hostData.tNow, hostData.aShown, hostData.nLeds);
+    }
+}
+
+/**
+ * @brief Remember the compositor so it can be run as the virtual clock moves
+ *
+ * @param pfnService Run when woken or when its frame is due
+ */
+void HAL_Render_Initialize(HAL_SERVICE pfnService)
+{
+    hostData.pfnRenderService = hostData.bRenderOff ? NULL : pfnService;
+}
+
+/**
+ * @brief Run the compositor at the current virtual time
+ *
+ */
+void HAL_Render_Wake_Service(void)
+{
+    if (hostData.pfnRenderService != NULL)
+    {
+        hostData.tRenderService = hostData.tNow;
+    }
+}
+
+/**
+ * @brief Run the compositor the way its task would
+ *
+ */
+static void HOST_Run_Render_Service(void)
+{
+    hostData.tRenderService = HAL_NO_DEADLINE;
+    int64_t tNext = HOST_Virtual_Time(hostData.pfnRenderService(HAL_Get_Time()));
+    // Frames latch at once here, so the strips are let go as soon as it is idle
+    if (tNext == HAL_NO_DEADLINE)
+    {
+        HOST_Power_Lock(HAL_POWER_LOCK_LED, false);
+    }
+    // A new scene may have been handed over while it ran
+    if (tNext < hostData.tRenderService)
+    {
+        hostData.tRenderService = tNext;
+    }
+}
+
+/**
+ * @brief Nothing to configure for the scripted button
+ *
+ */
+void HAL_Button_Initialize(void)
+{
+}
+/**
+ * @brief Nothing to start, the scripted keys are typed by HAL_Wait_Until
+ *
+ */
+void HAL_Console_Initialize(void)
+{
+}
+/**
+ * @brief Write a line to the log, which is the console of the host build
+ *
+ * @param pszLine Line, without the line ending
+ */
+void HAL_Console_Write(const char *pszLine)
+{
+    fprintf(stderr, "%s\n", pszLine);
+}
+/**
+ * @brief Remember the log drain service, run from HAL_Wait_Until
+ *
+ * @param pfnService Deferred log drain
+ */
+void HAL_Log_Initialize(HAL_SERVICE pfnService)
+{
+    hostData.pfnLogService = pfnService;
+    hostData.tLogService = HAL_NO_DEADLINE;
+}
+/**
+ * @brief Have the log drain run at the current virtual time
+ *
+ */
+void HAL_Log_Wake_Service(void)
+{
+    if (hostData.pfnLogService != NULL)
+    {
+        hostData.tLogService = hostData.tNow;
+    }
+}
+/**
+ * @brief Run the log drain, as the log task would
+ *
+ */
+static void HOST_Run_Log_Service(void)
+{
+    hostData.tLogService = HAL_NO_DEADLINE;
+    hostData.pfnLogService(hostData.tNow - hostData.tBoot);
+}
+/**
+ * @brief Type the next scripted key, as the console task would
+ *
+ */
+static void HOST_Type_Key(void)
+{
+    const HOST_KEY *pKey = &hostData.aKeys[hostData.nNextKey++];
+    EVENT event = {
+        .eType = EVENT_CONSOLE_KEY,
+        .tTime = hostData.tNow - hostData.tBoot,
+        .nParam = (uint8_t)pKey->cKey,
+    };
+
+    if (Event_Ring_Push(&hostData.ringConsole, &event))
+    {
+        HAL_Wake_App();
+    }
+}
+
+/**
+ * @brief Determine the raw level of the contact, including any bounce
+ *
+ * @param tTime Virtual time to check
+ * @return true Contact is closed
+ * @return false Contact is open
+ */
+static bool HOST_Raw_Level(int64_t tTime)
+{
+    int64_t tWindow = hostData.tBounce * 2 * HOST_BOUNCE_COUNT;
+    bool bPressed = false;
+
+    for (int n = 0; n < hostData.nPresses; n++)
+    {
+        const HOST_PRESS *pPress = &hostData.aPresses[n];
+
+        if (tTime >= pPress->tPress && tTime < pPress->tRelease)
+        {
+            bPressed = true;
+            if (tTime - pPress->tPress < tWindow &&
+                ((tTime - pPress->tPress) / hostData.tBounce) % 2 == 1)
+            {
+                bPressed = false;
+            }
+            break;
+        }
+        if (tTime >= pPress->tRelease && tTime - pPress->tRelease < tWindow &&
+            ((tTime - pPress->tRelease) / hostData.tBounce) % 2 == 1)
+        {
+            bPressed = true;
+            break;
+        }
+    }
+    return bPressed;
+}
+/**
+ * @brief Find the first raw edge of the contact after a time
+ *
+ * @param tAfter Only edges later than this are wanted
+ * @return int64_t Time of the edge, HAL_NO_DEADLINE if there are no more
+ */
+static int64_t HOST_Next_Raw_Edge(int64_t tAfter)
+{
+    int64_t tNext = HAL_NO_DEADLINE;
+    int nFlips = hostData.tBounce > 0 ? 2 * HOST_BOUNCE_COUNT : 0;
+
+    for (int n = 0; n < hostData.nPresses; n++)
+    {
+        int64_t atEdges[2] = {hostData.aPresses[n].tPress, hostData.aPresses[n].tRelease};
+
+        for (int nEdge = 0; nEdge < 2; nEdge++)
+        {
+            for (int nFlip = 0; nFlip <= nFlips; nFlip++)
+            {
+                int64_t tEdge = atEdges[nEdge] + nFlip * hostData.tBounce;
+                if (tEdge > tAfter && tEdge < tNext)
+                {
+                    tNext = tEdge;
+                }
+            }
+        }
+    }
+    return tNext;
+}
+/**
+ * @brief Handle a raw edge the way the button interrupt does
+ *
+ */
+static void HOST_Button_ISR(void)
+{
+    bool bPressed = HOST_Raw_Level(hostData.tNow);
+    EVENT event = {
+        .eType = bPressed ? EVENT_BUTTON_PRESS : EVENT_BUTTON_RELEASE,
+        .tTime = hostData.tNow,
+    };
+
+    if (HAL_Debounce_Edge(&hostData.debounce, event.tTime, bPressed))
+    {
+        event.tTime = HAL_Get_Time();
+        Event_Ring_Push(&hostData.ringButton, &event);
+        hostData.bWakePending = true;
+    }
+}
+/**
+ * @brief Determine the raw level of the scripted button at the current time
+ *
+ * @return true Button is pressed
+ * @return false Button is released
+ */
+bool HAL_Button_Is_Pressed(void)
+{
+    return HOST_Raw_Level(hostData.tNow);
+}
+
+
+/**
+ * @brief Have the mock DFPlayer send a frame a little later
+ *
+ * @param tDelay How long until the frame arrives
+ * @param nCommand Command byte of the frame
+ * @param nParam Parameter of the frame
+ */
+static void HOST_DFPlayer_Reply(int64_t tDelay, uint8_t nCommand, uint16_t nParam)
+{
+    HOST_REPLY *pReply;
+
+    if (hostData.nReplies >= HOST_MAX_REPLIES)
+    {
+        return;
+    }
+    pReply = &hostData.aReplies[hostData.nReplies++];
+    pReply->tReady = hostData.tNow + tDelay;
+    dfplayer_encode(pReply->aFrame, nCommand, nParam, false);
+}
+/**
+ * @brief Remember the audio service so it can be run as the virtual clock
+ * moves, and power up the mock DFPlayer unless it already is
+ *
+ * @param pfnService Run whenever there is something to do
+ */
+void HAL_UART_Initialize(HAL_SERVICE pfnService)
+{
+    hostData.pfnUARTService = pfnService;
+    HOST_Power_Lock(HAL_POWER_LOCK_AUDIO, true);
+    if (!hostData.bDFPlayerPowered)
+    {
+        hostData.bDFPlayerPowered = true;
+        hostData.tDFPlayerOnline = hostData.tNow + HOST_DFPLAYER_BOOT_US;
+        HOST_DFPlayer_Reply(HOST_DFPLAYER_BOOT_US, DFPLAYER_RSP_ONLINE, 2);
+    }
+}
+
+/**
+ * @brief Append bytes to the UART capture, and answer DFPlayer commands the
+ * way the module does once it is online: ACK (or an error when faults are
+ * set) when feedback is requested, and a finished report once a played
+ * track ends.  A status query reports playing from HOST_DFPLAYER_START_US
+ * and HOST_DFPLAYER_SEEK_US per track number after the play command, and
+ * is never faulted.
+ *
+ * @param pData Bytes to write
+ * @param nLength Number of bytes
+ */
+void HAL_UART_Write(const uint8_t *pData, size_t nLength)
+{
+    HOST_Power_Lock(HAL_POWER_LOCK_AUDIO, true);
+    if (nLength == DFPLAYER_CMD_LENGTH && pData[0] == 0x7E && pData[3] == DFPLAYER_CMD_QUERY_STATUS)
+    {
+        if (hostData.tNow >= hostData.tDFPlayerOnline)
+        {
+            // The module looks once the whole query has arrived
+            int64_t tHeard = hostData.tNow + DFPLAYER_FRAME_US;
+            bool bPlaying = tHeard >= hostData.tTrackHeard && tHeard < hostData.tTrackEnd;
+
+            HOST_DFPlayer_Reply(HOST_DFPLAYER_REPLY_US, DFPLAYER_RSP_STATUS,
+                                0x0200 | (bPlaying ? DFPLAYER_STATUS_PLAYING : 0));
+        }
+    }
+    else if (nLength == DFPLAYER_CMD_LENGTH && pData[0] == 0x7E && hostData.tNow >= hostData.tDFPlayerOnline)
+    {
+        bool bFault;
+
+        hostData.nCommands++;
+        bFault = hostData.nFaultEvery > 0 && hostData.nCommands % hostData.nFaultEvery == 0;
+        if (pData[4] != 0)
+        {
+            HOST_DFPlayer_Reply(HOST_DFPLAYER_REPLY_US, bFault ? DFPLAYER_RSP_ERROR : DFPLAYER_RSP_ACK, bFault ? 1 : 0);
+        }
+        if (!bFault && pData[3] == DFPLAYER_CMD_PLAY_TRACK)
+        {
+            uint16_t nTrack = (pData[5] << 8) | pData[6];
+
+            hostData.tTrackHeard = hostData.tNow + HOST_DFPLAYER_START_US + nTrack * HOST_DFPLAYER_SEEK_US;
+            hostData.tTrackEnd = hostData.tNow + HOST_DFPLAYER_TRACK_US;
+            HOST_DFPlayer_Reply(HOST_DFPLAYER_TRACK_US, DFPLAYER_RSP_FINISHED_SD, nTrack);
+        }
+    }
+    if (hostData.nUARTLength + nLength > sizeof(hostData.aUART))
+    {
+        nLength = sizeof(hostData.aUART) - hostData.nUARTLength;
+    }
+    memcpy(hostData.aUART + hostData.nUARTLength, pData, nLength);
+    hostData.nUARTLength += nLength;
+}
+
+/**
+ * @brief Read what the mock DFPlayer has sent
+ *
+ * @param pData Where to put the bytes
+ * @param nMaxLength Most bytes to read
+ * @return size_t Number of bytes read
+ */
+size_t HAL_UART_Read(uint8_t *pData, size_t nMaxLength)
+{
+    size_t nRead = hostData.nRXLength < nMaxLength ? hostData.nRXLength : nMaxLength;
+
+    memcpy(pData, hostData.aRX, nRead);
+    hostData.nRXLength -= nRead;
+    memmove(hostData.aRX, hostData.aRX + nRead, hostData.nRXLength);
+    return nRead;
+}
+
+/**
+ * @brief Run the audio service at the current virtual time
+ *
+ */
+void HAL_UART_Wake_Service(void)
+{
+    if (hostData.pfnUARTService != NULL)
+    {
+        hostData.tUARTService = hostData.tNow;
+    }
+}
+
+/**
+ * @brief Find the next frame the mock DFPlayer sends
+ *
+ * @return int Index into aReplies, -1 if there are none
+ */
+static int HOST_Next_Reply(void)
+{
+    int nNext = -1;
+
+    for (int n = 0; n < hostData.nReplies; n++)
+    {
+        if (nNext < 0 || hostData.aReplies[n].tReady < hostData.aReplies[nNext].tReady)
+        {
+            nNext = n;
+        }
+    }
+    return nNext;
+}
+/**
+ * @brief Deliver a frame from the mock DFPlayer and wake the audio service
+ *
+ * @param nReply Index into aReplies
+ */
+static void HOST_Deliver_Reply(int nReply)
+{
+    if (hostData.nRXLength + DFPLAYER_CMD_LENGTH <= sizeof(hostData.aRX))
+    {
+        memcpy(hostData.aRX + hostData.nRXLength, hostData.aReplies[nReply].aFrame, DFPLAYER_CMD_LENGTH);
+        hostData.nRXLength += DFPLAYER_CMD_LENGTH;
+    }
+    hostData.aReplies[nReply] = hostData.aReplies[--hostData.nReplies];
+    HAL_UART_Wake_Service();
+}
+/**
+ * @brief Run the audio service the way its task would
+ *
+ */
+static void HOST_Run_UART_Service(void)
+{
+    hostData.tUARTService = HAL_NO_DEADLINE;
+    int64_t tNext = HOST_Virtual_Time(hostData.pfnUARTService(HAL_Get_Time()));
+    if (tNext == HAL_NO_DEADLINE)
+    {
+        HOST_Power_Lock(HAL_POWER_LOCK_AUDIO, false);
+    }
+    // The service may have been woken again while it ran
+    if (tNext < hostData.tUARTService)
+    {
+        hostData.tUARTService = tNext;
+    }
+}
+
+/**
+ * @brief Set up the simulated sync link
+ *
+ * @param tLatency Shortest time for a packet to cross the link
+ * @param tJitter Most extra time a packet can take, spread evenly
+ * @param nDriftPPM How much faster the leader's clock runs than ours
+ */
+void HOST_Sync_Link(int64_t tLatency, int64_t tJitter, int32_t nDriftPPM)
+{
+    hostData.link.tLatency = tLatency;
+    hostData.link.tJitter = tJitter;
+    hostData.link.nDriftPPM = nDriftPPM;
+}
+
+/**
+ * @brief Have the simulated leader start an event, as if its button were pressed
+ *
+ * @param tStart Virtual time the event starts
+ * @param nSchedule Schedule it runs
+ */
+void HOST_Sync_Leader_Start(int64_t tStart, int nSchedule)
+{
+    hostData.link.tLeaderStart = tStart;
+    hostData.link.nLeaderSchedule = nSchedule;
+}
+
+/**
+ * @brief Have the simulated leader restart, as a brownout would.  It hears
+ * nothing while it is gone, then comes back with its clock started over
+ * and its event picked back up, which it announces.
+ *
+ * @param tAt Virtual time it restarts
+ * @param tOff How long it is gone for
+ */
+void HOST_Sync_Leader_Restart(int64_t tAt, int64_t tOff)
+{
+    hostData.link.tLeaderDown = tAt;
+    hostData.link.tLeaderOff = tOff;
+}
+
+/**
+ * @brief Read the simulated leader's clock
+ *
+ * @param tVirtual Virtual time
+ * @return int64_t The leader's clock at that time
+ */
+static int64_t HOST_Leader_Clock(int64_t tVirtual)
+{
+    int64_t tRun = tVirtual - hostData.link.tLeaderClockAt;
+
+    return hostData.link.tLeaderClock + tRun + tRun * hostData.link.nDriftPPM / 1000000;
+}
+
+/**
+ * @brief Get how far the simulated leader is into its event, by its clock
+ *
+ * @return int64_t Elapsed microseconds, INT64_MIN before it starts
+ */
+int64_t HOST_Sync_Leader_Elapsed(void)
+{
+    if (hostData.tNow < hostData.link.tLeaderStart)
+    {
+        return INT64_MIN;
+    }
+    return HOST_Leader_Clock(hostData.tNow) - HOST_Leader_Clock(hostData.link.tLeaderStart);
+}
+
+/**
+ * @brief Put a packet on the simulated link
+ *
+ * @param pData Packet
+ * @param nLength Size of the packet
+ * @param tSent Virtual time it leaves
+ * @param bToLeader Going to the leader rather than the firmware
+ */
+static void HOST_Link_Send(const void *pData, size_t nLength, int64_t tSent, bool bToLeader)
+{
+    HOST_SYNC_PACKET *pPacket;
+
+    if (hostData.link.nPackets >= HOST_MAX_SYNC_PACKETS || nLength > HAL_SYNC_PACKET_MAX)
+    {
+        return;
+    }
+    pPacket = &hostData.link.aPackets[hostData.link.nPackets++];
+    pPacket->tReady = tSent + hostData.link.tLatency;
+    if (hostData.link.tJitter > 0)
+    {
+        hostData.link.nRandom = hostData.link.nRandom * 1103515245 + 12345;
+        pPacket->tReady += (hostData.link.nRandom >> 8) % hostData.link.tJitter;
+    }
+    pPacket->bToLeader = bToLeader;
+    pPacket->bArrived = false;
+    pPacket->nLength = nLength;
+    memcpy(pPacket->aData, pData, nLength);
+}
+
+/**
+ * @brief Build a packet from the simulated leader
+ *
+ * @param pPacket Where to build it
+ * @param eMsg Kind of packet
+ */
+static void HOST_Leader_Packet(SYNC_PACKET *pPacket, SYNC_MSG eMsg)
+{
+    bool bStarted = hostData.link.bLeaderAnnounced;
+
+    memset(pPacket, 0, sizeof(*pPacket));
+    pPacket->nMagic = SYNC_MAGIC;
+    pPacket->nVersion = SYNC_VERSION;
+    pPacket->eMsg = eMsg;
+    pPacket->nState = bStarted ? APP_STATE_RUNNING : APP_STATE_CODEBUSTERS;
+    pPacket->nSchedule = (uint8_t)hostData.link.nLeaderSchedule;
+    pPacket->nGeneration = bStarted ? 1 : 0;
+    pPacket->tStart = bStarted ? HOST_Leader_Clock(hostData.link.tLeaderStart) : 0;
+    pPacket->tTransmit = HOST_Leader_Clock(hostData.tNow);
+}
+
+/**
+ * @brief Find the next packet to arrive on the simulated link
+ *
+ * @param bArrived Look for packets that reached the firmware instead
+ * @return int Index into aPackets, -1 if there are none
+ */
+static int HOST_Link_Next(bool bArrived)
+{
+    int nNext = -1;
+
+    for (int n = 0; n < hostData.link.nPackets; n++)
+    {
+        const HOST_SYNC_PACKET *pPacket = &hostData.link.aPackets[n];
+
+        if (pPacket->bArrived == bArrived &&
+            (nNext < 0 || pPacket->tReady < hostData.link.aPackets[nNext].tReady))
+        {
+            nNext = n;
+        }
+    }
+    return nNext;
+}
+
+/**
+ * @brief Take a packet off the simulated link
+ *
+ * @param nPacket Index into aPackets
+ */
+static void HOST_Link_Remove(int nPacket)
+{
+    hostData.link.aPackets[nPacket] = hostData.link.aPackets[--hostData.link.nPackets];
+}
+
+/**
+ * @brief A packet reaches the end of the simulated link.  The leader answers
+ * a request; a packet for the firmware waits for the sync service to take it.
+ *
+ * @param nPacket Index into aPackets
+ */
+static void HOST_Link_Deliver(int nPacket)
+{
+    HOST_SYNC_PACKET *pPacket = &hostData.link.aPackets[nPacket];
+    const SYNC_PACKET *pRequest = (const SYNC_PACKET *)pPacket->aData;
+    SYNC_PACKET reply;
+
+    if (!pPacket->bToLeader)
+    {
+        pPacket->bArrived = true;
+        HAL_Sync_Wake_Service();
+        return;
+    }
+    if (pPacket->nLength == sizeof(SYNC_PACKET) && pRequest->eMsg == SYNC_MSG_REQUEST &&
+        hostData.link.tLeaderBack == HAL_NO_DEADLINE)
+    {
+        HOST_Leader_Packet(&reply, SYNC_MSG_REPLY);
+        reply.tOrigin = pRequest->tOrigin;
+        reply.tReceive = HOST_Leader_Clock(hostData.tNow);
+        reply.tTransmit = HOST_Leader_Clock(hostData.tNow + HOST_SYNC_TURNAROUND_US);
+        HOST_Link_Send(&reply, sizeof(reply), hostData.tNow + HOST_SYNC_TURNAROUND_US, false);
+    }
+    HOST_Link_Remove(nPacket);
+}
+
+/**
+ * @brief The simulated leader starts its event and announces it
+ *
+ */
+static void HOST_Leader_Start(void)
+{
+    SYNC_PACKET announce;
+
+    hostData.link.bLeaderAnnounced = true;
+    HOST_Leader_Packet(&announce, SYNC_MSG_ANNOUNCE);
+    HOST_Link_Send(&announce, sizeof(announce), hostData.tNow, false);
+}
+
+/**
+ * @brief The simulated leader goes down for its restart, or comes back
+ * from it with a new clock
+ *
+ */
+static void HOST_Leader_Restart_Step(void)
+{
+    SYNC_PACKET announce;
+
+    if (hostData.link.tLeaderBack == HAL_NO_DEADLINE)
+    {
+        hostData.link.tLeaderBack = hostData.tNow + hostData.link.tLeaderOff;
+        hostData.link.tLeaderDown = HAL_NO_DEADLINE;
+        return;
+    }
+    hostData.link.tLeaderBack = HAL_NO_DEADLINE;
+    hostData.link.tLeaderClock = HOST_SYNC_LEADER_BOOT_US;
+    hostData.link.tLeaderClockAt = hostData.tNow;
+    if (hostData.link.bLeaderAnnounced)
+    {
+        HOST_Leader_Packet(&announce, SYNC_MSG_ANNOUNCE);
+        HOST_Link_Send(&announce, sizeof(announce), hostData.tNow, false);
+    }
+}
+
+/**
+ * @brief Nothing to bring up, the simulated link is always there.  It
+ * holds the link lock from now on, as the board's links do.
+ *
+ * @return true Always
+ */
+static bool HOST_Link_Open(void)
+{
+    HOST_Power_Lock(HAL_POWER_LOCK_LINK, true);
+    return true;
+}
+
+/**
+ * @brief Send a packet from the firmware to the simulated leader
+ *
+ * @param pData Packet
+ * @param nLength Size of the packet
+ * @return true Always
+ */
+static bool HOST_Link_Transmit(const void *pData, size_t nLength)
+{
+    HOST_Link_Send(pData, nLength, hostData.tNow, true);
+    return true;
+}
+
+/**
+ * @brief Take the next packet that reached the firmware
+ *
+ * @param pData Where to put the packet
+ * @param nMaxLength Room at pData
+ * @param ptAt Returns the firmware's time it arrived
+ * @return size_t Size of the packet, 0 when none is waiting
+ */
+static size_t HOST_Link_Receive(void *pData, size_t nMaxLength, int64_t *ptAt)
+{
+    int nPacket = HOST_Link_Next(true);
+    size_t nLength;
+
+    if (nPacket < 0 || hostData.link.aPackets[nPacket].nLength > nMaxLength)
+    {
+        return 0;
+    }
+    nLength = hostData.link.aPackets[nPacket].nLength;
+    memcpy(pData, hostData.link.aPackets[nPacket].aData, nLength);
+    *ptAt = hostData.link.aPackets[nPacket].tReady - hostData.tBoot;
+    HOST_Link_Remove(nPacket);
+    return nLength;
+}
+
+/**
+ * @brief Get a link to the other timers.  The host only has the simulated one.
+ *
+ * @param eLink Which link
+ * @return const HAL_TRANSPORT* The link, NULL for any other kind
+ */
+const HAL_TRANSPORT *HAL_Sync_Transport(HAL_LINK eLink)
+{
+    static const HAL_TRANSPORT transportSimulated = {"simulated link", &HOST_Link_Open, &HOST_Link_Transmit,
+                                                     &HOST_Link_Receive};
+
+    return eLink == HAL_LINK_SIMULATED ? &transportSimulated : NULL;
+}
+
+/**
+ * @brief Remember the clock sync so it can be run as the virtual clock moves
+ *
+ * @param pfnService Run when a packet arrives or its deadline passes
+ */
+void HAL_Sync_Initialize(HAL_SERVICE pfnService)
+{
+    hostData.pfnSyncService = pfnService;
+    hostData.tSyncService = hostData.tNow;
+}
+
+/**
+ * @brief Run the clock sync at the current virtual time
+ *
+ */
+void HAL_Sync_Wake_Service(void)
+{
+    if (hostData.pfnSyncService != NULL)
+    {
+        hostData.tSyncService = hostData.tNow;
+    }
+}
+
+/**
+ * @brief Run the clock sync the way its task would
+ *
+ */
+static void HOST_Run_Sync_Service(void)
+{
+    hostData.tSyncService = HAL_NO_DEADLINE;
+    int64_t tNext = HOST_Virtual_Time(hostData.pfnSyncService(HAL_Get_Time()));
+    // A packet may have arrived while it ran
+    if (tNext < hostData.tSyncService)
+    {
+        hostData.tSyncService = tNext;
+    }
+}
+
+/**
+ * @brief Forget every stored setting, like erasing the NVS partition
+ *
+ */
+void HOST_Settings_Erase(void)
+{
+    memset(aHostSettings, 0, sizeof(aHostSettings));
+}
+
+/**
+ * @brief Get how many times a setting has been written
+ *
+ * @return uint32_t Writes since the program started
+ */
+uint32_t HOST_Get_Settings_Writes(void)
+{
+    return nHostSettingsWrites;
+}
+
+/**
+ * @brief Find a stored setting
+ *
+ * @param pszKey Name of the setting
+ * @return HOST_SETTING* The setting, NULL when it is not stored
+ */
+static HOST_SETTING *HOST_Find_Setting(const char *pszKey)
+{
+    for (int n = 0; n < HOST_MAX_SETTINGS; n++)
+    {
+        if (aHostSettings[n].szKey[0] != '\0' && strcmp(aHostSettings[n].szKey, pszKey) == 0)
+        {
+            return &aHostSettings[n];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Nothing to bring up, the mock flash is always there
+ *
+ * @return true Always
+ */
+bool HAL_Settings_Initialize(void)
+{
+    return true;
+}
+
+/**
+ * @brief Read a setting from the mock flash
+ *
+ * @param pszKey Name of the setting
+ * @param pData Where to put the value
+ * @param nLength Size of the value
+ * @return true Read
+ * @return false Not stored, or stored with a different size
+ */
+bool HAL_Settings_Load(const char *pszKey, void *pData, size_t nLength)
+{
+    HOST_SETTING *pSetting = HOST_Find_Setting(pszKey);
+
+    if (pSetting == NULL || pSetting->nLength != nLength)
+    {
+        return false;
+    }
+    memcpy(pData, pSetting->aData, nLength);
+    return true;
+}
+
+/**
+ * @brief Write a setting to the mock flash
+ *
+ * @param pszKey Name of the setting
+ * @param pData Value to store
+ * @param nLength Size of the value
+ * @return true Written
+ * @return false The key is too long, the value too big, or the mock flash is full
+ */
+bool HAL_Settings_Save(const char *pszKey, const void *pData, size_t nLength)
+{
+    HOST_SETTING *pSetting = HOST_Find_Setting(pszKey);
+
+    if (strlen(pszKey) >= HOST_SETTING_KEY_LENGTH || nLength > HOST_SETTING_SIZE)
+    {
+        return false;
+    }
+    for (int n = 0; pSetting == NULL && n < HOST_MAX_SETTINGS; n++)
+    {
+        if (aHostSettings[n].szKey[0] == '\0')
+        {
+            pSetting = &aHostSettings[n];
+        }
+    }
+    if (pSetting == NULL)
+    {
+        return false;
+    }
+    strcpy(pSetting->szKey, pszKey);
+    memcpy(pSetting->aData, pData, nLength);
+    pSetting->nLength = nLength;
+    nHostSettingsWrites++;
+    return true;
+}
+
+/**
+ * @brief Read back what was kept through a warm reset
+ *
+ * @param pData Where to put the data
+ * @param nLength Size of the data
+ * @return true Read
+ * @return false Nothing was kept, or it was of a different size
+ */
+bool HAL_Retained_Load(void *pData, size_t nLength)
+{
+    if (hostData.nRetained == 0 || hostData.nRetained != nLength)
+    {
+        return false;
+    }
+    memcpy(pData, hostData.aRetained, nLength);
+    return true;
+}
+
+/**
+ * @brief Keep data through a warm reset
+ *
+ * @param pData Data to keep
+ * @param nLength Size of the data, at most HAL_RETAINED_SIZE
+ */
+void HAL_Retained_Save(const void *pData, size_t nLength)
+{
+    ESP_ERROR_CHECK(nLength > HAL_RETAINED_SIZE ? ESP_ERR_INVALID_SIZE : ESP_OK);
+    memcpy(hostData.aRetained, pData, nLength);
+    hostData.nRetained = nLength;
+}
+
+/**
+ * @brief Get the virtual time since the firmware started
+ *
+ * @return int64_t Time in microseconds
+ */
+int64_t HAL_Get_Time(void)
+{
+    return hostData.tNow - hostData.tBoot;
+}
+
+/**
+ * @brief Get the virtual time since the power came on, which keeps running
+ * through a warm reset
+ *
+ * @return int64_t Time in microseconds
+ */
+int64_t HAL_Get_Epoch(void)
+{
+    return hostData.tNow - hostData.tPowerOn;
+}
+
+/**
+ * @brief Advance the virtual clock instead of blocking
+ *
+ * @param nMilliseconds How long to wait
+ */
+void HAL_Delay_ms(uint32_t nMilliseconds)
+{
+    hostData.tNow += (int64_t)nMilliseconds * 1000;
+}
+
+/**
+ * @brief Nothing to create, the virtual clock wakes the app
+ *
+ * @return true Always
+ */
+bool HAL_Initialize_Wake(void)
+{
+    return true;
+}
+/**
+ * @brief Run the virtual clock forward, firing button edges, DFPlayer
+ * replies, the audio service, the compositor, packets on the sync link and
+ * the clock sync in time order, until the deadline passes or the app is woken
+ *
+ * @param tDeadline HAL_Get_Time time to wake, HAL_NO_DEADLINE to wait for a wake
+ * @return true App should run
+ * @return false The scripted run time is over
+ */
+bool HAL_Wait_Until(int64_t tDeadline)
+{
+    tDeadline = HOST_Virtual_Time(tDeadline);
+    for (;;)
+    {
+        int64_t tNext = tDeadline;
+        int64_t tEdge;
+        int64_t tReply = HAL_NO_DEADLINE;
+        int nReply = HOST_Next_Reply();
+        int64_t tPacket = HAL_NO_DEADLINE;
+        int nPacket = HOST_Link_Next(false);
+        int64_t tLeader = hostData.link.bLeaderAnnounced ? HAL_NO_DEADLINE : hostData.link.tLeaderStart;
+        int64_t tRestart = hostData.link.tLeaderBack != HAL_NO_DEADLINE ? hostData.link.tLeaderBack
+                                                                        : hostData.link.tLeaderDown;
+        int64_t tKey = hostData.nNextKey < hostData.nKeys ? hostData.aKeys[hostData.nNextKey].tAt : HAL_NO_DEADLINE;
+
+        if (hostData.bWakePending)
+        {
+            hostData.bWakePending = false;
+            return true;
+        }
+        tEdge = HOST_Next_Raw_Edge(hostData.tLastRawEdge);
+        if (tEdge < tNext)
+        {
+            tNext = tEdge;
+        }
+        if (nReply >= 0)
+        {
+            tReply = hostData.aReplies[nReply].tReady;
+        }
+        if (tReply < tNext)
+        {
+            tNext = tReply;
+        }
+        if (hostData.tUARTService < tNext)
+        {
+            tNext = hostData.tUARTService;
+        }
+        if (hostData.tRenderService < tNext)
+        {
+            tNext = hostData.tRenderService;
+        }
+        if (nPacket >= 0)
+        {
+            tPacket = hostData.link.aPackets[nPacket].tReady;
+        }
+        if (tPacket < tNext)
+        {
+            tNext = tPacket;
+        }
+        if (tLeader < tNext)
+        {
+            tNext = tLeader;
+        }
+        if (tRestart < tNext)
+        {
+            tNext = tRestart;
+        }
+        if (hostData.tSyncService < tNext)
+        {
+            tNext = hostData.tSyncService;
+        }
+        if (tKey < tNext)
+        {
+            tNext = tKey;
+        }
+        if (hostData.tLogService < tNext)
+        {
+            tNext = hostData.tLogService;
+        }
+        if (tNext >= hostData.tRunEnd)
+        {
+            hostData.tNow = hostData.tRunEnd;
+            return false;
+        }
+        if (tNext > hostData.tNow)
+        {
+            hostData.tNow = tNext;
+        }
+        if (tNext == tEdge)
+        {
+            hostData.tLastRawEdge = tEdge;
+            HOST_Button_ISR();
+        }
+        else if (tNext == tReply)
+        {
+            HOST_Deliver_Reply(nReply);
+        }
+        else if (tNext == hostData.tUARTService)
+        {
+            HOST_Run_UART_Service();
+        }
+        else if (tNext == hostData.tRenderService)
+        {
+            HOST_Run_Render_Service();
+        }
+        else if (tNext == tPacket)
+        {
+            HOST_Link_Deliver(nPacket);
+        }
+        else if (tNext == tLeader)
+        {
+            HOST_Leader_Start();
+        }
+        else if (tNext == tRestart)
+        {
+            HOST_Leader_Restart_Step();
+        }
+        else if (tNext == hostData.tSyncService)
+        {
+            HOST_Run_Sync_Service();
+        }
+        else if (tNext == tKey)
+        {
+            HOST_Type_Key();
+        }
+        else if (tNext == hostData.tLogService)
+        {
+            HOST_Run_Log_Service();
+        }
+        else
+        {
+            return true;
+        }
+    }
+}
+/**
+ * @brief Wake the app before its deadline
+ *
+ */
+void HAL_Wake_App(void)
+{
+    hostData.bWakePending = true;
+}
+/**
+ * @brief Get the next event for the app
+ *
+ * @param pEvent Where to put the event
+ * @return true An event was returned
+ * @return false No events are waiting
+ */
+bool HAL_Get_Event(EVENT *pEvent)
+{
+    return Event_Ring_Pop(&hostData.ringButton, pEvent) || Event_Ring_Pop(&hostData.ringConsole, pEvent);
+}
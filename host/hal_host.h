@@ -0,0 +1,101 @@
+/**
+ * @file hal_host.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Controls for the host (Linux) mock of the hardware abstraction layer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _HAL_HOST_H
+#define _HAL_HOST_H
+
+#include "hal.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define HOST_MAX_LEDS 1024
+#define HOST_MAX_PRESSES 256
+#define HOST_MAX_KEYS 64
+#define HOST_BOUNCE_COUNT 3
+#define HOST_UART_CAPTURE_SIZE (64 * 1024)
+#define HOST_UART_RX_SIZE 256
+#define HOST_MAX_REPLIES 32
+#define HOST_DFPLAYER_REPLY_US 20000   // DFPlayer answers a command this much later
+#define HOST_DFPLAYER_TRACK_US 3000000 // Every track plays for this long
+#define HOST_DFPLAYER_BOOT_US 1500000  // DFPlayer ignores commands until it reports online
+#define HOST_DFPLAYER_START_US 90000   // A track is heard this long after its command
+#define HOST_DFPLAYER_SEEK_US 15000    // Plus this much for each track number, as if further into the card
+#define HOST_MAX_SETTINGS 8            // Settings the mock flash can hold
+#define HOST_SETTING_SIZE 1024         // Largest setting the mock flash can hold
+#define HOST_SETTING_KEY_LENGTH 16     // Longest key, including the terminator, as for NVS
+
+// Simulated sync link, with a leader at the far end
+#define HOST_MAX_SYNC_PACKETS 32            // Packets on the link at once
+#define HOST_SYNC_TURNAROUND_US 200         // Time the leader takes to answer a request
+#define HOST_SYNC_LEADER_CLOCK_US 123456789 // How far the leader's clock is ahead at time 0
+#define HOST_SYNC_LEADER_BOOT_US 300000     // The leader's clock when it is back from a restart
+
+  /**
+   * @brief Callback when the mock LED strip is refreshed
+   *
+   * @param tNow Virtual time of the refresh in microseconds
+   * @param pRGB LED values, three bytes (R,G,B) per LED
+   * @param nLeds Number of LEDs in the strip
+   */
+  typedef void (*HOST_FRAME_CALLBACK)(int64_t tNow, const uint8_t *pRGB, int nLeds);
+
+  extern void HOST_Reset(void);
+  extern void HOST_Reboot(bool bPowerLoss, int64_t tOff);
+  extern void HOST_Set_Run_Time(int64_t tEnd);
+  extern void HOST_Set_Time(int64_t tNow);
+  extern void HOST_Advance_Time(int64_t tDelta);
+  extern bool HOST_Button_Script_Add(int64_t tPress, int64_t tRelease);
+  extern void HOST_Set_Button_Bounce(int64_t tBounce);
+  extern bool HOST_Console_Script_Add(int64_t tAt, char cKey);
+  extern void HOST_Set_DFPlayer_Faults(int nEvery);
+  extern void HOST_Set_Frame_Callback(HOST_FRAME_CALLBACK pfnFrame);
+  extern void HOST_Set_Render(bool bRender);
+  extern const uint8_t *HOST_Get_LEDs(int *pnLeds);
+  extern uint32_t HOST_Get_Refresh_Count(void);
+  extern const uint8_t *HOST_Get_UART_Capture(size_t *pnLength);
+  extern void HOST_Set_Log_Level(char cLevel);
+  extern void HOST_Settings_Erase(void);
+  extern uint32_t HOST_Get_Settings_Writes(void);
+  extern void HOST_Sync_Link(int64_t tLatency, int64_t tJitter, int32_t nDriftPPM);
+  extern void HOST_Sync_Leader_Start(int64_t tStart, int nSchedule);
+  extern void HOST_Sync_Leader_Restart(int64_t tAt, int64_t tOff);
+  extern int64_t HOST_Sync_Leader_Elapsed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HAL_HOST_H */
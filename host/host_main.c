@@ -0,0 +1,322 @@
+/**
+ * @file host_main.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Runs the timer firmware on the host against the mock hardware
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <getopt.h>
+#include <math.h>
+#include "app.h"
+#include "hal_host.h"
+
+#define HOST_MAX_REBOOTS 16 // Resets that can be scripted with -r
+
+static int64_t tSyncErrorMax = -1; // Largest gap to the simulated leader, -1 when not following
+static FILE *pTraceFile;           // Golden trace being recorded, NULL for none
+
+/**
+ * @brief A scripted reset of the firmware
+ *
+ */
+typedef struct
+{
+    int64_t tAt;  // Virtual time of the reset
+    int64_t tOff; // How long the power is off, -1 for a warm reset
+} HOST_REBOOT;
+
+/**
+ * @brief Print each frame as the segments lit on every digit
+ *
+ * @param tNow Virtual time of the refresh
+ * @param pRGB LED values, three bytes per LED, the strips one after the other
+ * @param nLeds Number of LEDs in all the strips
+ */
+static void Print_Frame(int64_t tNow, const uint8_t *pRGB, int nLeds)
+{
+    static const int16_t aanSegmentFirst[DISPLAY_DIGITS][DIGIT_SEGMENTS] = LAYOUT_SEGMENT_FIRST_INIT;
+    rgb_t color = RGB_BLACK;
+
+    printf("%10.3f frame", tNow / 1000000.0);
+    for (int nDigit = 0; nDigit < DISPLAY_DIGITS; nDigit++)
+    {
+        uint32_t mSegments = 0;
+        int nFirst = appData.anDigitFirstLed[nDigit];
+        for (int nStrip = 0; nStrip < appData.anDigitStrip[nDigit]; nStrip++)
+        {
+            nFirst += appData.anStripLeds[nStrip];
+        }
+        for (int nSegment = 0; nSegment < DIGIT_SEGMENTS; nSegment++)
+        {
+            const uint8_t *pLed;
+
+            if (aanSegmentFirst[nDigit][nSegment] < 0)
+            {
+                continue;
+            }
+            pLed = pRGB + (nFirst + aanSegmentFirst[nDigit][nSegment]) * 3;
+            if (pLed[0] | pLed[1] | pLed[2])
+            {
+                mSegments |= (1 << nSegment);
+                color = rgb(pLed[0], pLed[1], pLed[2]);
+            }
+        }
+        printf(" %02x", (unsigned)mSegments);
+    }
+    printf(" rgb=%06x\n", (unsigned)color);
+    // How far the event shown is from the leader's, as the frame goes out
+    if (tSyncErrorMax >= 0 && appData.stateApp == APP_STATE_RUNNING && HOST_Sync_Leader_Elapsed() != INT64_MIN)
+    {
+        int64_t tError = llabs((HAL_Get_Time() - appData.tStartTime) - HOST_Sync_Leader_Elapsed());
+        if (tError > tSyncErrorMax)
+        {
+            tSyncErrorMax = tError;
+        }
+    }
+}
+/**
+ * @brief Write each block of the golden trace to the trace file
+ *
+ * @param pBlock Block that is complete
+ */
+static void Write_Trace_Block(const TRACE_BLOCK *pBlock)
+{
+    fwrite(pBlock->aBytes, 1, sizeof(pBlock->aBytes), pTraceFile);
+}
+/**
+ * @brief Print the DFPlayer commands found in the UART capture
+ *
+ */
+static void Print_UART(void)
+{
+    size_t nLength;
+    const uint8_t *pData = HOST_Get_UART_Capture(&nLength);
+
+    for (size_t n = 0; n + DFPLAYER_CMD_LENGTH <= nLength; n += DFPLAYER_CMD_LENGTH)
+    {
+        printf("dfplayer cmd=%02x param=%u\n", pData[n + 3], (pData[n + 5] << 8) | pData[n + 6]);
+    }
+}
+
+static void Usage(const char *pszName)
+{
+    fprintf(stderr,
+            "usage: %s [-t seconds] [-p start[:held]]... [-r at[:off]]... [-k at:key]...\n"
+            "       [-F start] [-J ms:ms:ppm] [-R at[:off]] [-S n] [-L file] [-b ms] [-f n] [-T file] [-q] [-v]\n"
+            "  -t  virtual seconds to run (default 60)\n"
+            "  -p  press the button at start seconds for held seconds (default 0.2)\n"
+            "  -r  reset the firmware at at seconds, or cut the power for off seconds,\n"
+            "      in time order\n"
+            "  -k  type key on the console at at seconds (h logs the timing histograms)\n"
+            "  -F  follow a simulated leader that starts its event at start seconds\n"
+            "  -J  latency and jitter of the link to the leader in ms, and its drift in ppm\n"
+            "      (default 3:4:40)\n"
+            "  -R  restart the simulated leader at at seconds, gone for off seconds (default 0.3)\n"
+            "  -S  use schedule n, stored in the mock flash as the selection\n"
+            "  -L  store the schedules blob written by schedule_pack in the mock flash\n"
+            "  -b  make every button edge bounce, flipping every ms milliseconds\n"
+            "  -f  have the DFPlayer reject every nth command\n"
+            "  -T  record the golden trace of frames, DFPlayer commands and states to file\n"
+            "  -q  only print warnings and errors from the firmware\n"
+            "  -v  print debug messages from the firmware\n",
+            pszName);
+}
+
+int main(int argc, char **argv)
+{
+    double dRunSeconds = 60;
+    const RENDER_STATS *pStats = Render_Get_Stats();
+    HOST_REBOOT aReboots[HOST_MAX_REBOOTS];
+    int nReboots = 0;
+    int64_t tRunEnd;
+    double dLatency = 3, dJitter = 4, dDrift = 40;
+    int nSchedule = 0;
+    int opt;
+
+    HOST_Reset();
+    while ((opt = getopt(argc, argv, "t:p:r:k:F:J:R:S:L:b:f:T:qvh")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            dRunSeconds = atof(optarg);
+            break;
+        case 'p':
+        {
+            double dStart = atof(optarg);
+            double dHeld = 0.2;
+            const char *pszHeld = strchr(optarg, ':');
+            if (pszHeld != NULL)
+            {
+                dHeld = atof(pszHeld + 1);
+            }
+            if (!HOST_Button_Script_Add(llround(dStart * 1000000), llround((dStart + dHeld) * 1000000)))
+            {
+                fprintf(stderr, "Too many presses\n");
+                return 1;
+            }
+            break;
+        }
+        case 'r':
+        {
+            const char *pszOff = strchr(optarg, ':');
+            if (nReboots >= HOST_MAX_REBOOTS)
+            {
+                fprintf(stderr, "Too many resets\n");
+                return 1;
+            }
+            aReboots[nReboots].tAt = llround(atof(optarg) * 1000000);
+            aReboots[nReboots].tOff = pszOff != NULL ? llround(atof(pszOff + 1) * 1000000) : -1;
+            nReboots++;
+            break;
+        }
+        case 'k':
+        {
+            const char *pszKey = strchr(optarg, ':');
+            if (pszKey == NULL || pszKey[1] == '\0' ||
+                !HOST_Console_Script_Add(llround(atof(optarg) * 1000000), pszKey[1]))
+            {
+                fprintf(stderr, "Bad or too many keys\n");
+                return 1;
+            }
+            break;
+        }
+        case 'F':
+        {
+            SYNC_CONFIG config = {.nRole = SYNC_ROLE_FOLLOWER, .nLink = HAL_LINK_SIMULATED};
+            HAL_Settings_Save(SYNC_KEY, &config, sizeof(config));
+            HOST_Sync_Leader_Start(llround(atof(optarg) * 1000000), nSchedule);
+            tSyncErrorMax = 0;
+            break;
+        }
+        case 'J':
+            sscanf(optarg, "%lf:%lf:%lf", &dLatency, &dJitter, &dDrift);
+            break;
+        case 'R':
+        {
+            const char *pszOff = strchr(optarg, ':');
+            HOST_Sync_Leader_Restart(llround(atof(optarg) * 1000000),
+                                     llround((pszOff != NULL ? atof(pszOff + 1) : 0.3) * 1000000));
+            break;
+        }
+        case 'S':
+        {
+            uint8_t nSelected = (uint8_t)atoi(optarg);
+            HAL_Settings_Save(SCHEDULE_SELECT_KEY, &nSelected, sizeof(nSelected));
+            nSchedule = nSelected;
+            break;
+        }
+        case 'L':
+        {
+            uint8_t aBlob[SCHEDULE_BLOB_SIZE];
+            FILE *pFile = fopen(optarg, "rb");
+            if (pFile == NULL || fread(aBlob, 1, sizeof(aBlob), pFile) != sizeof(aBlob))
+            {
+                fprintf(stderr, "%s is not a schedules blob\n", optarg);
+                return 1;
+            }
+            fclose(pFile);
+            HAL_Settings_Save(SCHEDULE_KEY, aBlob, sizeof(aBlob));
+            break;
+        }
+        case 'b':
+            HOST_Set_Button_Bounce((int64_t)(atof(optarg) * 1000));
+            break;
+        case 'f':
+            HOST_Set_DFPlayer_Faults(atoi(optarg));
+            break;
+        case 'T':
+            pTraceFile = fopen(optarg, "wb");
+            if (pTraceFile == NULL)
+            {
+                perror(optarg);
+                return 1;
+            }
+            Trace_Set_Sink(&Write_Trace_Block);
+            break;
+        case 'q':
+            HOST_Set_Log_Level('W');
+            break;
+        case 'v':
+            HOST_Set_Log_Level('D');
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    tRunEnd = llround(dRunSeconds * 1000000);
+    HOST_Sync_Link((int64_t)(dLatency * 1000), (int64_t)(dJitter * 1000), (int32_t)dDrift);
+    HOST_Set_Frame_Callback(&Print_Frame);
+    for (int nReboot = 0;; nReboot++)
+    {
+        const HOST_REBOOT *pReboot = nReboot < nReboots && aReboots[nReboot].tAt < tRunEnd ? &aReboots[nReboot] : NULL;
+
+        HOST_Set_Run_Time(pReboot != NULL ? pReboot->tAt : tRunEnd);
+        APP_Main();
+        // The recorder sees what was traced before the RAM is lost
+        Trace_Flush();
+        if (pReboot == NULL)
+        {
+            break;
+        }
+        if (pReboot->tOff < 0)
+        {
+            printf("%10.3f reset\n", pReboot->tAt / 1000000.0);
+        }
+        else
+        {
+            printf("%10.3f power off for %.3f\n", pReboot->tAt / 1000000.0, pReboot->tOff / 1000000.0);
+        }
+        // RAM does not survive a reset, only what the HAL keeps
+        memset(&appData, 0, sizeof(appData));
+        HOST_Reboot(pReboot->tOff >= 0, pReboot->tOff < 0 ? 0 : pReboot->tOff);
+    }
+    if (pTraceFile != NULL)
+    {
+        fclose(pTraceFile);
+    }
+    Print_UART();
+    printf("refreshes=%u scenes=%u repeated=%u frames=%u dropped=%u pixels=%llu\n",
+           (unsigned)HOST_Get_Refresh_Count(),
+           (unsigned)pStats->nScenes,
+           (unsigned)pStats->nScenesSkipped,
+           (unsigned)pStats->nFrames,
+           (unsigned)pStats->nFramesDropped,
+           (unsigned long long)pStats->nPixelsSent);
+    printf("wakeups=%u button_edges=%u\n", (unsigned)appData.nWakeups, (unsigned)appData.nButtonEdges);
+    printf("flash_writes=%u\n", (unsigned)HOST_Get_Settings_Writes());
+    if (tSyncErrorMax >= 0)
+    {
+        const SYNC_STATS *pSync = Sync_Get_Stats();
+        printf("sync_error_max_us=%lld requests=%u replies=%u slow=%u drift_ppb=%d\n", (long long)tSyncErrorMax,
+               (unsigned)pSync->nRequests, (unsigned)pSync->nReplies, (unsigned)pSync->nSlow, (int)pSync->nSkewPPB);
+    }
+    return 0;
+}
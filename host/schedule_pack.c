@@ -0,0 +1,357 @@
+/**
+ * @file schedule_pack.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Pack a text description of schedules into the stored schedules blob
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include "app.h"
+#include "schedule.h"
+
+// Longest line read from a description
+#define PACK_LINE_MAX 256
+
+/**
+ * @brief Read a number that has to be in a range.  Unlike strtoul alone
+ * this takes no sign, space or empty value, and nothing out of range.
+ *
+ * @param pszValue Text of the number
+ * @param nBase 10, or 16 for a color
+ * @param nMin Smallest value allowed
+ * @param nMax Largest value allowed
+ * @param pnValue Where to put the value
+ * @return true Read
+ * @return false Not a number, or out of range
+ */
+static bool Pack_Number(const char *pszValue, int nBase, unsigned long nMin, unsigned long nMax,
+                        unsigned long *pnValue)
+{
+    char *pszEnd;
+    unsigned long nValue;
+
+    if (!isxdigit((unsigned char)*pszValue))
+    {
+        return false;
+    }
+    errno = 0;
+    nValue = strtoul(pszValue, &pszEnd, nBase);
+    if (errno != 0 || *pszEnd != '\0' || nValue < nMin || nValue > nMax)
+    {
+        return false;
+    }
+    *pnValue = nValue;
+    return true;
+}
+
+/**
+ * @brief Read one cue: seconds, then any of track=N, color=RRGGBB,
+ * from-end and tenths
+ *
+ * @param pszArgs Rest of the cue line, split up as it is read
+ * @param pCue Where to put the cue
+ * @return true Read
+ * @return false Something on the line was not understood
+ */
+static bool Pack_Cue(char *pszArgs, SCHEDULE_CUE *pCue)
+{
+    char *pszWord = strtok(pszArgs, " \t");
+    unsigned long nValue;
+
+    memset(pCue, 0, sizeof(*pCue));
+    if (pszWord == NULL || !Pack_Number(pszWord, 10, 0, UINT16_MAX, &nValue))
+    {
+        return false;
+    }
+    pCue->nSeconds = (uint16_t)nValue;
+    while ((pszWord = strtok(NULL, " \t")) != NULL)
+    {
+        if (strncmp(pszWord, "track=", 6) == 0)
+        {
+            if (!Pack_Number(pszWord + 6, 10, 1, DFPLAYER_MAX_TRACKS - 1, &nValue))
+            {
+                return false;
+            }
+            pCue->nTrack = (uint16_t)nValue;
+        }
+        else if (strncmp(pszWord, "color=", 6) == 0)
+        {
+            if (!Pack_Number(pszWord + 6, 16, 0, 0xffffff, &nValue))
+            {
+                return false;
+            }
+            pCue->color = (uint32_t)nValue;
+        }
+        else if (strcmp(pszWord, "from-end") == 0)
+        {
+            pCue->nFlags |= SCHEDULE_FROM_END;
+        }
+        else if (strcmp(pszWord, "tenths") == 0)
+        {
+            pCue->nFlags |= SCHEDULE_TENTHS;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Read a description of schedules.  Each line is a keyword and its
+ * value, and # starts a comment:
+ *   schedule <name>     starts the next schedule
+ *   length <seconds>    length of the event, up to 65535
+ *   end-track <track>   track played at the end, 0 for none
+ *   scale <n>           minutes shown per real minute, 1 to 255, 1 unless given
+ *   cue <seconds> ...   see Pack_Cue
+ *
+ * @param pFile Description to read
+ * @param pszName File name, for errors
+ * @param pTable Where to put the schedules
+ * @return true Read
+ * @return false Not understood, the error has been reported
+ */
+static bool Pack_Read(FILE *pFile, const char *pszName, SCHEDULE_TABLE *pTable)
+{
+    char szLine[PACK_LINE_MAX];
+    SCHEDULE_DEF *pDef = NULL;
+    int nLine = 0;
+
+    memset(pTable, 0, sizeof(*pTable));
+    while (fgets(szLine, sizeof(szLine), pFile) != NULL)
+    {
+        char szArgs[PACK_LINE_MAX];
+        char *pszKey;
+        char *pszValue;
+        char *pszEnd;
+        unsigned long nValue = 0;
+        bool bOk = true;
+
+        nLine++;
+        szLine[strcspn(szLine, "#\r\n")] = '\0';
+        for (pszKey = szLine; isspace((unsigned char)*pszKey); pszKey++)
+        {
+        }
+        if (*pszKey == '\0')
+        {
+            continue;
+        }
+        for (pszValue = pszKey; *pszValue != '\0' && !isspace((unsigned char)*pszValue); pszValue++)
+        {
+        }
+        if (*pszValue != '\0')
+        {
+            *pszValue++ = '\0';
+        }
+        while (isspace((unsigned char)*pszValue))
+        {
+            pszValue++;
+        }
+        for (pszEnd = pszValue + strlen(pszValue); pszEnd > pszValue && isspace((unsigned char)pszEnd[-1]); pszEnd--)
+        {
+            pszEnd[-1] = '\0';
+        }
+        if (strcmp(pszKey, "schedule") == 0)
+        {
+            if (pTable->nSchedules == SCHEDULE_MAX)
+            {
+                fprintf(stderr, "%s:%d: more than %d schedules\n", pszName, nLine, SCHEDULE_MAX);
+                return false;
+            }
+            if (*pszValue == '\0' || strlen(pszValue) >= SCHEDULE_NAME_LENGTH)
+            {
+                fprintf(stderr, "%s:%d: the name must be 1 to %d characters\n", pszName, nLine,
+                        SCHEDULE_NAME_LENGTH - 1);
+                return false;
+            }
+            pDef = &pTable->aSchedules[pTable->nSchedules++];
+            strcpy(pDef->szName, pszValue);
+            pDef->nScale = 1;
+            continue;
+        }
+        if (pDef == NULL)
+        {
+            fprintf(stderr, "%s:%d: %s before the first schedule\n", pszName, nLine, pszKey);
+            return false;
+        }
+        if (strcmp(pszKey, "length") == 0)
+        {
+            bOk = Pack_Number(pszValue, 10, 1, UINT16_MAX, &nValue);
+            pDef->nLengthSeconds = (uint16_t)nValue;
+        }
+        else if (strcmp(pszKey, "end-track") == 0)
+        {
+            bOk = Pack_Number(pszValue, 10, 0, DFPLAYER_MAX_TRACKS - 1, &nValue);
+            pDef->nEndTrack = (uint16_t)nValue;
+        }
+        else if (strcmp(pszKey, "scale") == 0)
+        {
+            bOk = Pack_Number(pszValue, 10, 1, UINT8_MAX, &nValue);
+            pDef->nScale = (uint8_t)nValue;
+        }
+        else if (strcmp(pszKey, "cue") == 0)
+        {
+            if (pDef->nCues == SCHEDULE_MAX_CUES)
+            {
+                fprintf(stderr, "%s:%d: more than %d cues\n", pszName, nLine, SCHEDULE_MAX_CUES);
+                return false;
+            }
+            // Split up in a copy, so an error can show the whole cue
+            strcpy(szArgs, pszValue);
+            bOk = Pack_Cue(szArgs, &pDef->aCues[pDef->nCues++]);
+        }
+        else
+        {
+            bOk = false;
+        }
+        if (!bOk)
+        {
+            fprintf(stderr, "%s:%d: cannot understand %s %s\n", pszName, nLine, pszKey, pszValue);
+            return false;
+        }
+    }
+    if (pTable->nSchedules == 0)
+    {
+        fprintf(stderr, "%s: no schedules\n", pszName);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Check every schedule compiles and print its timeline
+ *
+ * @param pTable Schedules
+ * @return true All of them compile
+ * @return false One does not, the error has been reported
+ */
+static bool Pack_List(const SCHEDULE_TABLE *pTable)
+{
+    for (int nSchedule = 0; nSchedule < pTable->nSchedules; nSchedule++)
+    {
+        TIMELINE timeline;
+
+        if (!Schedule_Compile(&pTable->aSchedules[nSchedule], &timeline))
+        {
+            fprintf(stderr, "schedule %d is not valid\n", nSchedule);
+            return false;
+        }
+        printf("%d %s: %d s, scale %d\n", nSchedule, timeline.pszName, (int)timeline.nLengthSeconds,
+               timeline.nScale);
+        for (int nEntry = 0; nEntry < timeline.nEntries; nEntry++)
+        {
+            const TIMELINE_ENTRY *pEntry = &timeline.aEntries[nEntry];
+
+            printf("  %6d.%d track %2u color %06x%s%s\n", (int)(pEntry->nTenths / 10), (int)(pEntry->nTenths % 10),
+                   pEntry->nTrack, (unsigned)pEntry->color, (pEntry->nFlags & SCHEDULE_TENTHS) ? " tenths" : "",
+                   (pEntry->nFlags & SCHEDULE_END) ? " end" : "");
+        }
+    }
+    return true;
+}
+
+static void Usage(const char *pszName)
+{
+    fprintf(stderr,
+            "usage: %s description blob\n"
+            "       %s -l blob\n"
+            "  -l  list the schedules of a blob\n"
+            "Writes the %d byte blob to store as the \"%s\" setting.\n",
+            pszName, pszName, SCHEDULE_BLOB_SIZE, SCHEDULE_KEY);
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t aBlob[SCHEDULE_BLOB_SIZE];
+    SCHEDULE_TABLE table;
+    bool bList = false;
+    FILE *pFile;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "lh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'l':
+            bList = true;
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + (bList ? 1 : 2) != argc)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+    pFile = fopen(argv[optind], bList ? "rb" : "r");
+    if (pFile == NULL)
+    {
+        perror(argv[optind]);
+        return 2;
+    }
+    if (bList)
+    {
+        bool bRead = fread(aBlob, 1, sizeof(aBlob), pFile) == sizeof(aBlob) && fgetc(pFile) == EOF;
+
+        fclose(pFile);
+        if (!bRead || !Schedule_Decode(aBlob, &table))
+        {
+            fprintf(stderr, "%s: not a version %d schedules blob\n", argv[optind], SCHEDULE_VERSION);
+            return 1;
+        }
+        return Pack_List(&table) ? 0 : 1;
+    }
+    if (!Pack_Read(pFile, argv[optind], &table))
+    {
+        fclose(pFile);
+        return 1;
+    }
+    fclose(pFile);
+    if (!Pack_List(&table))
+    {
+        return 1;
+    }
+    Schedule_Encode(&table, aBlob);
+    pFile = fopen(argv[optind + 1], "wb");
+    if (pFile == NULL || fwrite(aBlob, 1, sizeof(aBlob), pFile) != sizeof(aBlob))
+    {
+        perror(argv[optind + 1]);
+        if (pFile != NULL)
+        {
+            fclose(pFile);
+        }
+        return 1;
+    }
+    return fclose(pFile) == 0 ? 0 : 1;
+}
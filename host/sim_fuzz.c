@@ -0,0 +1,557 @@
+/**
+ * @file sim_fuzz.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Randomized button gestures against the simulated timer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <time.h>
+#include <getopt.h>
+#include "app.h"
+#include "hal_host.h"
+
+#define FUZZ_MAX_GESTURES 12                     // Gestures scripted in one run
+#define FUZZ_MAX_PRESSES (FUZZ_MAX_GESTURES * 2) // A double tap is two presses
+#define FUZZ_MAX_REBOOTS 2                       // Resets or power cuts in one run
+#define FUZZ_SPIN_LIMIT 64                       // Passes at one instant that mean the app is spinning
+#define FUZZ_STATES (APP_STATE_CONFIG + 1)       // States the app can be in
+
+/**
+ * @brief Button gestures the runs are built from
+ *
+ */
+typedef enum
+{
+    FUZZ_TAP,         // A single press, from a bounce to a second and a half
+    FUZZ_DOUBLE_TAP,  // Two presses around BUTTON_DOUBLETAP_US apart
+    FUZZ_RESET_HOLD,  // A hold past BUTTON_REQUEST_RESET_US
+    FUZZ_CONFIG_HOLD, // A hold past BUTTON_REQUEST_CONFIG_US
+    FUZZ_GESTURES,
+} FUZZ_GESTURE;
+
+/**
+ * @brief A press of the button, in virtual microseconds
+ *
+ */
+typedef struct
+{
+    int64_t tPress;   // When the button goes down
+    int64_t tRelease; // When it comes back up
+} FUZZ_PRESS;
+
+/**
+ * @brief A reset or power cut of the firmware
+ *
+ */
+typedef struct
+{
+    int64_t tAt;  // Virtual time of the reset
+    int64_t tOff; // How long the power is off, -1 for a warm reset
+} FUZZ_REBOOT;
+
+/**
+ * @brief Everything a run is made from, all derived from its seed
+ *
+ */
+typedef struct
+{
+    uint64_t nSeed;                         // Seed the run was generated from
+    int64_t tRun;                           // Virtual time the run lasts
+    int nSchedule;                          // Schedule selected in the mock flash
+    FUZZ_PRESS aPresses[FUZZ_MAX_PRESSES];  // Presses, in time order
+    int nPresses;                           // Number of presses
+    FUZZ_REBOOT aReboots[FUZZ_MAX_REBOOTS]; // Resets, in time order
+    int nReboots;                           // Number of resets
+} FUZZ_RUN;
+
+/**
+ * @brief What the checks remember from one pass of the app to the next
+ *
+ */
+typedef struct
+{
+    APP_STATES statePrev;   // State after the last pass
+    uint32_t nChangesPrev;  // appData.nStateChanges after the last pass
+    int64_t tPressPrev;     // appData.tButtonPress after the last pass
+    int64_t tReleasePrev;   // appData.tButtonRelease after the last pass
+    int nCursorPrev;        // appData.nCursor after the last pass
+    int64_t tLastPass;      // Time of the last pass
+    int nPassesAtTime;      // Passes in a row at tLastPass
+    int64_t tBoot;          // Virtual time the firmware last started
+    const char *pszFailure; // Why the run failed, NULL while it has not
+    int64_t tFailure;       // Virtual time of the failure
+} FUZZ_CHECK;
+
+/**
+ * @brief Totals over all the runs
+ *
+ */
+typedef struct
+{
+    uint64_t nRuns;                                    // Runs made
+    uint64_t nFailures;                                // Runs that failed a check
+    uint64_t nPasses;                                  // Passes of APP_Tasks checked
+    int64_t tVirtual;                                  // Virtual time simulated
+    uint32_t aanTransitions[FUZZ_STATES][FUZZ_STATES]; // State changes seen, from and to
+} FUZZ_STATS;
+
+static const char *apszStates[FUZZ_STATES] = {"CODEBUSTERS", "WAIT_START", "RUNNING", "DONE", "CONFIG"};
+static FUZZ_STATS fuzzStats;
+static bool bVerbose;
+
+/**
+ * @brief Next number from a splitmix64 generator
+ *
+ * @param pnState Generator state, advanced
+ * @return uint64_t Random number
+ */
+static uint64_t Fuzz_Random(uint64_t *pnState)
+{
+    uint64_t n = (*pnState += 0x9e3779b97f4a7c15ull);
+
+    n = (n ^ (n >> 30)) * 0xbf58476d1ce4e5b9ull;
+    n = (n ^ (n >> 27)) * 0x94d049bb133111ebull;
+    return n ^ (n >> 31);
+}
+/**
+ * @brief Random number in a range
+ *
+ * @param pnState Generator state, advanced
+ * @param nLow Smallest value
+ * @param nHigh Largest value
+ * @return int64_t Value from nLow to nHigh
+ */
+static int64_t Fuzz_Range(uint64_t *pnState, int64_t nLow, int64_t nHigh)
+{
+    return nLow + (int64_t)(Fuzz_Random(pnState) % (uint64_t)(nHigh - nLow + 1));
+}
+/**
+ * @brief Random time in whole milliseconds, so the run can be replayed
+ * with the options of cbtimer_host
+ *
+ * @param pnState Generator state, advanced
+ * @param tLow Shortest time in microseconds
+ * @param tHigh Longest time in microseconds
+ * @return int64_t Time in microseconds
+ */
+static int64_t Fuzz_Time(uint64_t *pnState, int64_t tLow, int64_t tHigh)
+{
+    return Fuzz_Range(pnState, tLow / 1000, tHigh / 1000) * 1000;
+}
+/**
+ * @brief Script a press, unless the run is already full or over
+ *
+ * @param pRun Run being built
+ * @param tPress When the button goes down
+ * @param tHeld How long it stays down
+ * @return int64_t When the button comes back up
+ */
+static int64_t Fuzz_Add_Press(FUZZ_RUN *pRun, int64_t tPress, int64_t tHeld)
+{
+    if (pRun->nPresses < FUZZ_MAX_PRESSES && tPress < pRun->tRun)
+    {
+        pRun->aPresses[pRun->nPresses].tPress = tPress;
+        pRun->aPresses[pRun->nPresses].tRelease = tPress + tHeld;
+        pRun->nPresses++;
+    }
+    return tPress + tHeld;
+}
+/**
+ * @brief Build a run from its seed.  Gestures follow each other with gaps
+ * that are as often shorter than the double tap window as they are long
+ * enough for the event to move on, and some runs are reset part way.
+ *
+ * @param nSeed Seed of the run
+ * @param tRun Virtual time the run lasts
+ * @param nSchedules Schedules there are to choose from
+ * @param pRun Where to put the run
+ */
+static void Fuzz_Generate(uint64_t nSeed, int64_t tRun, int nSchedules, FUZZ_RUN *pRun)
+{
+    uint64_t nState = nSeed;
+    int64_t tAt = Fuzz_Time(&nState, 0, 3000000);
+    int nGestures = (int)Fuzz_Range(&nState, 1, FUZZ_MAX_GESTURES);
+
+    memset(pRun, 0, sizeof(*pRun));
+    pRun->nSeed = nSeed;
+    pRun->tRun = tRun;
+    pRun->nSchedule = (int)Fuzz_Range(&nState, 0, nSchedules - 1);
+    for (int nGesture = 0; nGesture < nGestures && tAt < tRun; nGesture++)
+    {
+        switch ((FUZZ_GESTURE)Fuzz_Range(&nState, 0, FUZZ_GESTURES - 1))
+        {
+        case FUZZ_TAP:
+            tAt = Fuzz_Add_Press(pRun, tAt, Fuzz_Time(&nState, 5000, 1500000));
+            break;
+        case FUZZ_DOUBLE_TAP:
+            tAt = Fuzz_Add_Press(pRun, tAt, Fuzz_Time(&nState, 5000, 300000));
+            tAt += Fuzz_Time(&nState, 5000, BUTTON_DOUBLETAP_US + 50000);
+            tAt = Fuzz_Add_Press(pRun, tAt, Fuzz_Time(&nState, 5000, 300000));
+            break;
+        case FUZZ_RESET_HOLD:
+            tAt = Fuzz_Add_Press(pRun, tAt, Fuzz_Time(&nState, BUTTON_REQUEST_RESET_US - 100000,
+                                                     BUTTON_REQUEST_CONFIG_US - 1000));
+            break;
+        default:
+            tAt = Fuzz_Add_Press(pRun, tAt, Fuzz_Time(&nState, BUTTON_REQUEST_CONFIG_US - 100000,
+                                                     BUTTON_REQUEST_CONFIG_US + 3000000));
+            break;
+        }
+        if (Fuzz_Range(&nState, 0, 1) == 0)
+        {
+            tAt += Fuzz_Time(&nState, 5000, 500000);
+        }
+        else
+        {
+            tAt += Fuzz_Time(&nState, 500000, tRun / 4);
+        }
+    }
+    if (Fuzz_Range(&nState, 0, 3) == 0)
+    {
+        int64_t tFrom = 0;
+
+        pRun->nReboots = (int)Fuzz_Range(&nState, 1, FUZZ_MAX_REBOOTS);
+        for (int nReboot = 0; nReboot < pRun->nReboots; nReboot++)
+        {
+            FUZZ_REBOOT *pReboot = &pRun->aReboots[nReboot];
+
+            pReboot->tAt = Fuzz_Time(&nState, tFrom, tRun - 1000);
+            pReboot->tOff = Fuzz_Range(&nState, 0, 1) == 0 ? -1 : Fuzz_Time(&nState, 0, 60000000);
+            tFrom = pReboot->tAt;
+        }
+    }
+}
+/**
+ * @brief Print the cbtimer_host options that replay a run
+ *
+ * @param pRun Run to replay
+ */
+static void Fuzz_Print_Replay(const FUZZ_RUN *pRun)
+{
+    printf("  replay: cbtimer_host -t %.3f -S %d", pRun->tRun / 1000000.0, pRun->nSchedule);
+    for (int n = 0; n < pRun->nPresses; n++)
+    {
+        printf(" -p %.3f:%.3f", pRun->aPresses[n].tPress / 1000000.0,
+               (pRun->aPresses[n].tRelease - pRun->aPresses[n].tPress) / 1000000.0);
+    }
+    for (int n = 0; n < pRun->nReboots; n++)
+    {
+        printf(" -r %.3f", pRun->aReboots[n].tAt / 1000000.0);
+        if (pRun->aReboots[n].tOff >= 0)
+        {
+            printf(":%.3f", pRun->aReboots[n].tOff / 1000000.0);
+        }
+    }
+    printf("\n");
+}
+/**
+ * @brief Work out whether a change of state is one the gestures or the
+ * timeline can make
+ *
+ * @param pCheck What the last pass left
+ * @param stateNew State the app is in now
+ * @return const char* Why the change is wrong, NULL when it is allowed
+ */
+static const char *Fuzz_Check_Transition(const FUZZ_CHECK *pCheck, APP_STATES stateNew)
+{
+    bool bNewPress = appData.tButtonPress != pCheck->tPressPrev;
+    int64_t tHeld = appData.tNow - appData.tButtonPress;
+
+    switch (stateNew)
+    {
+    case APP_STATE_DONE:
+        if (pCheck->statePrev == APP_STATE_RUNNING && appData.nCursor >= appData.pTimeline->nEntries)
+        {
+            return NULL;
+        }
+        if (bNewPress && pCheck->statePrev != APP_STATE_CONFIG &&
+            appData.tButtonPress - pCheck->tReleasePrev < BUTTON_DOUBLETAP_US)
+        {
+            return NULL;
+        }
+        return "ended without a double tap or the end of the timeline";
+    case APP_STATE_RUNNING:
+        return (pCheck->statePrev == APP_STATE_WAIT_START && bNewPress) ? NULL : "started without a press while waiting";
+    case APP_STATE_WAIT_START:
+        return tHeld >= BUTTON_REQUEST_RESET_US ? NULL : "went back to waiting without a long hold";
+    case APP_STATE_CONFIG:
+        return (tHeld >= BUTTON_REQUEST_CONFIG_US && appData.stateAtPress == APP_STATE_CODEBUSTERS)
+                   ? NULL
+                   : "entered the configuration without a hold from the logo";
+    case APP_STATE_CODEBUSTERS:
+        return (pCheck->statePrev == APP_STATE_DONE && bNewPress) ? NULL : "went to the logo without a press when done";
+    }
+    return "state out of range";
+}
+/**
+ * @brief Check the app after a pass of APP_Tasks
+ *
+ * @param pCheck What the last pass left, updated
+ * @return true Everything holds
+ * @return false A check failed, pCheck says which
+ */
+static bool Fuzz_Check(FUZZ_CHECK *pCheck)
+{
+    APP_STATES state = appData.stateApp;
+    const char *pszFailure = NULL;
+
+    fuzzStats.nPasses++;
+    if (appData.tNow == pCheck->tLastPass)
+    {
+        if (++pCheck->nPassesAtTime > FUZZ_SPIN_LIMIT)
+        {
+            pszFailure = "spinning without the time moving";
+        }
+    }
+    else
+    {
+        pCheck->tLastPass = appData.tNow;
+        pCheck->nPassesAtTime = 0;
+    }
+    if ((unsigned)state >= FUZZ_STATES)
+    {
+        pszFailure = "state out of range";
+    }
+    else if (state == APP_STATE_RUNNING && appData.nCursor >= appData.pTimeline->nEntries)
+    {
+        pszFailure = "still running past the end of the timeline";
+    }
+    else if (state == APP_STATE_RUNNING && pCheck->statePrev == APP_STATE_RUNNING &&
+             appData.nStateChanges == pCheck->nChangesPrev && appData.nCursor < pCheck->nCursorPrev)
+    {
+        pszFailure = "timeline went backwards";
+    }
+    else if (state != pCheck->statePrev)
+    {
+        if (pszFailure == NULL)
+        {
+            pszFailure = Fuzz_Check_Transition(pCheck, state);
+        }
+        fuzzStats.aanTransitions[pCheck->statePrev][state]++;
+        if (bVerbose)
+        {
+            printf("%10.3f %s -> %s\n", (pCheck->tBoot + appData.tNow) / 1000000.0, apszStates[pCheck->statePrev], apszStates[state]);
+        }
+    }
+    pCheck->statePrev = state;
+    pCheck->nChangesPrev = appData.nStateChanges;
+    pCheck->tPressPrev = appData.tButtonPress;
+    pCheck->tReleasePrev = appData.tButtonRelease;
+    pCheck->nCursorPrev = appData.nCursor;
+    if (pszFailure != NULL)
+    {
+        pCheck->pszFailure = pszFailure;
+        pCheck->tFailure = pCheck->tBoot + appData.tNow;
+        return false;
+    }
+    return true;
+}
+/**
+ * @brief Boot the firmware and run its loop, as APP_Main does, checking
+ * the app after every pass until the run time
+ *
+ * @param pCheck Checks carried through the run
+ * @return true Every check held
+ * @return false A check failed
+ */
+static bool Fuzz_Boot(FUZZ_CHECK *pCheck)
+{
+    int64_t tDeadline;
+
+    HW_Initialize();
+    APP_Initialize();
+    pCheck->statePrev = appData.stateApp;
+    pCheck->nChangesPrev = appData.nStateChanges;
+    pCheck->tPressPrev = appData.tButtonPress;
+    pCheck->tReleasePrev = appData.tButtonRelease;
+    pCheck->nCursorPrev = appData.nCursor;
+    pCheck->tLastPass = -1;
+    pCheck->nPassesAtTime = 0;
+    tDeadline = HAL_Get_Time();
+    while (HAL_Wait_Until(tDeadline))
+    {
+        tDeadline = APP_Tasks();
+        if (!Fuzz_Check(pCheck))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+/**
+ * @brief Make one run from a clean mock board
+ *
+ * @param pRun Run to make
+ * @param pCheck Checks carried through the run
+ * @return true Every check held
+ * @return false A check failed
+ */
+static bool Fuzz_Run(const FUZZ_RUN *pRun, FUZZ_CHECK *pCheck)
+{
+    uint8_t nSelected = (uint8_t)pRun->nSchedule;
+
+    HOST_Reset();
+    HOST_Settings_Erase();
+    memset(&appData, 0, sizeof(appData));
+    HAL_Settings_Save(SCHEDULE_SELECT_KEY, &nSelected, sizeof(nSelected));
+    for (int n = 0; n < pRun->nPresses; n++)
+    {
+        HOST_Button_Script_Add(pRun->aPresses[n].tPress, pRun->aPresses[n].tRelease);
+    }
+    for (int nReboot = 0;; nReboot++)
+    {
+        const FUZZ_REBOOT *pReboot = nReboot < pRun->nReboots ? &pRun->aReboots[nReboot] : NULL;
+
+        HOST_Set_Run_Time(pReboot != NULL ? pReboot->tAt : pRun->tRun);
+        if (!Fuzz_Boot(pCheck))
+        {
+            return false;
+        }
+        if (pReboot == NULL)
+        {
+            return true;
+        }
+        if (bVerbose)
+        {
+            printf("%10.3f %s\n", pReboot->tAt / 1000000.0, pReboot->tOff < 0 ? "reset" : "power off");
+        }
+        // RAM does not survive a reset, only what the HAL keeps
+        memset(&appData, 0, sizeof(appData));
+        HOST_Reboot(pReboot->tOff >= 0, pReboot->tOff < 0 ? 0 : pReboot->tOff);
+        pCheck->tBoot = pReboot->tAt + (pReboot->tOff < 0 ? 0 : pReboot->tOff);
+    }
+}
+
+static int64_t Now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void Usage(const char *pszName)
+{
+    fprintf(stderr,
+            "usage: %s [-n runs] [-s seed] [-t seconds] [-m failures] [-r] [-v]\n"
+            "  -n  runs to make (default 10000)\n"
+            "  -s  seed of the first run, each run after it adds one (default 1)\n"
+            "  -t  virtual seconds each run lasts (default 120)\n"
+            "  -m  stop after this many failing runs (default 10)\n"
+            "  -r  run the compositor too, composing every frame\n"
+            "  -v  print the state changes of every run\n",
+            pszName);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t nRuns = 10000;
+    uint64_t nSeed = 1;
+    double dRunSeconds = 120;
+    bool bRender = false;
+    uint64_t nMaxFailures = 10;
+    int nSchedules;
+    int nTransitions = 0;
+    int64_t tStart;
+    double dSeconds;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:t:m:rvh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            nRuns = strtoull(optarg, NULL, 0);
+            break;
+        case 's':
+            nSeed = strtoull(optarg, NULL, 0);
+            break;
+        case 't':
+            dRunSeconds = atof(optarg);
+            break;
+        case 'm':
+            nMaxFailures = strtoull(optarg, NULL, 0);
+            break;
+        case 'r':
+            bRender = true;
+            break;
+        case 'v':
+            bVerbose = true;
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    HOST_Set_Log_Level('N');
+    HOST_Set_Render(bRender);
+    HOST_Reset();
+    HOST_Settings_Erase();
+    Schedule_Initialize();
+    nSchedules = Schedule_Count();
+    tStart = Now_ns();
+    for (uint64_t nRun = 0; nRun < nRuns && fuzzStats.nFailures < nMaxFailures; nRun++)
+    {
+        FUZZ_RUN run;
+        FUZZ_CHECK check = {0};
+
+        Fuzz_Generate(nSeed + nRun, (int64_t)(dRunSeconds * 1000000), nSchedules, &run);
+        if (bVerbose)
+        {
+            printf("seed %llu\n", (unsigned long long)run.nSeed);
+        }
+        fuzzStats.nRuns++;
+        fuzzStats.tVirtual += run.tRun;
+        if (!Fuzz_Run(&run, &check))
+        {
+            fuzzStats.nFailures++;
+            printf("seed %llu failed at %.3f: %s (state %s)\n", (unsigned long long)run.nSeed,
+                   check.tFailure / 1000000.0, check.pszFailure, apszStates[check.statePrev]);
+            Fuzz_Print_Replay(&run);
+        }
+    }
+    dSeconds = (Now_ns() - tStart) / 1e9;
+    for (int nFrom = 0; nFrom < FUZZ_STATES; nFrom++)
+    {
+        for (int nTo = 0; nTo < FUZZ_STATES; nTo++)
+        {
+            if (fuzzStats.aanTransitions[nFrom][nTo] != 0)
+            {
+                printf("  %-11s -> %-11s %10llu\n", apszStates[nFrom], apszStates[nTo],
+                       (unsigned long long)fuzzStats.aanTransitions[nFrom][nTo]);
+                nTransitions++;
+            }
+        }
+    }
+    printf("runs=%llu failures=%llu passes=%llu transitions=%d virtual_hours=%.1f runs_per_second=%.0f\n",
+           (unsigned long long)fuzzStats.nRuns, (unsigned long long)fuzzStats.nFailures,
+           (unsigned long long)fuzzStats.nPasses, nTransitions, fuzzStats.tVirtual / 3.6e9,
+           fuzzStats.nRuns / dSeconds);
+    return fuzzStats.nFailures != 0 ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+# Follow a simulated leader with cbtimer_host and check the worst error of
+# the followed event against the leader's.
+#   cmake -DHOST=<cbtimer_host> -DHOST_OPTIONS="<options>" -DMAX_ERROR_US=<us> -P sync_test.cmake
+# Fails when the run fails or the error goes over MAX_ERROR_US.
+
+separate_arguments(HOST_OPTIONS UNIX_COMMAND "${HOST_OPTIONS}")
+
+execute_process(
+    COMMAND "${HOST}" ${HOST_OPTIONS} -q
+    OUTPUT_VARIABLE HOST_OUTPUT
+    ERROR_QUIET
+    RESULT_VARIABLE HOST_RESULT
+)
+if(NOT HOST_RESULT EQUAL 0)
+    message(FATAL_ERROR "cbtimer_host ${HOST_OPTIONS} failed: ${HOST_RESULT}")
+endif()
+
+string(REGEX MATCH "sync_error_max_us=([0-9]+)[^\n]*" SYNC_LINE "${HOST_OUTPUT}")
+if(NOT SYNC_LINE)
+    message(FATAL_ERROR "cbtimer_host ${HOST_OPTIONS} printed no sync error")
+endif()
+message(STATUS "${SYNC_LINE}")
+if(CMAKE_MATCH_1 GREATER MAX_ERROR_US)
+    message(FATAL_ERROR "Followed the leader to within ${CMAKE_MATCH_1} us, more than ${MAX_ERROR_US} us")
+endif()
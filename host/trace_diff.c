@@ -0,0 +1,363 @@
+/**
+ * @file trace_diff.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Compare two golden traces and report where they first differ
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <getopt.h>
+#include "app.h"
+
+// Longest console line read from a dump
+#define DIFF_LINE_MAX 1024
+
+/**
+ * @brief Records of one stream read from a trace but not compared yet
+ *
+ */
+typedef struct
+{
+    TRACE_RECORD *aRecords; // Records waiting, from nFirst to nCount
+    size_t nFirst;          // First record waiting
+    size_t nCount;          // Records read into aRecords
+    size_t nRoom;           // Room in aRecords
+} DIFF_QUEUE;
+
+/**
+ * @brief A trace being read, either a file written by cbtimer_host -T or
+ * a console capture holding the TRACE lines of a dump
+ *
+ */
+typedef struct
+{
+    const char *pszName;                // File name, for the report
+    FILE *pFile;                        // Open file
+    bool bText;                         // A console capture rather than raw blocks
+    bool bEnd;                          // Nothing more to read
+    DIFF_QUEUE aQueues[TRACE_STREAMS];  // Records read for each stream
+    uint64_t anCompared[TRACE_STREAMS]; // Records of each stream compared so far
+} DIFF_TRACE;
+
+static const char *apszStreams[TRACE_STREAMS] = {"frame", "dfplayer", "state"};
+
+/**
+ * @brief Open a trace and work out what kind it is
+ *
+ * @param pTrace Trace to open
+ * @param pszName File to read
+ * @return true Opened
+ * @return false It could not be read
+ */
+static bool Diff_Open(DIFF_TRACE *pTrace, const char *pszName)
+{
+    int ch;
+
+    memset(pTrace, 0, sizeof(*pTrace));
+    pTrace->pszName = pszName;
+    pTrace->pFile = fopen(pszName, "rb");
+    if (pTrace->pFile == NULL)
+    {
+        perror(pszName);
+        return false;
+    }
+    ch = fgetc(pTrace->pFile);
+    pTrace->bText = ch != TRACE_MAGIC;
+    if (ch != EOF)
+    {
+        ungetc(ch, pTrace->pFile);
+    }
+    return true;
+}
+/**
+ * @brief Close a trace and free what was queued
+ *
+ * @param pTrace Trace to close
+ */
+static void Diff_Close(DIFF_TRACE *pTrace)
+{
+    for (int nStream = 0; nStream < TRACE_STREAMS; nStream++)
+    {
+        free(pTrace->aQueues[nStream].aRecords);
+    }
+    fclose(pTrace->pFile);
+}
+/**
+ * @brief Read the next block of a trace
+ *
+ * @param pTrace Trace to read
+ * @param pBlock Returns the block
+ * @return true Read
+ * @return false There are no more
+ */
+static bool Diff_Read_Block(DIFF_TRACE *pTrace, TRACE_BLOCK *pBlock)
+{
+    char szLine[DIFF_LINE_MAX];
+
+    if (!pTrace->bText)
+    {
+        return fread(pBlock->aBytes, 1, sizeof(pBlock->aBytes), pTrace->pFile) == sizeof(pBlock->aBytes);
+    }
+    while (fgets(szLine, sizeof(szLine), pTrace->pFile) != NULL)
+    {
+        if (Trace_Parse_Line(szLine, pBlock))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+/**
+ * @brief Get the next record of a stream, reading on until one turns up
+ * and queueing the records of the other streams read on the way
+ *
+ * @param pTrace Trace to read
+ * @param nStream Stream wanted
+ * @return const TRACE_RECORD* Next record, NULL at the end of the stream
+ */
+static const TRACE_RECORD *Diff_Peek(DIFF_TRACE *pTrace, int nStream)
+{
+    DIFF_QUEUE *pQueue = &pTrace->aQueues[nStream];
+
+    while (pQueue->nFirst == pQueue->nCount && !pTrace->bEnd)
+    {
+        TRACE_BLOCK block;
+        TRACE_RECORD aRecords[TRACE_BLOCK_RECORDS];
+        DIFF_QUEUE *pInto;
+        int nRecords;
+
+        if (!Diff_Read_Block(pTrace, &block))
+        {
+            pTrace->bEnd = true;
+            break;
+        }
+        nRecords = Trace_Decode(&block, aRecords, TRACE_BLOCK_RECORDS);
+        if (nRecords < 0)
+        {
+            fprintf(stderr, "%s: bad block skipped\n", pTrace->pszName);
+            continue;
+        }
+        if (nRecords == 0)
+        {
+            continue;
+        }
+        pInto = &pTrace->aQueues[aRecords[0].nStream];
+        // Move what is waiting to the front before growing
+        if (pInto->nFirst != 0)
+        {
+            memmove(pInto->aRecords, &pInto->aRecords[pInto->nFirst],
+                    (pInto->nCount - pInto->nFirst) * sizeof(TRACE_RECORD));
+            pInto->nCount -= pInto->nFirst;
+            pInto->nFirst = 0;
+        }
+        if (pInto->nCount + nRecords > pInto->nRoom)
+        {
+            pInto->nRoom = (pInto->nCount + nRecords) * 2;
+            pInto->aRecords = realloc(pInto->aRecords, pInto->nRoom * sizeof(TRACE_RECORD));
+            if (pInto->aRecords == NULL)
+            {
+                fprintf(stderr, "Out of memory\n");
+                exit(2);
+            }
+        }
+        memcpy(&pInto->aRecords[pInto->nCount], aRecords, nRecords * sizeof(TRACE_RECORD));
+        pInto->nCount += nRecords;
+    }
+    return pQueue->nFirst < pQueue->nCount ? &pQueue->aRecords[pQueue->nFirst] : NULL;
+}
+/**
+ * @brief Move past the next record of a stream
+ *
+ * @param pTrace Trace read
+ * @param nStream Stream to move on
+ */
+static void Diff_Pop(DIFF_TRACE *pTrace, int nStream)
+{
+    pTrace->aQueues[nStream].nFirst++;
+    pTrace->anCompared[nStream]++;
+}
+/**
+ * @brief Print a record of a trace, or that the trace has run out
+ *
+ * @param pszLabel What the line is
+ * @param pRecord Record to print, NULL at the end of the stream
+ */
+static void Diff_Print(const char *pszLabel, const TRACE_RECORD *pRecord)
+{
+    char szText[TRACE_TEXT_MAX];
+
+    if (pRecord == NULL)
+    {
+        printf("  %-9s (end of stream)\n", pszLabel);
+        return;
+    }
+    Trace_Format(pRecord, szText, sizeof(szText));
+    printf("  %-9s %s\n", pszLabel, szText);
+}
+/**
+ * @brief Print every record of a trace, stream by stream
+ *
+ * @param pTrace Trace to print
+ */
+static void Diff_List(DIFF_TRACE *pTrace)
+{
+    char szText[TRACE_TEXT_MAX];
+
+    for (int nStream = 0; nStream < TRACE_STREAMS; nStream++)
+    {
+        const TRACE_RECORD *pRecord;
+
+        while ((pRecord = Diff_Peek(pTrace, nStream)) != NULL)
+        {
+            Trace_Format(pRecord, szText, sizeof(szText));
+            printf("%s\n", szText);
+            Diff_Pop(pTrace, nStream);
+        }
+    }
+}
+/**
+ * @brief Walk two traces together in time order and report the first
+ * record that differs, so it is the earliest divergence whichever stream
+ * it is in
+ *
+ * @param pExpected Known good trace
+ * @param pActual Trace to check
+ * @param tTolerance Microseconds the times may differ by
+ * @return true The traces match
+ * @return false They differ, and where has been printed
+ */
+static bool Diff_Compare(DIFF_TRACE *pExpected, DIFF_TRACE *pActual, int64_t tTolerance)
+{
+    for (;;)
+    {
+        const TRACE_RECORD *pRecordExpected;
+        const TRACE_RECORD *pRecordActual;
+        int nStream = -1;
+        int64_t tFirst = INT64_MAX;
+
+        for (int n = 0; n < TRACE_STREAMS; n++)
+        {
+            const TRACE_RECORD *pHeadExpected = Diff_Peek(pExpected, n);
+            const TRACE_RECORD *pHeadActual = Diff_Peek(pActual, n);
+
+            if (pHeadExpected != NULL && pHeadExpected->tTime < tFirst)
+            {
+                tFirst = pHeadExpected->tTime;
+                nStream = n;
+            }
+            if (pHeadActual != NULL && pHeadActual->tTime < tFirst)
+            {
+                tFirst = pHeadActual->tTime;
+                nStream = n;
+            }
+        }
+        if (nStream < 0)
+        {
+            break;
+        }
+        pRecordExpected = Diff_Peek(pExpected, nStream);
+        pRecordActual = Diff_Peek(pActual, nStream);
+        if (pRecordExpected == NULL || pRecordActual == NULL || pRecordExpected->nCode != pRecordActual->nCode ||
+            pRecordExpected->nValue != pRecordActual->nValue ||
+            llabs(pRecordExpected->tTime - pRecordActual->tTime) > tTolerance)
+        {
+            printf("first difference in the %s stream, record %llu:\n", apszStreams[nStream],
+                   (unsigned long long)pExpected->anCompared[nStream]);
+            Diff_Print(pExpected->pszName, pRecordExpected);
+            Diff_Print(pActual->pszName, pRecordActual);
+            return false;
+        }
+        Diff_Pop(pExpected, nStream);
+        Diff_Pop(pActual, nStream);
+    }
+    printf("traces match: %llu frames, %llu dfplayer commands, %llu state changes\n",
+           (unsigned long long)pExpected->anCompared[TRACE_STREAM_FRAME],
+           (unsigned long long)pExpected->anCompared[TRACE_STREAM_AUDIO],
+           (unsigned long long)pExpected->anCompared[TRACE_STREAM_STATE]);
+    return true;
+}
+
+static void Usage(const char *pszName)
+{
+    fprintf(stderr,
+            "usage: %s [-t us] expected actual\n"
+            "       %s -l trace\n"
+            "  -t  allow the times to differ by this many microseconds (default 0)\n"
+            "  -l  list the records of a trace\n"
+            "Each trace is a file written by cbtimer_host -T or a console capture with a dump.\n",
+            pszName, pszName);
+}
+
+int main(int argc, char **argv)
+{
+    DIFF_TRACE expected;
+    DIFF_TRACE actual;
+    int64_t tTolerance = 0;
+    bool bList = false;
+    bool bMatch;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:lh")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            tTolerance = atoll(optarg);
+            break;
+        case 'l':
+            bList = true;
+            break;
+        default:
+            Usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (optind + (bList ? 1 : 2) != argc)
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+    if (!Diff_Open(&expected, argv[optind]))
+    {
+        return 2;
+    }
+    if (bList)
+    {
+        Diff_List(&expected);
+        Diff_Close(&expected);
+        return 0;
+    }
+    if (!Diff_Open(&actual, argv[optind + 1]))
+    {
+        Diff_Close(&expected);
+        return 2;
+    }
+    bMatch = Diff_Compare(&expected, &actual, tTolerance);
+    Diff_Close(&expected);
+    Diff_Close(&actual);
+    return bMatch ? 0 : 1;
+}
@@ -35,84 +35,99 @@ static const char *TAG = "app";
 
 APP_DATA appData;
 /**
- * @brief Return which Segments correspond to a given letter
- *
- * @param nVal Letter/value to look up
- * @return uint32_t Mask of segments to turn on
- */
-uint32_t Get_Segment_Mask(int nVal)
-{
-    switch (nVal)
-    {
-    case 0:
-    case 'O':
-    case 'o':
-        return (SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F);
-    case 1:
-        return (SEG_B | SEG_C);
-    case 2:
-        return (SEG_A | SEG_B | SEG_D | SEG_E | SEG_G);
-    case 3:
-        return (SEG_A | SEG_B | SEG_C | SEG_D | SEG_G);
-    case 4:
-        return (SEG_B | SEG_C | SEG_F | SEG_G);
-    case 5:
-    case 'S':
-    case 's':
-        return (SEG_A | SEG_C | SEG_D | SEG_F | SEG_G);
-    case 6:
-        return (SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G);
-    case 7:
-    case 'T':
-    case 't':
-        return (SEG_A | SEG_B | SEG_C);
-    case 8:
-        return (SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G);
-    case 9:
-    case 'g':
-    case 'G':
-        return (SEG_A | SEG_B | SEG_C | SEG_D | SEG_F | SEG_G);
-    case 10:
-    case 'A':
-    case 'a':
-        return (SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G);
-    case 11:
-    case 'B':
-    case 'b':
-        return (SEG_C | SEG_D | SEG_E | SEG_F | SEG_G);
-    case 12:
-    case 'C':
-    case 'c':
-        return (SEG_A | SEG_D | SEG_E | SEG_F);
-    case 13:
-    case 'D':
-    case 'd':
-        return (SEG_B | SEG_C | SEG_D | SEG_E | SEG_G);
-    case 14:
-    case 'E':
-    case 'e':
-        return (SEG_A | SEG_D | SEG_E | SEG_F | SEG_G);
-    case 15:
-    case 'F':
-    case 'f':
-        return (SEG_A | SEG_E | SEG_F | SEG_G);
-    case 'R':
-    case 'r':
-        return (SEG_E | SEG_G);
-    case 'u':
-        return (SEG_C | SEG_D | SEG_E);
-    case 'U':
-        return (SEG_B | SEG_C | SEG_D | SEG_E | SEG_F);
-    case '^':
-        return SEG_A;
-    case ' ':
-        return 0;
-    case '.':
-        return SEG_DOT;
-    case '?':
-    default:
-        return (SEG_A | SEG_B | SEG_E | SEG_G | SEG_DOT);
+ * @brief Segments for each of the hex digits
+ */
+#define GLYPH_0 (SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F)
+#define GLYPH_1 (SEG_B | SEG_C)
+#define GLYPH_2 (SEG_A | SEG_B | SEG_D | SEG_E | SEG_G)
+#define GLYPH_3 (SEG_A | SEG_B | SEG_C | SEG_D | SEG_G)
+#define GLYPH_4 (SEG_B | SEG_C | SEG_F | SEG_G)
+#define GLYPH_5 (SEG_A | SEG_C | SEG_D | SEG_F | SEG_G)
+#define GLYPH_6 (SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G)
+#define GLYPH_7 (SEG_A | SEG_B | SEG_C)
+#define GLYPH_8 (SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G)
+#define GLYPH_9 (SEG_A | SEG_B | SEG_C | SEG_D | SEG_F | SEG_G)
+#define GLYPH_A (SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G)
+#define GLYPH_B (SEG_C | SEG_D | SEG_E | SEG_F | SEG_G)
+#define GLYPH_C (SEG_A | SEG_D | SEG_E | SEG_F)
+#define GLYPH_D (SEG_B | SEG_C | SEG_D | SEG_E | SEG_G)
+#define GLYPH_E (SEG_A | SEG_D | SEG_E | SEG_F | SEG_G)
+#define GLYPH_F (SEG_A | SEG_E | SEG_F | SEG_G)
+
+/**
+ * @brief Segments for the numeric values 0-15
+ */
+const uint8_t amDigitGlyphs[16] = {
+    GLYPH_0, GLYPH_1, GLYPH_2, GLYPH_3, GLYPH_4, GLYPH_5, GLYPH_6, GLYPH_7,
+    GLYPH_8, GLYPH_9, GLYPH_A, GLYPH_B, GLYPH_C, GLYPH_D, GLYPH_E, GLYPH_F};
+
+/**
+ * @brief Segments for every character.  Anything without a glyph of its own
+ * shows GLYPH_UNKNOWN, so the range initializer comes first and the
+ * individual characters override it.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+const uint8_t amCharGlyphs[256] = {
+    [0 ... 255] = GLYPH_UNKNOWN,
+    ['0'] = GLYPH_0,
+    ['1'] = GLYPH_1,
+    ['2'] = GLYPH_2,
+    ['3'] = GLYPH_3,
+    ['4'] = GLYPH_4,
+    ['5'] = GLYPH_5,
+    ['6'] = GLYPH_6,
+    ['7'] = GLYPH_7,
+    ['8'] = GLYPH_8,
+    ['9'] = GLYPH_9,
+    ['O'] = GLYPH_0,
+    ['o'] = GLYPH_0,
+    ['S'] = GLYPH_5,
+    ['s'] = GLYPH_5,
+    ['T'] = GLYPH_7,
+    ['t'] = GLYPH_7,
+    ['G'] = GLYPH_9,
+    ['g'] = GLYPH_9,
+    ['A'] = GLYPH_A,
+    ['a'] = GLYPH_A,
+    ['B'] = GLYPH_B,
+    ['b'] = GLYPH_B,
+    ['C'] = GLYPH_C,
+    ['c'] = GLYPH_C,
+    ['D'] = GLYPH_D,
+    ['d'] = GLYPH_D,
+    ['E'] = GLYPH_E,
+    ['e'] = GLYPH_E,
+    ['F'] = GLYPH_F,
+    ['f'] = GLYPH_F,
+    ['R'] = (SEG_E | SEG_G),
+    ['r'] = (SEG_E | SEG_G),
+    ['u'] = (SEG_C | SEG_D | SEG_E),
+    ['U'] = (SEG_B | SEG_C | SEG_D | SEG_E | SEG_F),
+    ['^'] = SEG_A,
+    [' '] = 0,
+    ['.'] = SEG_DOT,
+};
+#pragma GCC diagnostic pop
+
+/**
+ * @brief Convert a string to the segment masks for each character
+ *
+ * @param pszText String to encode
+ * @param amMasks Where to put the masks
+ * @param nMaxMasks Room in amMasks
+ * @return int Number of masks stored
+ */
+int Encode_Glyphs(const char *pszText, uint32_t *amMasks, int nMaxMasks)
+{
+    int nMasks = 0;
+
+    while (pszText[nMasks] != '\0' && nMasks < nMaxMasks)
+    {
+        amMasks[nMasks] = Get_Segment_Mask(pszText[nMasks]);
+        nMasks++;
     }
+    return nMasks;
 }
 /**
  * @brief Determine the color to display in
@@ -130,17 +145,8 @@ rgb_t getRGB(void)
     case APP_STATE_DONE:
         return RGB_RED;
 
-    case APP_STATE_TIMED_QUESTION:
-        return RGB_GREEN;
-
-    case APP_STATE_WAIT_25_MINUTES:
-    case APP_STATE_WAIT_10_MINUTES:
-    case APP_STATE_WAIT_2_MINUTES:
-    case APP_STATE_WAIT_10_SECONDS:
-        return RGB_WHITE;
-
-    case APP_STATE_FINAL_10SECONDS:
-        return RGB_YELLOW;
+    case APP_STATE_RUNNING:
+        return appData.rgbPhase;
 
     case APP_STATE_CONFIG:
         return RGB_PURPLE;
@@ -148,190 +154,356 @@ rgb_t getRGB(void)
     return RGB_BLACK;
 }
 /**
- * @brief Handles the timer callback for the timer to check button presses.
+ * @brief Act on a debounced press of the button
+ *
+ * @param tPress Time the button went down
+ */
+static void Button_Pressed(int64_t tPress)
+{
+    appData.bButtonDown = true;
+    appData.tButtonPress = tPress;
+    appData.stateAtPress = appData.stateApp;
+    appData.bResetHandled = false;
+    appData.bConfigHandled = false;
+    if (appData.stateApp == APP_STATE_CONFIG)
+    {
+        // Acted on at the release, so the hold that leaves does not also step
+        return;
+    }
+    if (tPress - appData.tButtonRelease < BUTTON_DOUBLETAP_US)
+    {
+        Switch_To_State(APP_STATE_DONE);
+    }
+    else if (appData.stateApp == APP_STATE_WAIT_START)
+    {
+        ESP_LOGI(TAG, "Starting Event");
+        Switch_To_State(APP_STATE_RUNNING);
+    }
+    else if (appData.stateApp == APP_STATE_DONE)
+    {
+        ESP_LOGI(TAG, "Going to Codebusters");
+        Switch_To_State(APP_STATE_CODEBUSTERS);
+    }
+}
+/**
+ * @brief Act on a debounced release of the button.  A short press in the
+ * configuration steps to the next usable schedule.
  *
- * @param xTimer Timer handle for the callback
+ * @param tRelease Time the button came up
  */
-void Process_Tick(TimerHandle_t xTimer)
+static void Button_Released(int64_t tRelease)
 {
-    if (gpio_get_level(PUSH_BUTTON_PORT) == 0)
+    appData.bButtonDown = false;
+    appData.tButtonRelease = tRelease;
+    if (appData.stateApp == APP_STATE_CONFIG && appData.stateAtPress == APP_STATE_CONFIG)
     {
-        appData.nPressedCount++;
-        if (appData.nReleasedCount > 0 &&
-            appData.nReleasedCount < TICKS_DOUBLETAP)
+        int nCount = Schedule_Count();
+        for (int nStep = 1; nStep <= nCount; nStep++)
         {
-            Switch_To_State(APP_STATE_DONE);
+            if (Schedule_Select((Schedule_Selected() + nStep) % nCount))
+            {
+                break;
+            }
         }
-        else if (appData.nPressedCount == TICKS_PRESSED)
+        appData.bStartState = true;
+    }
+}
+/**
+ * @brief Recognize the button gestures from the timestamped edges.
+ * A press acts as soon as its edge arrives, a double tap is a press within
+ * BUTTON_DOUBLETAP_US of the last release, and holding the button for
+ * BUTTON_REQUEST_RESET_US or BUTTON_REQUEST_CONFIG_US acts once that much
+ * time has passed since the press.  The config hold counts from the state
+ * at the press, since the reset hold has already left it by then.
+ *
+ */
+void Button_Process(void)
+{
+    EVENT event;
+
+    while (HAL_Get_Event(&event))
+    {
+        switch (event.eType)
         {
-            if (appData.stateApp == APP_STATE_WAIT_START)
+        case EVENT_BUTTON_PRESS:
+            appData.nButtonEdges++;
+            appData.tButtonEdge = event.tTime;
+            if (!appData.bButtonDown)
             {
-                ESP_LOGI(TAG, "Starting Event");
-                Switch_To_State(APP_STATE_TIMED_QUESTION);
+                Button_Pressed(event.tTime);
             }
-            else if (appData.stateApp == APP_STATE_DONE)
+            break;
+        case EVENT_BUTTON_RELEASE:
+            appData.nButtonEdges++;
+            appData.tButtonEdge = event.tTime;
+            if (appData.bButtonDown)
             {
-                ESP_LOGI(TAG, "Going to Codebusters");
-                Switch_To_State(APP_STATE_CODEBUSTERS);
+                Button_Released(event.tTime);
             }
+            break;
+        case EVENT_CONSOLE_KEY:
+            Console_Command((char)event.nParam);
+            break;
+        default:
+            break;
         }
-        else if (appData.nPressedCount == TICKS_REQUEST_RESET &&
-                 appData.stateApp != APP_STATE_WAIT_START)
+    }
+    // The interrupt ignores edges while a change settles, so once it has
+    // settled make sure we did not miss the button going back
+    if (appData.tNow - appData.tButtonEdge < HAL_BUTTON_DEBOUNCE_US)
+    {
+        Wake_At_Time(appData.tButtonEdge + HAL_BUTTON_DEBOUNCE_US);
+    }
+    else if (HAL_Button_Is_Pressed() != appData.bButtonDown)
+    {
+        appData.tButtonEdge = appData.tNow;
+        if (appData.bButtonDown)
         {
-            ESP_LOGI(TAG, "Reset to Wait State");
-            Switch_To_State(APP_STATE_WAIT_START);
+            Button_Released(appData.tNow);
         }
-        else if (appData.nPressedCount == TICKS_REQUEST_CONFIG &&
-                 appData.stateApp == APP_STATE_CODEBUSTERS)
+        else
         {
-            ESP_LOGI(TAG, "Going to Config State");
-            Switch_To_State(APP_STATE_CONFIG);
+            Button_Pressed(appData.tNow);
         }
-        appData.nReleasedCount = 0;
     }
-    else
+    if (!appData.bButtonDown)
+    {
+        return;
+    }
+    if (!appData.bResetHandled)
+    {
+        if (appData.tNow - appData.tButtonPress >= BUTTON_REQUEST_RESET_US)
+        {
+            appData.bResetHandled = true;
+            if (appData.stateApp != APP_STATE_WAIT_START)
+            {
+                if (appData.stateApp == APP_STATE_CONFIG)
+                {
+                    Schedule_Save_Selection();
+                }
+                ESP_LOGI(TAG, "Reset to Wait State");
+                Switch_To_State(APP_STATE_WAIT_START);
+            }
+        }
+        else
+        {
+            Wake_At_Time(appData.tButtonPress + BUTTON_REQUEST_RESET_US);
+        }
+    }
+    if (!appData.bConfigHandled)
     {
-        appData.nPressedCount = 0;
-        appData.nReleasedCount++;
+        if (appData.tNow - appData.tButtonPress >= BUTTON_REQUEST_CONFIG_US)
+        {
+            appData.bConfigHandled = true;
+            if (appData.stateAtPress == APP_STATE_CODEBUSTERS)
+            {
+                ESP_LOGI(TAG, "Going to Config State");
+                Switch_To_State(APP_STATE_CONFIG);
+            }
+        }
+        else
+        {
+            Wake_At_Time(appData.tButtonPress + BUTTON_REQUEST_CONFIG_US);
+        }
     }
-    xSemaphoreGiveFromISR(appData.hTimerSemaphore, NULL);
 }
 
 /**
- * @brief Compute checksum (2's complement of sum of bytes 1 to 6)
+ * @brief Handle what the audio task reports back
  *
- * @param cmd Command bytes to checksum
- * @return uint16_t Place to put checksum value
  */
-static uint16_t dfplayer_checksum(uint8_t *cmd)
+void Audio_Process(void)
 {
-    uint16_t sum = 0;
-    for (int i = 1; i < 7; i++)
+    EVENT event;
+
+    while (dfplayer_get_event(&event))
     {
-        sum += cmd[i];
+        switch (event.eType)
+        {
+        case EVENT_AUDIO_FINISHED:
+            DLOG(DLOG_TRACK_FINISHED, (int32_t)event.nParam);
+            // Its start was measured long before, keep it while nothing else is due
+            dfplayer_save_latency();
+            break;
+        case EVENT_AUDIO_READY:
+            Boot_Mark(BOOT_AUDIO_READY);
+            break;
+        case EVENT_AUDIO_FAILED:
+            DLOG(DLOG_COMMAND_FAILED, DFPLAYER_COMMAND(event.nParam), DFPLAYER_PARAM(event.nParam));
+            break;
+        default:
+            break;
+        }
     }
-    return 0xFFFF - sum + 1;
 }
-
 /**
- * @brief Send DFPlayer command with checksum
+ * @brief Work out where each digit is from the strip assignment, create
+ * the strips and start the compositor that drives them
  *
- * @param command Command to send to the player
- * @param param Parameter for the command
  */
-void dfplayer_send_command(uint8_t command, uint16_t param)
+void Display_Initialize(void)
 {
-    uint8_t cmd[DFPLAYER_CMD_LENGTH] = {0};
+    static const int anGpios[LED_STRIPS] = LED_STRIP_GPIOS;
+    static const int anDigitStrips[DISPLAY_DIGITS] = DIGIT_STRIPS;
+    static const int anDigitLeds[DISPLAY_DIGITS] = LAYOUT_DIGIT_LEDS_INIT;
 
-    cmd[0] = 0x7E;                // Start byte
-    cmd[1] = 0xFF;                // Version
-    cmd[2] = 0x06;                // Length
-    cmd[3] = command;             // Command
-    cmd[4] = 0x00;                // No feedback
-    cmd[5] = (param >> 8) & 0xFF; // High byte of param
-    cmd[6] = param & 0xFF;        // Low byte of param
-
-    uint16_t checksum = dfplayer_checksum(cmd);
-    cmd[7] = (checksum >> 8) & 0xFF; // Checksum high byte
-    cmd[8] = checksum & 0xFF;        // Checksum low byte
-    cmd[9] = 0xEF;                   // End byte
-
-    uart_write_bytes(UART_NUM_1, (const char *)cmd, sizeof(cmd));
-
-    ESP_LOG_BUFFER_HEX("DFPlayer CMD", cmd, sizeof(cmd));
+    memset(appData.anStripLeds, 0, sizeof(appData.anStripLeds));
+    for (int nDigit = 0; nDigit < DISPLAY_DIGITS; nDigit++)
+    {
+        int nStrip = anDigitStrips[nDigit];
+        appData.anDigitStrip[nDigit] = nStrip;
+        appData.anDigitFirstLed[nDigit] = appData.anStripLeds[nStrip];
+        appData.anStripLeds[nStrip] += anDigitLeds[nDigit];
+    }
+    for (int nStrip = 0; nStrip < LED_STRIPS; nStrip++)
+    {
+        ESP_LOGI(TAG, "Requesting strip %d with %d LEDS on GPIO %d", nStrip, appData.anStripLeds[nStrip], anGpios[nStrip]);
+    }
+    HAL_LED_Initialize(LED_STRIPS, anGpios, appData.anStripLeds);
+    Render_Initialize(appData.anDigitStrip, appData.anDigitFirstLed, appData.anStripLeds);
 }
 /**
- * @brief Play a specific track number
+ * @brief Show a two digit value in the rightmost digits, blanking any
+ * digits to the left of them
  *
- * @param track_num Which track number to play
+ * @param mTens Segments of the tens digit
+ * @param mOnes Segments of the ones digit
+ */
+void Display_Right_Digits(uint32_t mTens, uint32_t mOnes)
+{
+    for (int nDigit = 0; nDigit < DISPLAY_DIGITS - 2; nDigit++)
+    {
+        appData.amDigits[nDigit] = Get_Segment_Mask(' ');
+    }
+    appData.amDigits[DISPLAY_DIGITS - 2] = mTens;
+    appData.amDigits[DISPLAY_DIGITS - 1] = mOnes;
+}
+/**
+ * @brief Display the current value on the timer
+ * appData.amDigits are handed to the compositor in the current RGB Color
+ * for the state, which fades to them in the render task.  Color changes
+ * fade slowest, the scroll a little faster, and anything else quickly.
  */
-void dfplayer_play_track(uint16_t track_num)
+void Timer_Display(void)
 {
-    dfplayer_send_command(0x03, track_num);
+    rgb_t color = getRGB();
+    int64_t tFade = DISPLAY_DIGIT_FADE_US;
+
+    if (color != appData.rgbShown)
+    {
+        tFade = DISPLAY_COLOR_FADE_US;
+    }
+    else if (appData.stateApp == APP_STATE_CODEBUSTERS)
+    {
+        tFade = DISPLAY_SCROLL_FADE_US;
+    }
+    appData.rgbShown = color;
+    Render_Show(appData.amDigits, color, appData.nBrightness, tFade, appData.tDisplayDue);
+    appData.tDisplayDue = 0;
 }
 /**
- * @brief Set Volume
+ * @brief Report how much work the display refreshes have done
  *
- * @param volume Volume (0-30)
  */
-void dfplayer_set_volume(uint8_t volume)
+void Timer_Display_Log_Stats(void)
 {
-    dfplayer_send_command(0x06, volume);
+    Render_Log_Stats();
 }
-void dfplayer_safe_init(uint8_t initial_volume, uint16_t test_track)
+/**
+ * @brief Log how late the app wakes, how long frames take and how far the
+ * display lags the clock
+ *
+ */
+void Timing_Log_Histograms(void)
 {
-    ESP_LOGI("DFPlayer", "Initializing DFPlayer (waiting %d ms for power stabilization)...", DFPLAYER_INIT_DELAY_MS);
-    vTaskDelay(pdMS_TO_TICKS(DFPLAYER_INIT_DELAY_MS));
+    const RENDER_STATS *pStats = Render_Get_Stats();
 
-    // Set initial volume
-    dfplayer_set_volume(initial_volume);
-    vTaskDelay(pdMS_TO_TICKS(100)); // Small delay after volume set
+    Histogram_Log("wake late", &appData.histWake);
+    Histogram_Log("frame time", &pStats->histFrame);
+    Histogram_Log("display lag", &pStats->histLag);
+}
+/**
+ * @brief Log how long each power lock kept the clock up, and the time the
+ * board measured in each power mode
+ *
+ */
+void Power_Log_Stats(void)
+{
+    static const char *apszLocks[HAL_POWER_LOCKS] = {"LED", "audio", "link"};
+    HAL_POWER_STATS stats;
+    int64_t tNow = HAL_Get_Time();
+    int nPermille;
 
-    // Try playing the test track with retry logic
-    for (int i = 0; i < DFPLAYER_RETRY_COUNT; i++)
+    HAL_Power_Get_Stats(&stats);
+    nPermille = tNow > 0 ? (int)(stats.tUnlocked * 1000 / tNow) : 0;
+    ESP_LOGI(TAG, "Power: %lld ms of %lld ms with no lock held (%d.%d%%)", (long long)(stats.tUnlocked / 1000),
+             (long long)(tNow / 1000), nPermille / 10, nPermille % 10);
+    for (int nLock = 0; nLock < HAL_POWER_LOCKS; nLock++)
     {
-        ESP_LOGI("DFPlayer", "Attempting to play track %d (attempt %d)...", test_track, i + 1);
-        dfplayer_play_track(test_track);
-        vTaskDelay(pdMS_TO_TICKS(DFPLAYER_RETRY_DELAY_MS));
+        ESP_LOGI(TAG, "Power: %s lock held %lld ms, taken %lu times", apszLocks[nLock],
+                 (long long)(stats.atHeld[nLock] / 1000), (unsigned long)stats.anTaken[nLock]);
     }
-
-    ESP_LOGI("DFPlayer", "DFPlayer Safe Init Complete.");
+    HAL_Power_Log_Modes();
 }
 /**
- * @brief Initialize UART
+ * @brief Log the RAM the firmware uses and the most of its stack each task
+ * has needed.  Everything is created before the startup report, so the heap
+ * should never fall below what it showed.
  *
  */
-void init_uart(void)
+void Memory_Log_Stats(void)
 {
-    const uart_config_t uart_config = {
-        .baud_rate = 9600,
-        .data_bits = UART_DATA_8_BITS,
-        .parity = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE};
+    HAL_MEMORY_STATS stats;
 
-    uart_driver_install(UART_NUM, 1024, 0, 0, NULL, 0);
-    uart_param_config(UART_NUM, &uart_config);
-    uart_set_pin(UART_NUM, TXD_PIN, RXD_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    HAL_Memory_Get_Stats(&stats);
+    // The first report is the one at startup
+    if (appData.nHeapAtStartup == 0)
+    {
+        appData.nHeapAtStartup = stats.nHeapFree;
+    }
+    ESP_LOGI(TAG, "Memory: %lu bytes static, heap %lu of %lu bytes free, least %lu, %ld taken since startup",
+             (unsigned long)stats.nStatic, (unsigned long)stats.nHeapFree, (unsigned long)stats.nHeapSize,
+             (unsigned long)stats.nHeapMinFree, (long)appData.nHeapAtStartup - (long)stats.nHeapFree);
+    for (int nTask = 0; nTask < stats.nTasks; nTask++)
+    {
+        const HAL_TASK_STACK *pTask = &stats.aTasks[nTask];
 
-    // Wait for DFPlayer to respond
-    vTaskDelay(pdMS_TO_TICKS(300));
+        ESP_LOGI(TAG, "Memory: %s stack used %lu of %lu bytes", pTask->pszName,
+                 (unsigned long)(pTask->nStack - pTask->nUnused), (unsigned long)pTask->nStack);
+    }
 }
 /**
- * @brief Display the current value on the timer
- * appData.amDigits are displayed using the current RGB Color for the state
+ * @brief Act on a key typed on the console
+ *
+ * @param cKey Character typed
  */
-void Timer_Display(void)
+void Console_Command(char cKey)
 {
-
-    led_strip_handle_t led_strip = appData.ahLEDStrip;
-    rgb_t RGBOn = getRGB();
-    int nLed = 0;
-    for (int nDigit = 0; nDigit < DISPLAY_DIGITS; nDigit++)
+    switch (cKey)
     {
-        int nMask = SEG_A;
-        int mThisDigit = appData.amDigits[nDigit];
-        for (int nSegment = 0; nSegment < DIGIT_SEGMENTS; nSegment++)
-        {
-            rgb_t color = RGB_BLACK;
-            if (mThisDigit & nMask)
-            {
-                color = RGBOn;
-            }
-            int nSegmentLeds = BASE_LEDS_PER_SEGMENT;
-            if (nSegment == (DIGIT_SEGMENTS - 1))
-            {
-                nSegmentLeds = 1;
-            }
-            // ESP_LOGI(TAG, "Digit:%d Segment:%d Display:%08x Mask: %08x Color(%d,%d,%d)", nDigit, nSegment, mThisDigit, nMask, (int)RGB_GET_R(color), (int)RGB_GET_G(color), (int)RGB_GET_B(color));
-            while (nSegmentLeds-- > 0)
-            {
-                ESP_ERROR_CHECK(led_strip_set_pixel(led_strip, nLed++, RGB_GET_R(color), RGB_GET_G(color), RGB_GET_B(color)));
-            }
-            nMask <<= 1;
-        }
+    case CONSOLE_TIMING_DUMP:
+        Timing_Log_Histograms();
+        break;
+    case CONSOLE_TIMING_RESET:
+        // The render histograms belong to the render task, only ours is cleared
+        Histogram_Reset(&appData.histWake);
+        ESP_LOGI(TAG, "Wake histogram cleared");
+        break;
+    case CONSOLE_TRACE_DUMP:
+        Trace_Dump();
+        break;
+    case CONSOLE_POWER_DUMP:
+        Power_Log_Stats();
+        break;
+    case CONSOLE_MEMORY_DUMP:
+        Memory_Log_Stats();
+        break;
+    case CONSOLE_SYNC_STEP:
+        Sync_Step_Config();
+        break;
+    default:
+        break;
     }
-    ESP_ERROR_CHECK(led_strip_refresh(led_strip));
 }
 /**
  * @brief Initialize all the hardware
@@ -339,25 +511,50 @@ void Timer_Display(void)
  */
 void HW_Initialize(void)
 {
-    ESP_LOGI(TAG, "Requesting strip with %d LEDS", LED_STRIP_TOTAL_LEDS);
-    appData.ahLEDStrip = configure_led(LED_STRIP_PORT);
-
-    // zero-initialize the config structure.
-    gpio_config_t io_conf = {};
-    // disable interrupt
-    io_conf.intr_type = GPIO_INTR_DISABLE;
-    // set as output mode
-    io_conf.mode = GPIO_MODE_INPUT;
-    // bit mask of the pins that you want to set,e.g.GPIO18/19
-    io_conf.pin_bit_mask = 1ULL << PUSH_BUTTON_PORT;
-    // disable pull-down mode
-    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-    // enable pull-up mode
-    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
-    // configure GPIO with the given settings
-    gpio_config(&io_conf);
-    init_uart();
-    dfplayer_safe_init(30, TRACK_WELCOME_TO_CODEBUSTERS);
+    HAL_Power_Initialize();
+    Dlog_Initialize();
+    Trace_Initialize();
+    Display_Initialize();
+    Boot_Mark(BOOT_LEDS_READY);
+    HAL_Button_Initialize();
+    HAL_Console_Initialize();
+    HAL_Settings_Initialize();
+    Schedule_Initialize();
+    appData.bResume = Checkpoint_Initialize(&appData.checkpoint, &appData.bResumeWarm) &&
+                      appData.checkpoint.bRunning;
+    // The audio task waits for the DFPlayer to power up and holds the volume until then.
+    // The welcome comes from the Codebusters state, which an event picked back up skips.
+    dfplayer_initialize();
+    dfplayer_set_volume(30);
+    Sync_Initialize();
+}
+/**
+ * @brief Record when a boot phase was reached
+ *
+ * @param phase Phase that was just reached
+ */
+void Boot_Mark(BOOT_PHASE phase)
+{
+    Boot_Mark_At(phase, HAL_Get_Time());
+}
+/**
+ * @brief Record when a boot phase was reached, as timed by another task
+ *
+ * @param phase Phase that was reached
+ * @param tAt When it was reached
+ */
+void Boot_Mark_At(BOOT_PHASE phase, int64_t tAt)
+{
+    static const char *apszPhases[BOOT_PHASES] = {
+        [BOOT_APP_MAIN] = "app_main",
+        [BOOT_LEDS_READY] = "LEDs ready",
+        [BOOT_FIRST_FRAME] = "first frame",
+        [BOOT_AUDIO_READY] = "audio ready",
+        [BOOT_RESUMED] = "resumed",
+    };
+
+    appData.atBoot[phase] = tAt;
+    ESP_LOGI(TAG, "Boot: %s at %lld us", apszPhases[phase], (long long)appData.atBoot[phase]);
 }
 /**
  * @brief Initialize all the application data and start the timer
@@ -365,36 +562,31 @@ void HW_Initialize(void)
  */
 void APP_Initialize(void)
 {
-    TimerHandle_t hTickTimer;
-    appData.nPressedCount = 0;
-    appData.nReleasedCount = 0;
+    appData.bButtonDown = false;
+    // No release yet, far enough back that the first press is not a double tap
+    appData.tButtonRelease = -BUTTON_DOUBLETAP_US;
+    appData.tButtonEdge = -HAL_BUTTON_DEBOUNCE_US;
 
-    appData.hTimerSemaphore = xSemaphoreCreateBinary();
     appData.bStartState = true;
     appData.tStartTime = 0;
-    appData.dLastSeconds = 0;
+    appData.nLastShown = 0;
+    appData.rgbShown = RGB_BLACK;
+    appData.nBrightness = LED_BRIGHTNESS;
 
     for (int nDigit = 0; nDigit < DISPLAY_DIGITS; nDigit++)
     {
         appData.amDigits[nDigit] = SEG_ALL;
     }
+    appData.nScrollLength = Encode_Glyphs(SCROLL_MESSAGE, appData.amScrollMasks, SCROLL_MESSAGE_MAX);
 
-    ESP_LOGI(TAG, "Timer Interval is %ld", TIMER_INTERVAL);
-    hTickTimer = xTimerCreate("Tick", TIMER_INTERVAL, pdTRUE, (void *)2, &Process_Tick);
-    // Check if the timer was created successfully
-    if (hTickTimer == NULL)
-    {
-        ESP_LOGI(TAG, "Failed to create timer");
-    }
-    else
+    appData.nWakeups = 0;
+    appData.nButtonEdges = 0;
+    HAL_Initialize_Wake();
+    Switch_To_State(APP_STATE_CODEBUSTERS);
+    if (appData.bResume)
     {
-        // Start the timers
-        if (xTimerStart(hTickTimer, 0) != pdPASS)
-        {
-            ESP_LOGI(TAG, "Failed to start timer\n");
-        }
+        Resume_Checkpoint();
     }
-    Switch_To_State(APP_STATE_CODEBUSTERS);
 }
 /**
  * @brief Scroll the Codebusters text at the rate of 2/second
@@ -402,46 +594,262 @@ void APP_Initialize(void)
  */
 void ScrollCodebusters(void)
 {
-    const char *scrollMessage = "COdEbuST^ERS  ";
-
     if (appData.bStartState)
     {
-        appData.tStartTime = esp_timer_get_time();
-        appData.dLastSeconds = -1;
+        appData.tStartTime = HAL_Get_Time();
+        appData.nElapsedTenths = 0;
+        appData.nLastShown = -1;
         appData.bStartState = false;
         dfplayer_play_track(TRACK_WELCOME_TO_CODEBUSTERS);
     }
-    double elapsed_ticks = 2 * appData.dElapsedSeconds;
-    int slot = ((int)(round(elapsed_ticks)) - 1 + strlen(scrollMessage)) % strlen(scrollMessage);
-    if (slot != appData.dLastSeconds)
+    // Half seconds elapsed, rounded to the nearest
+    int32_t nHalfSeconds = (appData.nElapsedTenths + 2) / 5;
+    int slot = (nHalfSeconds - 1 + appData.nScrollLength) % appData.nScrollLength;
+    if (slot != appData.nLastShown)
     {
-        appData.dLastSeconds = slot;
-        int nextSlot = (slot + 1) % strlen(scrollMessage);
-        appData.amDigits[0] = Get_Segment_Mask(scrollMessage[slot]);
-        appData.amDigits[1] = Get_Segment_Mask(scrollMessage[nextSlot]);
+        appData.nLastShown = slot;
+        for (int nDigit = 0; nDigit < DISPLAY_DIGITS; nDigit++)
+        {
+            appData.amDigits[nDigit] = appData.amScrollMasks[(slot + nDigit) % appData.nScrollLength];
+        }
         Timer_Display();
     }
+    // Wake for the next half second slot
+    Wake_At_Tenths(5 * (nHalfSeconds + 1) - 2);
 }
 /**
- * @brief Show the countdown to zero in 10th of a second
+ * @brief Show a number of minutes, without a leading zero
  *
+ * @param nMinutes Minutes to show, 0-99
  */
-void showSecondsCountdownTime(void)
+void Display_Minutes(int nMinutes)
+{
+    int nTenDigit = (nMinutes % 100) / 10;
+    int nOneDigit = nMinutes % 10;
+
+    Display_Right_Digits(nTenDigit == 0 ? Get_Segment_Mask(' ') : Get_Digit_Mask(nTenDigit),
+                         Get_Digit_Mask(nOneDigit));
+}
+/**
+ * @brief Send the track of every timeline entry that is close enough to be
+ * heard on time.  Each track is sent as long before its entry as the module
+ * takes to start playing it, so the announcement lands with the display
+ * change rather than after it.
+ *
+ */
+void Run_Timeline_Audio(void)
+{
+    const TIMELINE *pTimeline = appData.pTimeline;
+
+    while (appData.nAudioCursor < pTimeline->nEntries)
+    {
+        const TIMELINE_ENTRY *pEntry = &pTimeline->aEntries[appData.nAudioCursor];
+
+        if (pEntry->nTrack != 0)
+        {
+            int64_t tSend = Tenths_Time(pEntry->nTenths) - dfplayer_track_latency(pEntry->nTrack);
+
+            if (appData.tNow < tSend)
+            {
+                Wake_At_Time(tSend);
+                return;
+            }
+            // Entries passed while the timer was off have already been heard
+            if (!appData.bResume || appData.nElapsedTenths < pEntry->nTenths)
+            {
+                dfplayer_play_track(pEntry->nTrack);
+            }
+        }
+        appData.nAudioCursor++;
+    }
+}
+/**
+ * @brief Act on every entry of the timeline that is due, then show the time
+ * remaining.  The cursor only moves forward, so what happens next is always
+ * the entry it points at and each tick looks at a single entry.  The tracks
+ * have a cursor of their own that runs a little ahead.
+ *
+ */
+void Run_Timeline(void)
+{
+    const TIMELINE *pTimeline = appData.pTimeline;
+
+    Run_Timeline_Audio();
+    while (appData.nCursor < pTimeline->nEntries &&
+           appData.nElapsedTenths >= pTimeline->aEntries[appData.nCursor].nTenths)
+    {
+        const TIMELINE_ENTRY *pEntry = &pTimeline->aEntries[appData.nCursor++];
+        appData.bCheckpointDue = true;
+        appData.rgbPhase = pEntry->color;
+        appData.nPhaseFlags = pEntry->nFlags;
+        // Redraw even if the time shown stays the same, the color may not
+        appData.nLastShown = -1;
+        if (pEntry->nFlags & SCHEDULE_END)
+        {
+            Switch_To_State(APP_STATE_DONE);
+        }
+    }
+    if (appData.nCursor < pTimeline->nEntries)
+    {
+        Wake_At_Tenths(pTimeline->aEntries[appData.nCursor].nTenths);
+    }
+    if (appData.nPhaseFlags & SCHEDULE_TENTHS)
+    {
+        showSecondsCountdownTime();
+    }
+    else
+    {
+        showCountdownTime();
+    }
+    appData.bResume = false;
+}
+/**
+ * @brief Record where the event is, so it can be picked back up after a
+ * reset.  The checkpoint holds the elapsed time of the last timeline entry
+ * rather than the current time, so it only changes on a transition and
+ * taking it again costs no flash write.
+ *
+ */
+void Save_Checkpoint(void)
+{
+    CHECKPOINT checkpoint;
+
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    if (appData.stateApp == APP_STATE_RUNNING)
+    {
+        checkpoint.bRunning = true;
+        checkpoint.nSchedule = (uint8_t)Schedule_Selected();
+        checkpoint.nElapsedTenths = appData.nCursor > 0 ? appData.pTimeline->aEntries[appData.nCursor - 1].nTenths : 0;
+        checkpoint.tStartEpoch = HAL_Get_Epoch() - (appData.tNow - appData.tStartTime);
+    }
+    Checkpoint_Save(&checkpoint);
+}
+/**
+ * @brief Pick up the event recorded in the checkpoint found at boot.  After
+ * a warm reset the epoch clock has kept running, so the event carries on
+ * exactly where it is.  After a power loss there is no telling how long the
+ * power was off, so it carries on from the last transition.
+ *
+ */
+void Resume_Checkpoint(void)
+{
+    const CHECKPOINT *pCheckpoint = &appData.checkpoint;
+    int64_t tElapsed = (int64_t)pCheckpoint->nElapsedTenths * US_PER_TENTH;
+
+    if (!Schedule_Select(pCheckpoint->nSchedule))
+    {
+        appData.bResume = false;
+        return;
+    }
+    if (appData.bResumeWarm && HAL_Get_Epoch() - pCheckpoint->tStartEpoch > tElapsed)
+    {
+        tElapsed = HAL_Get_Epoch() - pCheckpoint->tStartEpoch;
+    }
+    appData.tStartTime = HAL_Get_Time() - tElapsed;
+    appData.bStartSet = true;
+    ESP_LOGI(TAG, "Resuming %s at %ld.%ld", Schedule_Timeline()->pszName,
+             (long)Elapsed_Tenths(tElapsed) / 10, (long)Elapsed_Tenths(tElapsed) % 10);
+    Switch_To_State(APP_STATE_RUNNING);
+    Boot_Mark(BOOT_RESUMED);
+}
+/**
+ * @brief Run the leader's event, started at a time given on our clock.
+ * Small moves of the start, as the two clocks drift, slew the running event;
+ * anything else starts it over, quietly when it is joined part way.
+ *
+ * @param tStart Time the leader's event started, on our clock
+ * @param stateLeader State of the leader
+ * @param nSchedule Schedule the leader runs
+ */
+void Follow_Leader(int64_t tStart, APP_STATES stateLeader, int nSchedule)
+{
+    const TIMELINE *pTimeline = Schedule_Timeline();
+    // Our timeline may have ended a moment before the leader's did
+    bool bOver = appData.stateApp == APP_STATE_DONE && Schedule_Selected() == nSchedule &&
+                 appData.tNow - tStart >= (int64_t)pTimeline->nLengthSeconds * 1000000 - SYNC_STEP_US;
+
+    switch (stateLeader)
+    {
+    case APP_STATE_RUNNING:
+        if (appData.stateApp == APP_STATE_RUNNING && Schedule_Selected() == nSchedule &&
+            llabs(tStart - appData.tStartTime) < SYNC_STEP_US)
+        {
+            appData.tStartTime = tStart;
+        }
+        else if (!bOver && Schedule_Select(nSchedule))
+        {
+            ESP_LOGI(TAG, "Following the leader's event");
+            appData.tStartTime = tStart;
+            appData.bStartSet = true;
+            appData.bResume = appData.tNow - tStart > SYNC_STEP_US;
+            Switch_To_State(APP_STATE_RUNNING);
+        }
+        break;
+    case APP_STATE_WAIT_START:
+        if (appData.stateApp == APP_STATE_RUNNING || appData.stateApp == APP_STATE_DONE)
+        {
+            ESP_LOGI(TAG, "Leader reset to Wait State");
+            Switch_To_State(APP_STATE_WAIT_START);
+        }
+        break;
+    default:
+        break;
+    }
+}
+/**
+ * @brief Handle what the sync task reports back
+ *
+ */
+void Sync_Process(void)
 {
-    double dElapsedSecondsTenths = roundf((appData.tNow - appData.tStartTime) / 100000.0);
+    EVENT event;
 
-    int nTenthsRemain = ceil(((float)EVENT_LENGTH * 10) - dElapsedSecondsTenths);
-    if (nTenthsRemain != appData.dLastSeconds)
+    while (Sync_Get_Event(&event))
     {
-        appData.dLastSeconds = nTenthsRemain;
+        if (event.eType == EVENT_SYNC_LEADER)
+        {
+            Follow_Leader(event.tTime, (APP_STATES)SYNC_STATE(event.nParam), SYNC_SCHEDULE(event.nParam));
+        }
+    }
+}
+/**
+ * @brief Show the countdown to zero in 10th of a second, or in whole
+ * seconds while there are ten or more left
+ *
+ */
+void showSecondsCountdownTime(void)
+{
+    int32_t nTenthsRemain = (appData.pTimeline->nLengthSeconds * 10) - appData.nElapsedTenths;
+    if (nTenthsRemain < 0)
+    {
+        nTenthsRemain = 0;
+    }
+    if (nTenthsRemain != appData.nLastShown)
+    {
+        // Only a tick of the count is timed, not the first value shown
+        if (appData.nLastShown >= 0)
+        {
+            appData.tDisplayDue = Tenths_Time(appData.nElapsedTenths);
+        }
+        appData.nLastShown = nTenthsRemain;
 
-        int nSeconds = trunc(nTenthsRemain / 10);
+        int nSeconds = nTenthsRemain / 10;
         int nTenths = nTenthsRemain % 10;
 
-        appData.amDigits[0] = Get_Segment_Mask(nSeconds) | SEG_DOT;
-        appData.amDigits[1] = Get_Segment_Mask(nTenths);
+        if (nSeconds >= 10)
+        {
+            Display_Right_Digits(Get_Digit_Mask((nSeconds % 100) / 10), Get_Digit_Mask(nSeconds % 10));
+        }
+        else
+        {
+            Display_Right_Digits(Get_Digit_Mask(nSeconds) | SEG_DOT, Get_Digit_Mask(nTenths));
+        }
         Timer_Display();
     }
+    if (nTenthsRemain > 0)
+    {
+        Wake_At_Tenths(appData.nElapsedTenths + 1);
+    }
 }
 /**
  * @brief Show the remaining time in minutes
@@ -449,27 +857,29 @@ void showSecondsCountdownTime(void)
  */
 void showCountdownTime(void)
 {
-    if (floor(appData.dElapsedSeconds) != floor(appData.dLastSeconds))
-    {
-        int nSecondsRemain;
-        int nMinutesRemain;
-        int nTenDigit;
-        int nOneDigit;
-        appData.dLastSeconds = appData.dElapsedSeconds;
-        nSecondsRemain = ceil(EVENT_LENGTH - appData.dElapsedSeconds);
-        nMinutesRemain = (((nSecondsRemain * SCALE_SPEED) + 59) / 60);
+    const TIMELINE *pTimeline = appData.pTimeline;
+    int32_t nElapsedSeconds = appData.nElapsedTenths / 10;
+    int nSecondsRemain = pTimeline->nLengthSeconds - nElapsedSeconds;
+    int nMinutesRemain = (((nSecondsRemain * pTimeline->nScale) + 59) / 60);
 
-        nTenDigit = (nMinutesRemain % 100) / 10;
-        nOneDigit = nMinutesRemain % 10;
-        if (nTenDigit == 0)
+    if (nElapsedSeconds != appData.nLastShown)
+    {
+        if (appData.nLastShown >= 0)
         {
-            nTenDigit = ' ';
+            appData.tDisplayDue = Tenths_Time(nElapsedSeconds * 10);
         }
-        appData.amDigits[0] = Get_Segment_Mask(nTenDigit);
-        appData.amDigits[1] = Get_Segment_Mask(nOneDigit);
-        ESP_LOGI(TAG, "Remain: %02d:%02d Time: %.2f", nMinutesRemain, nSecondsRemain % 60, appData.dElapsedSeconds);
+        appData.nLastShown = nElapsedSeconds;
+
+        Display_Minutes(nMinutesRemain);
+        DLOG(DLOG_REMAIN, nMinutesRemain, nSecondsRemain % 60, appData.nElapsedTenths / 10,
+             appData.nElapsedTenths % 10);
         Timer_Display();
     }
+    // Wake at the first second showing one minute less
+    if (nMinutesRemain > 0)
+    {
+        Wake_At_Tenths((pTimeline->nLengthSeconds - (60 * (nMinutesRemain - 1)) / pTimeline->nScale) * 10);
+    }
 }
 /**
  * @brief Switch the state that the application is in
@@ -480,29 +890,155 @@ void Switch_To_State(APP_STATES newState)
 {
     appData.bStartState = true;
     appData.stateApp = newState;
+    appData.nStateChanges++;
+    appData.bCheckpointDue = true;
+    Trace_State(HAL_Get_Time(), (uint8_t)newState);
+}
+/**
+ * @brief Convert elapsed microseconds to tenths of a second
+ *
+ * @param tElapsed Elapsed time in microseconds
+ * @return int32_t Elapsed time rounded to the nearest tenth of a second
+ */
+int32_t Elapsed_Tenths(int64_t tElapsed)
+{
+    return (int32_t)((tElapsed + (US_PER_TENTH / 2)) / US_PER_TENTH);
+}
+/**
+ * @brief Ask to run again at a given time
+ *
+ * @param tWake Time in microseconds
+ */
+void Wake_At_Time(int64_t tWake)
+{
+    if (tWake < appData.tDeadline)
+    {
+        appData.tDeadline = tWake;
+    }
+}
+/**
+ * @brief Get the time the elapsed time reaches a given tenth of a second
+ *
+ * @param nTenths Elapsed tenths of a second since tStartTime
+ * @return int64_t Time in microseconds
+ */
+int64_t Tenths_Time(int32_t nTenths)
+{
+    // Elapsed_Tenths rounds, so the tenth is reached half a tenth early
+    return appData.tStartTime + (int64_t)nTenths * US_PER_TENTH - (US_PER_TENTH / 2);
+}
+/**
+ * @brief Ask to run again when the elapsed time reaches a given tenth of a second
+ *
+ * @param nTenths Elapsed tenths of a second since tStartTime
+ */
+void Wake_At_Tenths(int32_t nTenths)
+{
+    Wake_At_Time(Tenths_Time(nTenths));
 }
 /**
- * @brief Process a timed state transition
+ * @brief Run one step of the application state machine
  *
- * @param timeLimit How long to stay in this state
- * @param track Track to play if the state transitions
- * @param nextState New state to transition
- * @return true State transitioned
- * @return false State did not transition
+ * @return int64_t Time at which the next visible or audible change is due,
+ * HAL_NO_DEADLINE when nothing changes until the button is used
  */
-bool HandleTimedState(double timeLimit, int track, APP_STATES nextState)
+int64_t APP_Tasks(void)
 {
-    if (appData.dElapsedSeconds >= timeLimit)
+    uint32_t nStateChanges = appData.nStateChanges;
+    int64_t tFirstFrame;
+
+    appData.tNow = HAL_Get_Time();
+    appData.tDeadline = HAL_NO_DEADLINE;
+    if (appData.atBoot[BOOT_FIRST_FRAME] < 0 && Render_Get_First_Frame(&tFirstFrame))
+    {
+        Boot_Mark_At(BOOT_FIRST_FRAME, tFirstFrame);
+    }
+    Button_Process();
+    Audio_Process();
+    Sync_Process();
+    // Compute the elapsed time to the nearest 10th of a second.
+    appData.nElapsedTenths = Elapsed_Tenths(appData.tNow - appData.tStartTime);
+
+    switch (appData.stateApp)
     {
-        if (track != -1)
+    case APP_STATE_CODEBUSTERS:
+        ScrollCodebusters();
+        break;
+    case APP_STATE_WAIT_START:
+        if (appData.bStartState)
+        {
+            const TIMELINE *pTimeline = Schedule_Timeline();
+            appData.bStartState = false;
+            Display_Minutes((pTimeline->nLengthSeconds * pTimeline->nScale + 59) / 60);
+            Timer_Display();
+        }
+        break;
+    case APP_STATE_RUNNING:
+        if (appData.bStartState)
+        {
+            // A resumed or followed event keeps the start time it was given
+            if (!appData.bStartSet)
+            {
+                appData.tStartTime = appData.tNow;
+                appData.nElapsedTenths = 0;
+            }
+            appData.bStartSet = false;
+            appData.bStartState = false;
+            appData.pTimeline = Schedule_Timeline();
+            appData.nCursor = 0;
+            appData.nAudioCursor = 0;
+            appData.rgbPhase = RGB_WHITE;
+            appData.nPhaseFlags = 0;
+            appData.nFlashWritesAtStart = Checkpoint_Get_Stats()->nFlashWrites;
+        }
+        Run_Timeline();
+        break;
+    case APP_STATE_DONE:
+        if (appData.bStartState)
+        {
+            appData.tStartTime = appData.tNow;
+            appData.nElapsedTenths = 0;
+            appData.bStartState = false;
+
+            Display_Right_Digits(Get_Digit_Mask(0), Get_Digit_Mask(0));
+            Timer_Display();
+            Timer_Display_Log_Stats();
+            Timing_Log_Histograms();
+            ESP_LOGI(TAG, "Scheduler: %lu wakeups, %lu button edges",
+                     (unsigned long)appData.nWakeups, (unsigned long)appData.nButtonEdges);
+            dfplayer_log_stats();
+            Checkpoint_Log_Stats();
+            Sync_Log_Stats();
+            Dlog_Log_Stats();
+            Trace_Log_Stats();
+            Power_Log_Stats();
+            Memory_Log_Stats();
+            ESP_LOGI(TAG, "Event took %lu checkpoint flash writes",
+                     (unsigned long)(Checkpoint_Get_Stats()->nFlashWrites - appData.nFlashWritesAtStart));
+        }
+        break;
+    case APP_STATE_CONFIG:
+        if (appData.bStartState)
         {
-            dfplayer_play_track(track);
+            appData.bStartState = false;
+            Display_Right_Digits(Get_Segment_Mask('C'), Get_Digit_Mask(Schedule_Selected() + 1));
+            Timer_Display();
         }
-        Switch_To_State(nextState);
-        return true;
+        break;
+    }
+    // A state change is handled right away
+    if (appData.nStateChanges != nStateChanges)
+    {
+        appData.tDeadline = appData.tNow;
+    }
+    // An event is checkpointed once its start time is known
+    if (appData.bCheckpointDue && !(appData.stateApp == APP_STATE_RUNNING && appData.bStartState))
+    {
+        appData.bCheckpointDue = false;
+        Save_Checkpoint();
+        Sync_Announce(appData.stateApp, appData.tStartTime, (uint8_t)Schedule_Selected());
     }
-    showCountdownTime();
-    return false;
+    return appData.tDeadline;
 }
 /**
  * @brief Main application loop
@@ -510,78 +1046,28 @@ bool HandleTimedState(double timeLimit, int track, APP_STATES nextState)
  */
 void APP_Main(void)
 {
+    for (int nPhase = 0; nPhase < BOOT_PHASES; nPhase++)
+    {
+        appData.atBoot[nPhase] = -1;
+    }
+    Boot_Mark(BOOT_APP_MAIN);
     HW_Initialize();
     APP_Initialize();
     ESP_LOGI(TAG, "Initialized");
+    Memory_Log_Stats();
 
-    appData.tStartTime = esp_timer_get_time(); // Record start time in microseconds
-    appData.dLastSeconds = 0;
-
-    for (;;)
+    // Sleep until the next deadline or until a button press changes the state
+    int64_t tDeadline = HAL_Get_Time();
+    while (HAL_Wait_Until(tDeadline))
     {
+        int64_t tWoke = HAL_Get_Time();
 
-        // Wait for the timer to tell us to run another step.  Note that we will
-        // timeout after double the expected time just to keep us running.
-        xSemaphoreTake(appData.hTimerSemaphore, 2 * TIMER_INTERVAL);
-        appData.tNow = esp_timer_get_time();
-        // Compute the elapsed time to the nearest 10th of a second.
-        appData.dElapsedSeconds = roundf((float)(appData.tNow - appData.tStartTime) / 100000.0) / 10.0;
-
-        switch (appData.stateApp)
+        // Early wakes come from events, only the deadline can be late
+        if (tDeadline != HAL_NO_DEADLINE && tWoke >= tDeadline)
         {
-        case APP_STATE_CODEBUSTERS:
-            ScrollCodebusters();
-            break;
-        case APP_STATE_WAIT_START:
-            appData.amDigits[0] = Get_Segment_Mask(5);
-            appData.amDigits[1] = Get_Segment_Mask(0);
-            Timer_Display();
-            break;
-        case APP_STATE_TIMED_QUESTION:
-
-            if (appData.bStartState)
-            {
-                appData.tStartTime = appData.tNow;
-                appData.dElapsedSeconds = 0;
-                appData.bStartState = false;
-            }
-            HandleTimedState(END_TIMED_SECONDS, TRACK_NO_MORE_TIMED_BONUS, APP_STATE_WAIT_25_MINUTES);
-            break;
-        case APP_STATE_WAIT_25_MINUTES:
-            HandleTimedState(ANNOUNCE_25_MINUTES, TRACK_25_MINUTES_REMAIN, APP_STATE_WAIT_10_MINUTES);
-            break;
-        case APP_STATE_WAIT_10_MINUTES:
-            HandleTimedState(ANNOUNCE_10_MINUTES, TRACK_10_MINUTES_REMAIN, APP_STATE_WAIT_2_MINUTES);
-            break;
-        case APP_STATE_WAIT_2_MINUTES:
-            HandleTimedState(ANNOUNCE_2_MINUTES, TRACK_2_MINUTES_REMAIN, APP_STATE_WAIT_10_SECONDS);
-            break;
-        case APP_STATE_WAIT_10_SECONDS:
-            HandleTimedState(FINAL_SECONDS, -1, APP_STATE_FINAL_10SECONDS);
-            break;
-
-        case APP_STATE_FINAL_10SECONDS:
-            if (appData.dElapsedSeconds >= EVENT_LENGTH)
-            {
-                dfplayer_play_track(TRACK_TIMES_UP);
-                Switch_To_State(APP_STATE_DONE);
-            }
-            showSecondsCountdownTime();
-            break;
-        case APP_STATE_DONE:
-            if (appData.bStartState)
-            {
-                appData.tStartTime = appData.tNow;
-                appData.dElapsedSeconds = 0;
-                appData.bStartState = false;
-
-                appData.amDigits[0] = Get_Segment_Mask(0);
-                appData.amDigits[1] = Get_Segment_Mask(0);
-                Timer_Display();
-            }
-            break;
-        case APP_STATE_CONFIG:
-            break;
+            Histogram_Record(&appData.histWake, tWoke - tDeadline);
         }
+        appData.nWakeups++;
+        tDeadline = APP_Tasks();
     }
-}
+}
\ No newline at end of file
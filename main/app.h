@@ -37,25 +37,21 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
-#include <math.h>
 #include <string.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
-#include <freertos/timers.h>
-#include <freertos/semphr.h>
-#include <led_strip.h>
-#include <esp_system.h>
-#include <nvs_flash.h>
 #include <esp_log.h>
 #include <esp_err.h>
-#include <esp_random.h>
-#include <driver/gpio.h>
-#include <esp_log.h>
-#include <esp_system.h>
-#include <nvs_flash.h>
-#include <esp_timer.h>
-#include <driver/uart.h>
+#include "hal.h"
+#include "layout_map.h"
+#include "dfplayer.h"
+#include "dlog.h"
+#include "histogram.h"
+#include "render.h"
+#include "schedule.h"
+#include "checkpoint.h"
+#include "sync.h"
+#include "trace.h"
 
 #ifdef __cplusplus // Provide C++ Compatibility
 
@@ -70,27 +66,50 @@ extern "C"
   {
     APP_STATE_CODEBUSTERS,     // We are showing the codebusters logo
     APP_STATE_WAIT_START,      // Displaying the number of minutes left, waiting for the start button
-    APP_STATE_TIMED_QUESTION,  // Initial 10 minute interval for the timed question
-    APP_STATE_WAIT_25_MINUTES, // Timed question complete, waiting for half way point
-    APP_STATE_WAIT_10_MINUTES, // Waiting for 10 minutes remaining
-    APP_STATE_WAIT_2_MINUTES,  // Waiting for 2 minutes remaining
-    APP_STATE_WAIT_10_SECONDS, // Waiting for the last 10 seconds
-    APP_STATE_FINAL_10SECONDS, // Final 10 seconds (showing second timer) waiting for end
+    APP_STATE_RUNNING,         // Event under way, following the timeline of the schedule
     APP_STATE_DONE,            // Test complete
-    APP_STATE_CONFIG,          // COnfiguration mode (currently does nothing)
+    APP_STATE_CONFIG,          // Choosing the schedule, a press steps to the next one
   } APP_STATES;
 
+  /**
+   * @brief Milestones of the startup, timestamped to track boot time
+   *
+   */
+  typedef enum
+  {
+    BOOT_APP_MAIN,    // APP_Main entered
+    BOOT_LEDS_READY,  // LED strip driver is up
+    BOOT_FIRST_FRAME, // First frame clocked out to the strip
+    BOOT_AUDIO_READY, // DFPlayer reported ready and takes commands
+    BOOT_RESUMED,     // Event picked back up from a checkpoint
+    BOOT_PHASES,      // Number of phases
+  } BOOT_PHASE;
+
   /**
    * @brief Configuration for the LEDs on the display
-   * Note that each segment consists of several LEDS in the strip and the period is
-   * a single LED in the strip.
+   * Each segment is a run of LEDs in the strip and the period is a single
+   * LED.  Which LED lights for which segment is described in display.layout,
+   * which the build turns into the tables in layout_map.h.
    */
-#define DISPLAY_DIGITS 2
+#define DISPLAY_DIGITS LAYOUT_DIGITS
 #define DIGIT_SEGMENTS 8
-#define BASE_LEDS_PER_SEGMENT 7
 
-// Numbers of the LED in the strip
-#define LED_STRIP_TOTAL_LEDS (DISPLAY_DIGITS * (((DIGIT_SEGMENTS - 1) * BASE_LEDS_PER_SEGMENT) + 1))
+// Numbers of the LED in all the strips
+#define LED_STRIP_TOTAL_LEDS LAYOUT_TOTAL_LEDS
+
+/**
+ * @brief Digits can be spread over several strips, each on its own GPIO and
+ * RMT channel, which are all refreshed at the same time.  DIGIT_STRIPS gives
+ * the strip of each digit from left to right, and the digits on one strip
+ * are chained in that order.  A four digit MM:SS display on two strips has
+ * four digit lines in display.layout and
+ *   #define LED_STRIPS 2
+ *   #define LED_STRIP_GPIOS {LED_STRIP_PORT, 10}
+ *   #define DIGIT_STRIPS {0, 0, 1, 1}
+ */
+#define LED_STRIPS 1
+#define LED_STRIP_GPIOS {LED_STRIP_PORT}
+#define DIGIT_STRIPS {0, 0}
 /**
  * @brief Masks for the segments to display
  *
@@ -104,17 +123,40 @@ extern "C"
 #define SEG_G (0x01 << 6)
 #define SEG_DOT (0x01 << 7)
 #define SEG_ALL (SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G | SEG_DOT)
+// Shown for values and characters without a glyph (a question mark)
+#define GLYPH_UNKNOWN (SEG_A | SEG_B | SEG_E | SEG_G | SEG_DOT)
+
+// Message scrolled while in APP_STATE_CODEBUSTERS
+#define SCROLL_MESSAGE "COdEbuST^ERS  "
+#define SCROLL_MESSAGE_MAX 32
+
+#define US_PER_TENTH 100000
 
-#define TICKS_PER_SECOND 24
-#define TIMER_INTERVAL (pdMS_TO_TICKS(1000 / TICKS_PER_SECOND))
+// Set to 0 to format DLOG messages where they are logged rather than in the drain task
+#define DLOG_DEFERRED 1
+// Set to 0 to run at a fixed clock rather than scaling it down and light
+// sleeping between deadlines (also needs CONFIG_PM_ENABLE)
+#define POWER_SAVE_ENABLE 1
+// Set to 0 to create the tasks, semaphores and queues from the heap rather
+// than from static memory counted in the link-time RAM budget
+#define STATIC_ALLOCATION_ENABLE 1
 
 // GPIO assignments
 #define LED_STRIP_PORT 9
 #define PUSH_BUTTON_PORT GPIO_NUM_15
+// Set to 1 to also accept a capacitive touch pad as the button
+#define TOUCH_BUTTON_ENABLE 0
+#define TOUCH_BUTTON_CHANNEL TOUCH_PAD_NUM1
 
 #define UART_NUM UART_NUM_1
 #define TXD_PIN GPIO_NUM_16
 #define RXD_PIN GPIO_NUM_17
+// The spare UART for the sync link between timers, with the console on USB.
+// The port is a plain number so the preprocessor can compare it with the console's.
+#define SYNC_UART_PORT 0
+#define SYNC_UART_NUM ((uart_port_t)SYNC_UART_PORT)
+#define SYNC_TXD_PIN GPIO_NUM_43
+#define SYNC_RXD_PIN GPIO_NUM_44
   /**
    * @brief
    *
@@ -137,19 +179,40 @@ extern "C"
 #define RGB_PURPLE rgb(255, 0, 255)
 #define RGB_BLUE rgb(0, 0, 255)
 /**
- * @brief Button press intervals
+ * @brief Brightness and power budget of the LEDs.  Colors go through a
+ * gamma corrected brightness table, then the whole frame is dimmed if the
+ * estimated current would exceed the budget.
+ */
+#define LED_BRIGHTNESS 255         // Overall brightness (0-255) applied before gamma
+#define LED_CURRENT_BUDGET_MA 1500 // Most the strips may draw from the 5V supply
+#define LED_CHANNEL_UA 20000       // Draw of one color channel of one LED at full scale
+#define LED_IDLE_UA 1000           // Draw of one LED with everything off
+/**
+ * @brief How long the display fades from one scene to the next.  A change
+ * of digits has to finish fading before the tenths countdown changes them
+ * again.
+ */
+#define DISPLAY_COLOR_FADE_US 250000  // Color changes between states
+#define DISPLAY_SCROLL_FADE_US 150000 // Each step of the Codebusters scroll
+#define DISPLAY_DIGIT_FADE_US 60000   // Any other change of the digits
+/**
+ * @brief Button gesture timing in microseconds
  */
-#define TICKS_PRESSED 2
-#define TICKS_DOUBLETAP 10
-#define TICKS_REQUEST_RESET (TICKS_PER_SECOND * 2)
-#define TICKS_REQUEST_CONFIG (TICKS_PER_SECOND * 5)
-
-#define DFPLAYER_CMD_LENGTH 10
-#define DFPLAYER_INIT_DELAY_MS 2000 // Initial power-on wait
-#define DFPLAYER_RETRY_DELAY_MS 100 // Retry delay for first command
-#define DFPLAYER_RETRY_COUNT 2      // How many times to retry first play command
+#define BUTTON_DOUBLETAP_US 416000       // Press this soon after a release ends the event
+#define BUTTON_REQUEST_RESET_US 2000000  // Hold to go back to waiting for the start
+#define BUTTON_REQUEST_CONFIG_US 5000000 // Hold to go to configuration
 /**
- * @brief Player tracks
+ * @brief Keys typed on the console
+ */
+#define CONSOLE_TIMING_DUMP 'h'  // Log the timing histograms
+#define CONSOLE_TIMING_RESET 'c' // Clear the timing histograms
+#define CONSOLE_TRACE_DUMP 't'   // Dump the golden trace
+#define CONSOLE_POWER_DUMP 'p'   // Log the time in each power state
+#define CONSOLE_MEMORY_DUMP 'm'  // Log the RAM used and the stack high-water marks
+#define CONSOLE_SYNC_STEP 's'    // Step to the next sync role and link, used from the next boot
+
+/**
+ * @brief Player tracks, used by the built in schedules
  */
 #define TRACK_WELCOME_TO_CODEBUSTERS 2
 #define TRACK_NO_MORE_TIMED_BONUS 1
@@ -157,62 +220,110 @@ extern "C"
 #define TRACK_10_MINUTES_REMAIN 4
 #define TRACK_2_MINUTES_REMAIN 5
 #define TRACK_TIMES_UP 6
-/**
- * @brief Time intervals
- */
-#if 1
-#define END_TIMED_SECONDS (10 * 60)
-#define ANNOUNCE_25_MINUTES (25 * 60)
-#define ANNOUNCE_10_MINUTES (40 * 60)
-#define ANNOUNCE_2_MINUTES (48 * 60)
-#define FINAL_SECONDS ((50 * 60) - 10)
-#define EVENT_LENGTH (50 * 60)
-#define SCALE_SPEED (1)
-#else
-#define END_TIMED_SECONDS (10)
-#define ANNOUNCE_25_MINUTES (15)
-#define ANNOUNCE_10_MINUTES (30)
-#define ANNOUNCE_2_MINUTES (38)
-#define FINAL_SECONDS (40)
-#define EVENT_LENGTH (50)
-#define SCALE_SPEED (60)
-#endif
 
   typedef struct
   {
-    int nPressedCount;                 // Ticks that the button is pressed
-    int nReleasedCount;                // Ticks that the button is released
-    APP_STATES stateApp;               // Application state
-    bool bStartState;                  // Flag indicating that the state was just started
-    int64_t tStartTime;                // Time in microseconds that we started
-    int64_t tNow;                      // Current time in microseconds
-    double dLastSeconds;               // Last time we updated display
-    double dElapsedSeconds;            // Total elapsed seconds since start
-    uint32_t amDigits[DISPLAY_DIGITS]; // Digits to display
-    SemaphoreHandle_t hTimerSemaphore; // Semaphore to run a tick
-    led_strip_handle_t ahLEDStrip;     // IO Handle for the LED Strip
+    bool bButtonDown;                           // Button is held according to the edges seen
+    int64_t tButtonPress;                       // Time of the last press edge
+    int64_t tButtonRelease;                     // Time of the last release edge
+    int64_t tButtonEdge;                        // Time of the last edge of either kind
+    bool bResetHandled;                         // The reset hold of this press has been acted on
+    bool bConfigHandled;                        // The config hold of this press has been acted on
+    APP_STATES stateApp;                        // Application state
+    APP_STATES stateAtPress;                    // Application state when the button went down
+    bool bStartState;                           // Flag indicating that the state was just started
+    uint32_t nStateChanges;                     // Calls to Switch_To_State
+    int64_t tStartTime;                         // Time in microseconds that we started
+    int64_t tNow;                               // Current time in microseconds
+    int64_t tDeadline;                          // When APP_Tasks next needs to run
+    HISTOGRAM histWake;                         // How late the app woke for its deadlines
+    uint32_t nWakeups;                          // Times APP_Tasks has run
+    uint32_t nButtonEdges;                      // Debounced button edges handled
+    int32_t nLastShown;                         // Slot, second or tenth last put on the display
+    int32_t nElapsedTenths;                     // Total elapsed tenths of a second since start
+    const TIMELINE *pTimeline;                  // Timeline of the event under way
+    int nCursor;                                // Next entry of pTimeline to happen
+    int nAudioCursor;                           // Next entry of pTimeline whose track is still to be sent
+    rgb_t rgbPhase;                             // Color of the event since the last entry
+    uint8_t nPhaseFlags;                        // SCHEDULE_TENTHS when the last entry asked for tenths
+    CHECKPOINT checkpoint;                      // Checkpoint found at boot
+    bool bResume;                               // Entries already due are applied without their tracks
+    bool bStartSet;                             // tStartTime is set before entering the running state
+    bool bResumeWarm;                           // checkpoint came through a warm reset
+    bool bCheckpointDue;                        // A transition has not been checkpointed yet
+    uint32_t nFlashWritesAtStart;               // Checkpoint flash writes before the event started
+    uint32_t amDigits[DISPLAY_DIGITS];          // Digits to display
+    uint32_t amScrollMasks[SCROLL_MESSAGE_MAX]; // SCROLL_MESSAGE encoded as segments
+    int nScrollLength;                          // Characters in amScrollMasks
+    rgb_t rgbShown;                             // Color last handed to the compositor
+    int64_t tDisplayDue;                        // When the clock changed what Timer_Display shows next, 0 if not timed
+    uint8_t nBrightness;                        // Overall brightness of the LEDs (0-255)
+    int anDigitStrip[DISPLAY_DIGITS];           // Strip each digit is on
+    int anDigitFirstLed[DISPLAY_DIGITS];        // First LED of each digit within its strip
+    int anStripLeds[LED_STRIPS];                // Number of LEDs on each strip
+    int64_t atBoot[BOOT_PHASES];                // When each boot phase was reached, -1 for not yet
+    uint32_t nHeapAtStartup;                    // Heap free once everything was started
   } APP_DATA;
 
   extern APP_DATA appData;
 
-  extern uint32_t Get_Segment_Mask(int nVal);
+  extern const uint8_t amDigitGlyphs[16];
+  extern const uint8_t amCharGlyphs[256];
+
+  /**
+   * @brief Return which segments correspond to a given character
+   *
+   * @param ch Character to look up
+   * @return uint32_t Mask of segments to turn on
+   */
+  static inline uint32_t Get_Segment_Mask(char ch)
+  {
+    return amCharGlyphs[(uint8_t)ch];
+  }
+  /**
+   * @brief Return which segments correspond to a numeric value
+   *
+   * @param nDigit Value 0-15 to look up
+   * @return uint32_t Mask of segments to turn on, GLYPH_UNKNOWN when out of range
+   */
+  static inline uint32_t Get_Digit_Mask(int nDigit)
+  {
+    return ((unsigned)nDigit < 16) ? amDigitGlyphs[nDigit] : GLYPH_UNKNOWN;
+  }
+
+  extern int Encode_Glyphs(const char *pszText, uint32_t *amMasks, int nMaxMasks);
 
-  extern led_strip_handle_t configure_led(int gpio);
   extern rgb_t getRGB(void);
-  extern void Process_Tick(TimerHandle_t xTimer);
-  extern void dfplayer_send_command(uint8_t command, uint16_t param);
-  extern void dfplayer_play_track(uint16_t track_num);
-  extern void dfplayer_set_volume(uint8_t volume);
-  extern void dfplayer_safe_init(uint8_t initial_volume, uint16_t test_track);
-  extern void init_uart(void);
+  extern void Button_Process(void);
+  extern void Audio_Process(void);
   extern void Timer_Display(void);
+  extern void Timer_Display_Log_Stats(void);
+  extern void Timing_Log_Histograms(void);
+  extern void Power_Log_Stats(void);
+  extern void Memory_Log_Stats(void);
+  extern void Console_Command(char cKey);
   extern void HW_Initialize(void);
+  extern void Display_Initialize(void);
+  extern void Display_Right_Digits(uint32_t mTens, uint32_t mOnes);
+  extern void Boot_Mark(BOOT_PHASE phase);
+  extern void Boot_Mark_At(BOOT_PHASE phase, int64_t tAt);
   extern void APP_Initialize(void);
   extern void ScrollCodebusters(void);
   extern void showSecondsCountdownTime(void);
   extern void showCountdownTime(void);
   extern void Switch_To_State(APP_STATES newState);
-  extern bool HandleTimedState(double timeLimit, int track, APP_STATES nextState);
+  extern void Display_Minutes(int nMinutes);
+  extern void Run_Timeline_Audio(void);
+  extern void Run_Timeline(void);
+  extern void Save_Checkpoint(void);
+  extern void Resume_Checkpoint(void);
+  extern void Follow_Leader(int64_t tStart, APP_STATES stateLeader, int nSchedule);
+  extern void Sync_Process(void);
+  extern int32_t Elapsed_Tenths(int64_t tElapsed);
+  extern void Wake_At_Time(int64_t tWake);
+  extern int64_t Tenths_Time(int32_t nTenths);
+  extern void Wake_At_Tenths(int32_t nTenths);
+  extern int64_t APP_Tasks(void);
   extern void APP_Main(void);
 #endif /* _APP_H */
 
@@ -0,0 +1,163 @@
+/**
+ * @file checkpoint.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Run checkpoints kept through a reset or a power loss
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include "app.h"
+#include "checkpoint.h"
+
+static const char *TAG = "checkpoint";
+
+typedef struct
+{
+    CHECKPOINT last;        // Newest record in flash
+    bool bLastValid;        // last holds a record
+    int nNextSlot;          // Flash record the next write replaces
+    CHECKPOINT_STATS stats; // Counters
+} CHECKPOINT_DATA;
+
+static CHECKPOINT_DATA checkpointData;
+
+/**
+ * @brief Check whether two checkpoints describe the same point of the same event
+ *
+ * @param pA First checkpoint
+ * @param pB Second checkpoint
+ * @return true Same
+ * @return false Different, so a new record is needed
+ */
+static bool Checkpoint_Same(const CHECKPOINT *pA, const CHECKPOINT *pB)
+{
+    return pA->bRunning == pB->bRunning &&
+           pA->nSchedule == pB->nSchedule &&
+           pA->nElapsedTenths == pB->nElapsedTenths &&
+           pA->tStartEpoch == pB->tStartEpoch;
+}
+/**
+ * @brief Find the newest checkpoint.  Retained memory is only valid after a
+ * warm reset and is always at least as new as flash, so it is used when it
+ * is there.  Flash keeps a log of CHECKPOINT_SLOTS records, each written in
+ * turn, and the one with the highest sequence number wins.
+ *
+ * @param pCheckpoint Where to put the checkpoint
+ * @param pbWarm Returns true when it came from retained memory
+ * @return true A checkpoint was found
+ * @return false Nothing was stored, as on a first boot
+ */
+bool Checkpoint_Initialize(CHECKPOINT *pCheckpoint, bool *pbWarm)
+{
+    CHECKPOINT record;
+    char szKey[CHECKPOINT_KEY_LENGTH];
+
+    memset(&checkpointData, 0, sizeof(checkpointData));
+    // Scan the whole log so the next write replaces the oldest record
+    for (int nSlot = 0; nSlot < CHECKPOINT_SLOTS; nSlot++)
+    {
+        snprintf(szKey, sizeof(szKey), CHECKPOINT_KEY, nSlot);
+        if (HAL_Settings_Load(szKey, &record, sizeof(record)) && record.nVersion == CHECKPOINT_VERSION &&
+            (!checkpointData.bLastValid || (int32_t)(record.nSequence - checkpointData.last.nSequence) > 0))
+        {
+            checkpointData.last = record;
+            checkpointData.bLastValid = true;
+            checkpointData.nNextSlot = (nSlot + 1) % CHECKPOINT_SLOTS;
+        }
+    }
+    *pbWarm = HAL_Retained_Load(&record, sizeof(record)) && record.nVersion == CHECKPOINT_VERSION;
+    if (*pbWarm)
+    {
+        *pCheckpoint = record;
+    }
+    else if (checkpointData.bLastValid)
+    {
+        *pCheckpoint = checkpointData.last;
+    }
+    else
+    {
+        return false;
+    }
+    ESP_LOGI(TAG, "%s checkpoint %lu: %s schedule %d at %ld.%ld", *pbWarm ? "Warm" : "Cold",
+             (unsigned long)pCheckpoint->nSequence, pCheckpoint->bRunning ? "running" : "idle",
+             pCheckpoint->nSchedule, (long)(pCheckpoint->nElapsedTenths / 10),
+             (long)(pCheckpoint->nElapsedTenths % 10));
+    return true;
+}
+/**
+ * @brief Record a state transition.  Retained memory is written every time,
+ * flash only when the checkpoint differs from the newest record, so
+ * transitions between the idle states cost no flash writes at all.
+ *
+ * @param pCheckpoint Checkpoint to keep
+ */
+void Checkpoint_Save(const CHECKPOINT *pCheckpoint)
+{
+    CHECKPOINT record = *pCheckpoint;
+    char szKey[CHECKPOINT_KEY_LENGTH];
+    bool bChanged = !checkpointData.bLastValid || !Checkpoint_Same(&record, &checkpointData.last);
+
+    record.nVersion = CHECKPOINT_VERSION;
+    record.nReserved = 0;
+    record.nSequence = checkpointData.last.nSequence + (bChanged ? 1 : 0);
+    HAL_Retained_Save(&record, sizeof(record));
+    checkpointData.stats.nRetainedWrites++;
+    if (!bChanged)
+    {
+        checkpointData.stats.nFlashSkipped++;
+        return;
+    }
+    snprintf(szKey, sizeof(szKey), CHECKPOINT_KEY, checkpointData.nNextSlot);
+    if (HAL_Settings_Save(szKey, &record, sizeof(record)))
+    {
+        checkpointData.last = record;
+        checkpointData.bLastValid = true;
+        checkpointData.nNextSlot = (checkpointData.nNextSlot + 1) % CHECKPOINT_SLOTS;
+        checkpointData.stats.nFlashWrites++;
+    }
+}
+/**
+ * @brief Get the checkpoint counters
+ *
+ * @return const CHECKPOINT_STATS* Counters since boot
+ */
+const CHECKPOINT_STATS *Checkpoint_Get_Stats(void)
+{
+    return &checkpointData.stats;
+}
+/**
+ * @brief Log the checkpoint counters
+ *
+ */
+void Checkpoint_Log_Stats(void)
+{
+    ESP_LOGI(TAG, "Checkpoints: %lu retained, %lu flash writes, %lu flash writes skipped",
+             (unsigned long)checkpointData.stats.nRetainedWrites,
+             (unsigned long)checkpointData.stats.nFlashWrites,
+             (unsigned long)checkpointData.stats.nFlashSkipped);
+}
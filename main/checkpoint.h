@@ -0,0 +1,85 @@
+/**
+ * @file checkpoint.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Run checkpoints kept through a reset or a power loss
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+#define CHECKPOINT_SLOTS 4      // Flash records the checkpoint log rotates through
+#define CHECKPOINT_KEY "ckpt%d" // Setting holding each flash record
+#define CHECKPOINT_KEY_LENGTH 8 // Room for a formatted CHECKPOINT_KEY
+#define CHECKPOINT_VERSION 1    // Layout of a stored CHECKPOINT
+
+  /**
+   * @brief Where the event was at its last state transition
+   *
+   */
+  typedef struct
+  {
+    int64_t tStartEpoch;    // HAL_Get_Epoch time the event started
+    uint32_t nSequence;     // Increases with every record written to flash
+    int32_t nElapsedTenths; // Elapsed time of the event when this was taken
+    uint8_t nVersion;       // CHECKPOINT_VERSION
+    uint8_t bRunning;       // An event is under way
+    uint8_t nSchedule;      // Schedule the event runs
+    uint8_t nReserved;      // Zero
+  } CHECKPOINT;
+
+  /**
+   * @brief Counters kept by the checkpoint log
+   *
+   */
+  typedef struct
+  {
+    uint32_t nRetainedWrites; // Checkpoints kept in retained memory
+    uint32_t nFlashWrites;    // Checkpoints written to flash
+    uint32_t nFlashSkipped;   // Checkpoints not written because flash already had them
+  } CHECKPOINT_STATS;
+
+  extern bool Checkpoint_Initialize(CHECKPOINT *pCheckpoint, bool *pbWarm);
+  extern void Checkpoint_Save(const CHECKPOINT *pCheckpoint);
+  extern const CHECKPOINT_STATS *Checkpoint_Get_Stats(void);
+  extern void Checkpoint_Log_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CHECKPOINT_H */
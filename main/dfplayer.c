@@ -0,0 +1,589 @@
+/**
+ * @file dfplayer.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Asynchronous command pipeline for the DFPlayer (YX5200) audio module
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "app.h"
+#include "dfplayer.h"
+
+static const char *TAG = "DFPlayer";
+
+/**
+ * @brief Where the command being sent is in its exchange with the module
+ *
+ */
+typedef enum
+{
+    DFPLAYER_IDLE,     // Nothing in flight
+    DFPLAYER_WAIT_ACK, // Sent, waiting for the module to answer
+    DFPLAYER_BACKOFF,  // Failed, waiting to send it again
+} DFPLAYER_STEP;
+
+typedef struct
+{
+    EVENT_RING ringCommands;                   // Commands from the app task
+    EVENT_RING ringEvents;                     // Events for the app task
+    uint32_t anPending[DFPLAYER_QUEUE_LENGTH]; // Packed commands not yet sent, oldest first
+    int nPending;                              // Number of pending commands
+    uint32_t nInFlight;                        // Packed command being sent
+    DFPLAYER_STEP step;                        // Where the in flight command is
+    int nAttempts;                             // Times the in flight command has been sent
+    int64_t tStep;                             // When the ACK wait or backoff ends
+    uint8_t aRX[DFPLAYER_CMD_LENGTH];          // Frame being received
+    int nRX;                                   // Bytes of the frame received
+    uint16_t nLastFinished;                    // Track of the last finished report
+    int64_t tLastFinished;                     // Time of the last finished report
+    int64_t tPowerOn;                          // When the audio task was started
+    bool bReady;                               // Module reported online or acknowledged a command
+    int32_t atLatency[DFPLAYER_MAX_TRACKS];    // Command to playback latency of each track, 0 until measured
+    int32_t atSaved[DFPLAYER_MAX_TRACKS];      // atLatency as last written to flash
+    uint16_t nProbeTrack;                      // Track being watched for its start, 0 for none
+    bool bProbeWaiting;                        // A status query has not been answered yet
+    int64_t tPlaySent;                         // When the last play command was written
+    int64_t tProbe;                            // When the last status query was written
+    int64_t tProbePrev;                        // When the status query before it was written
+    DFPLAYER_STATS stats;                      // Counters
+} DFPLAYER_DATA;
+
+static DFPLAYER_DATA dfplayerData;
+
+/**
+ * @brief Compute checksum (2's complement of sum of bytes 1 to 6)
+ *
+ * @param cmd Command bytes to checksum
+ * @return uint16_t Place to put checksum value
+ */
+static uint16_t dfplayer_checksum(const uint8_t *cmd)
+{
+    uint16_t sum = 0;
+    for (int i = 1; i < 7; i++)
+    {
+        sum += cmd[i];
+    }
+    return 0xFFFF - sum + 1;
+}
+/**
+ * @brief Build a DFPlayer frame with checksum
+ *
+ * @param pFrame Where to put the DFPLAYER_CMD_LENGTH bytes
+ * @param command Command to send to the player
+ * @param param Parameter for the command
+ * @param bFeedback Ask the player to ACK the command
+ */
+void dfplayer_encode(uint8_t *pFrame, uint8_t command, uint16_t param, bool bFeedback)
+{
+    pFrame[0] = 0x7E;                // Start byte
+    pFrame[1] = 0xFF;                // Version
+    pFrame[2] = 0x06;                // Length
+    pFrame[3] = command;             // Command
+    pFrame[4] = bFeedback ? 1 : 0;   // Feedback requested
+    pFrame[5] = (param >> 8) & 0xFF; // High byte of param
+    pFrame[6] = param & 0xFF;        // Low byte of param
+
+    uint16_t checksum = dfplayer_checksum(pFrame);
+    pFrame[7] = (checksum >> 8) & 0xFF; // Checksum high byte
+    pFrame[8] = checksum & 0xFF;        // Checksum low byte
+    pFrame[9] = 0xEF;                   // End byte
+}
+/**
+ * @brief Start the audio task.  It owns the UART from here on.
+ *
+ */
+void dfplayer_initialize(void)
+{
+    memset(&dfplayerData, 0, sizeof(dfplayerData));
+    dfplayerData.tPowerOn = HAL_Get_Time();
+    if (!HAL_Settings_Load(DFPLAYER_LATENCY_KEY, dfplayerData.atLatency, sizeof(dfplayerData.atLatency)))
+    {
+        memset(dfplayerData.atLatency, 0, sizeof(dfplayerData.atLatency));
+    }
+    memcpy(dfplayerData.atSaved, dfplayerData.atLatency, sizeof(dfplayerData.atSaved));
+    HAL_UART_Initialize(&dfplayer_service);
+}
+/**
+ * @brief Queue a DFPlayer command for the audio task.  Never blocks, so it
+ * is safe to call from the display loop.
+ *
+ * @param command Command to send to the player
+ * @param param Parameter for the command
+ */
+void dfplayer_send_command(uint8_t command, uint16_t param)
+{
+    EVENT event = {
+        .eType = EVENT_AUDIO_COMMAND,
+        .tTime = HAL_Get_Time(),
+        .nParam = DFPLAYER_PACK(command, param),
+    };
+
+    if (Event_Ring_Push(&dfplayerData.ringCommands, &event))
+    {
+        HAL_UART_Wake_Service();
+    }
+}
+/**
+ * @brief Play a specific track number
+ *
+ * @param track_num Which track number to play
+ */
+void dfplayer_play_track(uint16_t track_num)
+{
+    dfplayer_send_command(DFPLAYER_CMD_PLAY_TRACK, track_num);
+}
+/**
+ * @brief Set Volume
+ *
+ * @param volume Volume (0-30)
+ */
+void dfplayer_set_volume(uint8_t volume)
+{
+    dfplayer_send_command(DFPLAYER_CMD_SET_VOLUME, volume);
+}
+/**
+ * @brief Pass an event back to the app task
+ *
+ * @param eType What happened
+ * @param tNow Time it happened
+ * @param nParam Event specific value
+ */
+static void dfplayer_post_event(EVENT_TYPE eType, int64_t tNow, uint32_t nParam)
+{
+    EVENT event = {
+        .eType = eType,
+        .tTime = tNow,
+        .nParam = nParam,
+    };
+
+    if (Event_Ring_Push(&dfplayerData.ringEvents, &event))
+    {
+        HAL_Wake_App();
+    }
+}
+/**
+ * @brief The module can take commands now
+ *
+ * @param tNow Current time
+ */
+static void dfplayer_ready(int64_t tNow)
+{
+    if (!dfplayerData.bReady)
+    {
+        dfplayerData.bReady = true;
+        dfplayer_post_event(EVENT_AUDIO_READY, tNow, 0);
+    }
+}
+/**
+ * @brief Add a command to the pending list.  A volume command replaces one
+ * that has not been sent yet, since only the newest setting matters.  A play
+ * command is always added, every announcement queued is meant to be heard.
+ *
+ * @param nPacked Packed command to add
+ */
+static void dfplayer_enqueue(uint32_t nPacked)
+{
+    dfplayerData.stats.nQueued++;
+    for (int n = 0; n < dfplayerData.nPending && DFPLAYER_COMMAND(nPacked) == DFPLAYER_CMD_SET_VOLUME; n++)
+    {
+        if (DFPLAYER_COMMAND(dfplayerData.anPending[n]) == DFPLAYER_COMMAND(nPacked))
+        {
+            dfplayerData.stats.nCoalesced++;
+            dfplayerData.anPending[n] = nPacked;
+            return;
+        }
+    }
+    if (dfplayerData.nPending >= DFPLAYER_QUEUE_LENGTH)
+    {
+        dfplayerData.stats.nDropped++;
+        DLOG(DLOG_QUEUE_FULL, DFPLAYER_COMMAND(nPacked));
+        return;
+    }
+    dfplayerData.anPending[dfplayerData.nPending++] = nPacked;
+}
+/**
+ * @brief Write the in flight command to the module and wait for its ACK
+ *
+ * @param tNow Current time
+ */
+static void dfplayer_transmit(int64_t tNow)
+{
+    uint8_t aFrame[DFPLAYER_CMD_LENGTH];
+
+    dfplayer_encode(aFrame, DFPLAYER_COMMAND(dfplayerData.nInFlight), DFPLAYER_PARAM(dfplayerData.nInFlight), true);
+    HAL_UART_Write(aFrame, sizeof(aFrame));
+    Trace_Audio(tNow, DFPLAYER_COMMAND(dfplayerData.nInFlight), DFPLAYER_PARAM(dfplayerData.nInFlight));
+    if (DFPLAYER_COMMAND(dfplayerData.nInFlight) == DFPLAYER_CMD_PLAY_TRACK)
+    {
+        // A new track stops the one being watched
+        dfplayerData.tPlaySent = tNow;
+        dfplayerData.nProbeTrack = 0;
+    }
+    dfplayerData.stats.nSent++;
+    dfplayerData.nAttempts++;
+    dfplayerData.step = DFPLAYER_WAIT_ACK;
+    dfplayerData.tStep = tNow + DFPLAYER_ACK_TIMEOUT_US;
+    DLOG(DLOG_COMMAND_SENT, DFPLAYER_COMMAND(dfplayerData.nInFlight), DFPLAYER_PARAM(dfplayerData.nInFlight),
+         dfplayerData.nAttempts);
+}
+/**
+ * @brief The in flight command was rejected or never answered.  Back off
+ * and send it again, or give up after DFPLAYER_RETRY_COUNT retries.
+ *
+ * @param tNow Current time
+ */
+static void dfplayer_failed(int64_t tNow)
+{
+    if (dfplayerData.nAttempts > DFPLAYER_RETRY_COUNT)
+    {
+        dfplayerData.stats.nFailed++;
+        DLOG(DLOG_COMMAND_GIVE_UP, DFPLAYER_COMMAND(dfplayerData.nInFlight), DFPLAYER_PARAM(dfplayerData.nInFlight));
+        dfplayer_post_event(EVENT_AUDIO_FAILED, tNow, dfplayerData.nInFlight);
+        dfplayerData.step = DFPLAYER_IDLE;
+        return;
+    }
+    dfplayerData.step = DFPLAYER_BACKOFF;
+    dfplayerData.tStep = tNow + ((int64_t)DFPLAYER_RETRY_BACKOFF_US << (dfplayerData.nAttempts - 1));
+}
+/**
+ * @brief Fold a measured start of a track into its latency.  The first
+ * measurement is taken as it is, later ones are smoothed so one slow read of
+ * the card barely moves it.
+ *
+ * @param nTrack Track that started
+ * @param tSample Time from writing the play command to the track playing
+ */
+static void dfplayer_record_latency(uint16_t nTrack, int64_t tSample)
+{
+    int32_t tLatency = (int32_t)tSample;
+
+    dfplayerData.stats.nMeasured++;
+    if (nTrack < DFPLAYER_MAX_TRACKS)
+    {
+        if (dfplayerData.atLatency[nTrack] != 0)
+        {
+            tLatency = dfplayerData.atLatency[nTrack] + (tLatency - dfplayerData.atLatency[nTrack]) / 4;
+        }
+        dfplayerData.atLatency[nTrack] = tLatency;
+    }
+    DLOG(DLOG_TRACK_LATENCY, nTrack, (int32_t)tSample, tLatency);
+}
+/**
+ * @brief The module answered a status query while a track is being watched.
+ * The track started somewhere between the module getting the query before
+ * this one and getting this one, so the middle of the two is taken.
+ *
+ * @param nStatus Parameter of the status frame
+ */
+static void dfplayer_probe_answered(uint16_t nStatus)
+{
+    if (dfplayerData.nProbeTrack == 0 || !dfplayerData.bProbeWaiting)
+    {
+        return;
+    }
+    dfplayerData.bProbeWaiting = false;
+    if ((nStatus & 0xFF) == DFPLAYER_STATUS_PLAYING)
+    {
+        int64_t tStarted = (dfplayerData.tProbePrev + dfplayerData.tProbe) / 2 + DFPLAYER_FRAME_US;
+
+        dfplayer_record_latency(dfplayerData.nProbeTrack, tStarted - dfplayerData.tPlaySent);
+        dfplayerData.nProbeTrack = 0;
+    }
+}
+/**
+ * @brief Watch a track that was just acknowledged until it starts playing,
+ * with a status query every DFPLAYER_PROBE_US.  Only runs while no command
+ * is in flight, and the queries are not traced since they change nothing.
+ *
+ * @param tNow Current time
+ * @return int64_t When to query again, HAL_NO_DEADLINE when done
+ */
+static int64_t dfplayer_probe(int64_t tNow)
+{
+    uint8_t aFrame[DFPLAYER_CMD_LENGTH];
+
+    if (dfplayerData.nProbeTrack == 0)
+    {
+        return HAL_NO_DEADLINE;
+    }
+    if (tNow - dfplayerData.tPlaySent > DFPLAYER_LATENCY_MAX_US)
+    {
+        dfplayerData.stats.nUnseen++;
+        dfplayerData.nProbeTrack = 0;
+        return HAL_NO_DEADLINE;
+    }
+    if (dfplayerData.bProbeWaiting)
+    {
+        if (tNow < dfplayerData.tProbe + DFPLAYER_PROBE_TIMEOUT_US)
+        {
+            return dfplayerData.tProbe + DFPLAYER_PROBE_TIMEOUT_US;
+        }
+        // Lost, the next query brackets the start from further back
+        dfplayerData.bProbeWaiting = false;
+    }
+    if (tNow < dfplayerData.tProbe + DFPLAYER_PROBE_US)
+    {
+        return dfplayerData.tProbe + DFPLAYER_PROBE_US;
+    }
+    dfplayer_encode(aFrame, DFPLAYER_CMD_QUERY_STATUS, 0, false);
+    HAL_UART_Write(aFrame, sizeof(aFrame));
+    dfplayerData.stats.nProbes++;
+    dfplayerData.tProbePrev = dfplayerData.tProbe;
+    dfplayerData.tProbe = tNow;
+    dfplayerData.bProbeWaiting = true;
+    return tNow + DFPLAYER_PROBE_TIMEOUT_US;
+}
+/**
+ * @brief Act on a complete frame from the module
+ *
+ * @param tNow Current time
+ */
+static void dfplayer_handle_frame(int64_t tNow)
+{
+    const uint8_t *pFrame = dfplayerData.aRX;
+    uint16_t checksum = dfplayer_checksum(pFrame);
+    uint16_t param = (pFrame[5] << 8) | pFrame[6];
+
+    if (pFrame[9] != 0xEF || pFrame[7] != ((checksum >> 8) & 0xFF) || pFrame[8] != (checksum & 0xFF))
+    {
+        dfplayerData.stats.nBadFrames++;
+        return;
+    }
+    switch (pFrame[3])
+    {
+    case DFPLAYER_RSP_ACK:
+        if (dfplayerData.step == DFPLAYER_WAIT_ACK)
+        {
+            dfplayerData.stats.nAcked++;
+            dfplayerData.step = DFPLAYER_IDLE;
+            dfplayer_ready(tNow);
+            if (DFPLAYER_COMMAND(dfplayerData.nInFlight) == DFPLAYER_CMD_PLAY_TRACK)
+            {
+                dfplayerData.nProbeTrack = DFPLAYER_PARAM(dfplayerData.nInFlight);
+                dfplayerData.bProbeWaiting = false;
+                dfplayerData.tProbe = dfplayerData.tPlaySent;
+            }
+        }
+        break;
+    case DFPLAYER_RSP_ERROR:
+        dfplayerData.stats.nErrors++;
+        DLOG(DLOG_MODULE_ERROR, param);
+        if (dfplayerData.step == DFPLAYER_WAIT_ACK)
+        {
+            dfplayer_failed(tNow);
+        }
+        break;
+    case DFPLAYER_RSP_FINISHED_USB:
+    case DFPLAYER_RSP_FINISHED_SD:
+    case DFPLAYER_RSP_FINISHED_FLASH:
+        if (param == dfplayerData.nLastFinished &&
+            tNow - dfplayerData.tLastFinished < DFPLAYER_DUPLICATE_US)
+        {
+            break;
+        }
+        dfplayerData.nLastFinished = param;
+        dfplayerData.tLastFinished = tNow;
+        dfplayerData.stats.nFinished++;
+        dfplayer_post_event(EVENT_AUDIO_FINISHED, tNow, param);
+        break;
+    case DFPLAYER_RSP_ONLINE:
+        ESP_LOGI(TAG, "Module online, storage %u", param);
+        dfplayer_ready(tNow);
+        break;
+    case DFPLAYER_RSP_STATUS:
+        dfplayer_probe_answered(param);
+        break;
+    }
+}
+/**
+ * @brief Pull everything the module has sent and split it into frames
+ *
+ * @param tNow Current time
+ */
+static void dfplayer_receive(int64_t tNow)
+{
+    uint8_t aBuffer[32];
+    size_t nRead;
+
+    while ((nRead = HAL_UART_Read(aBuffer, sizeof(aBuffer))) > 0)
+    {
+        for (size_t n = 0; n < nRead; n++)
+        {
+            // Resynchronize on the start byte
+            if (dfplayerData.nRX == 0 && aBuffer[n] != 0x7E)
+            {
+                continue;
+            }
+            dfplayerData.aRX[dfplayerData.nRX++] = aBuffer[n];
+            if (dfplayerData.nRX == DFPLAYER_CMD_LENGTH)
+            {
+                dfplayerData.nRX = 0;
+                dfplayer_handle_frame(tNow);
+            }
+        }
+    }
+}
+/**
+ * @brief Run the audio pipeline.  Called by the audio task whenever a
+ * command is queued, bytes arrive from the module, or the returned deadline
+ * passes.  Only one command is in flight at a time, and nothing is sent
+ * until the module reports online or DFPLAYER_INIT_DELAY_US has passed
+ * since power on.  Once idle, a track that just started is watched to
+ * measure its latency.
+ *
+ * @param tNow Current time in microseconds
+ * @return int64_t When to run again if nothing else happens
+ */
+int64_t dfplayer_service(int64_t tNow)
+{
+    EVENT event;
+
+    while (Event_Ring_Pop(&dfplayerData.ringCommands, &event))
+    {
+        dfplayer_enqueue(event.nParam);
+    }
+    dfplayer_receive(tNow);
+    if (!dfplayerData.bReady && tNow - dfplayerData.tPowerOn < DFPLAYER_INIT_DELAY_US)
+    {
+        return dfplayerData.tPowerOn + DFPLAYER_INIT_DELAY_US;
+    }
+
+    if (dfplayerData.step != DFPLAYER_IDLE && tNow >= dfplayerData.tStep)
+    {
+        if (dfplayerData.step == DFPLAYER_WAIT_ACK)
+        {
+            dfplayerData.stats.nTimeouts++;
+            dfplayer_failed(tNow);
+        }
+        if (dfplayerData.step == DFPLAYER_BACKOFF && tNow >= dfplayerData.tStep)
+        {
+            dfplayerData.stats.nRetries++;
+            dfplayer_transmit(tNow);
+        }
+    }
+    if (dfplayerData.step == DFPLAYER_IDLE && dfplayerData.nPending > 0)
+    {
+        dfplayerData.nInFlight = dfplayerData.anPending[0];
+        dfplayerData.nPending--;
+        memmove(dfplayerData.anPending, dfplayerData.anPending + 1, dfplayerData.nPending * sizeof(uint32_t));
+        dfplayerData.nAttempts = 0;
+        dfplayer_transmit(tNow);
+    }
+    if (dfplayerData.step == DFPLAYER_IDLE)
+    {
+        return dfplayer_probe(tNow);
+    }
+    return dfplayerData.tStep;
+}
+/**
+ * @brief Get how long after its play command a track is heard, so the app
+ * can send the command that much early.  A track that has not been measured
+ * yet gets DFPLAYER_LATENCY_US.
+ *
+ * @param track_num Track to be played
+ * @return int64_t Latency in microseconds
+ */
+int64_t dfplayer_track_latency(uint16_t track_num)
+{
+    if (track_num < DFPLAYER_MAX_TRACKS && dfplayerData.atLatency[track_num] != 0)
+    {
+        return dfplayerData.atLatency[track_num];
+    }
+    return DFPLAYER_LATENCY_US;
+}
+/**
+ * @brief Keep the latency of each track in flash for the next boot.  Only
+ * written when one has moved by DFPLAYER_LATENCY_SAVE_US, so an event
+ * usually costs no write.  Only the app task may call this.
+ *
+ */
+void dfplayer_save_latency(void)
+{
+    int32_t atLatency[DFPLAYER_MAX_TRACKS];
+    bool bChanged = false;
+
+    // The audio task may be measuring, take one copy to compare and save
+    memcpy(atLatency, dfplayerData.atLatency, sizeof(atLatency));
+    for (int n = 0; n < DFPLAYER_MAX_TRACKS; n++)
+    {
+        if (abs(atLatency[n] - dfplayerData.atSaved[n]) >= DFPLAYER_LATENCY_SAVE_US)
+        {
+            bChanged = true;
+        }
+    }
+    if (bChanged && HAL_Settings_Save(DFPLAYER_LATENCY_KEY, atLatency, sizeof(atLatency)))
+    {
+        memcpy(dfplayerData.atSaved, atLatency, sizeof(atLatency));
+    }
+}
+/**
+ * @brief Get the next event the audio task has for the app.  Only the app
+ * task may call this.
+ *
+ * @param pEvent Where to put the event
+ * @return true An event was returned
+ * @return false No events are waiting
+ */
+bool dfplayer_get_event(EVENT *pEvent)
+{
+    return Event_Ring_Pop(&dfplayerData.ringEvents, pEvent);
+}
+/**
+ * @brief Get the counters of the audio pipeline
+ *
+ * @return const DFPLAYER_STATS* Counters
+ */
+const DFPLAYER_STATS *dfplayer_get_stats(void)
+{
+    return &dfplayerData.stats;
+}
+/**
+ * @brief Log the counters of the audio pipeline
+ *
+ */
+void dfplayer_log_stats(void)
+{
+    const DFPLAYER_STATS *pStats = &dfplayerData.stats;
+
+    ESP_LOGI(TAG, "%lu queued, %lu coalesced, %lu dropped, %lu sent, %lu acked",
+             (unsigned long)pStats->nQueued, (unsigned long)pStats->nCoalesced,
+             (unsigned long)pStats->nDropped, (unsigned long)pStats->nSent,
+             (unsigned long)pStats->nAcked);
+    ESP_LOGI(TAG, "%lu errors, %lu timeouts, %lu retries, %lu failed, %lu finished, %lu bad frames",
+             (unsigned long)pStats->nErrors, (unsigned long)pStats->nTimeouts,
+             (unsigned long)pStats->nRetries, (unsigned long)pStats->nFailed,
+             (unsigned long)pStats->nFinished, (unsigned long)pStats->nBadFrames);
+    ESP_LOGI(TAG, "%lu status queries, %lu track starts measured, %lu never seen",
+             (unsigned long)pStats->nProbes, (unsigned long)pStats->nMeasured, (unsigned long)pStats->nUnseen);
+    for (int n = 1; n < DFPLAYER_MAX_TRACKS; n++)
+    {
+        if (dfplayerData.atLatency[n] != 0)
+        {
+            ESP_LOGI(TAG, "Track %d starts %ld ms after its command", n, (long)(dfplayerData.atLatency[n] / 1000));
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file dfplayer.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Asynchronous command pipeline for the DFPlayer (YX5200) audio module
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _DFPLAYER_H
+#define _DFPLAYER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "events.h"
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+#define DFPLAYER_CMD_LENGTH 10
+#define DFPLAYER_QUEUE_LENGTH 8          // Commands waiting to be sent
+#define DFPLAYER_INIT_DELAY_US 2000000   // Power-on wait when the module does not report online
+#define DFPLAYER_ACK_TIMEOUT_US 200000   // Longest wait for the module to ACK a command
+#define DFPLAYER_RETRY_BACKOFF_US 100000 // First retry delay, doubled on each retry
+#define DFPLAYER_RETRY_COUNT 3           // Retries before a command is given up on
+#define DFPLAYER_DUPLICATE_US 200000     // The module reports a finished track twice within this
+#define DFPLAYER_FRAME_US 10417          // Time to send one frame at 9600 baud
+#define DFPLAYER_MAX_TRACKS 16           // Tracks with a latency of their own, others use the default
+#define DFPLAYER_LATENCY_US 100000       // Latency of a track that has not been measured yet
+#define DFPLAYER_LATENCY_MAX_US 1000000  // Longest wait for a track to start playing
+#define DFPLAYER_PROBE_US 25000          // Shortest spacing of the status queries while a track starts
+#define DFPLAYER_PROBE_TIMEOUT_US 100000 // Longest wait for the answer to a status query
+#define DFPLAYER_LATENCY_SAVE_US 5000    // Change in a latency worth a flash write
+#define DFPLAYER_LATENCY_KEY "audiolat"  // Setting holding the latency of each track
+
+/**
+ * @brief Commands sent to the module
+ */
+#define DFPLAYER_CMD_PLAY_TRACK 0x03
+#define DFPLAYER_CMD_SET_VOLUME 0x06
+#define DFPLAYER_CMD_QUERY_STATUS 0x42
+/**
+ * @brief Frames reported by the module
+ */
+#define DFPLAYER_RSP_FINISHED_USB 0x3C
+#define DFPLAYER_RSP_FINISHED_SD 0x3D
+#define DFPLAYER_RSP_FINISHED_FLASH 0x3E
+#define DFPLAYER_RSP_ONLINE 0x3F
+#define DFPLAYER_RSP_ERROR 0x40
+#define DFPLAYER_RSP_ACK 0x41
+#define DFPLAYER_RSP_STATUS 0x42
+#define DFPLAYER_STATUS_PLAYING 1 // Low byte of the status while a track plays
+
+// Pack a command and its parameter into an EVENT nParam
+#define DFPLAYER_PACK(command, param) (((uint32_t)(command) << 16) | (uint16_t)(param))
+#define DFPLAYER_COMMAND(packed) ((uint8_t)((packed) >> 16))
+#define DFPLAYER_PARAM(packed) ((uint16_t)(packed))
+
+  /**
+   * @brief Counters for the audio pipeline
+   *
+   */
+  typedef struct
+  {
+    uint32_t nQueued;    // Commands requested by the app
+    uint32_t nCoalesced; // Commands replaced by a newer one before being sent
+    uint32_t nDropped;   // Commands lost because the queue was full
+    uint32_t nSent;      // Frames written to the UART, including retries
+    uint32_t nAcked;     // Commands the module acknowledged
+    uint32_t nErrors;    // Error frames from the module
+    uint32_t nTimeouts;  // Commands the module never answered
+    uint32_t nRetries;   // Commands sent again after a failure
+    uint32_t nFailed;    // Commands given up on
+    uint32_t nFinished;  // Tracks the module finished playing
+    uint32_t nBadFrames; // Received frames with a bad checksum or framing
+    uint32_t nProbes;    // Status queries sent while a track starts
+    uint32_t nMeasured;  // Tracks whose start was seen
+    uint32_t nUnseen;    // Tracks that never reported playing
+  } DFPLAYER_STATS;
+
+  extern void dfplayer_encode(uint8_t *pFrame, uint8_t command, uint16_t param, bool bFeedback);
+  extern void dfplayer_initialize(void);
+  extern void dfplayer_send_command(uint8_t command, uint16_t param);
+  extern void dfplayer_play_track(uint16_t track_num);
+  extern void dfplayer_set_volume(uint8_t volume);
+  extern int64_t dfplayer_service(int64_t tNow);
+  extern int64_t dfplayer_track_latency(uint16_t track_num);
+  extern void dfplayer_save_latency(void);
+  extern bool dfplayer_get_event(EVENT *pEvent);
+  extern const DFPLAYER_STATS *dfplayer_get_stats(void);
+  extern void dfplayer_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DFPLAYER_H */
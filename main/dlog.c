@@ -0,0 +1,392 @@
+/**
+ * @file dlog.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Deferred binary log, formatted off the timing critical path
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "app.h"
+#include "dlog.h"
+
+static const char *TAG = "dlog";
+
+#define DLOG_LEVEL(id, level, tag, format) level,
+#define DLOG_TAG(id, level, tag, format) tag,
+#define DLOG_FORMAT(id, level, tag, format) format,
+
+static const char acDlogLevels[DLOG_MESSAGE_COUNT] = {DLOG_MESSAGES(DLOG_LEVEL)};
+static const char *const apszDlogTags[DLOG_MESSAGE_COUNT] = {DLOG_MESSAGES(DLOG_TAG)};
+static const char *const apszDlogFormats[DLOG_MESSAGE_COUNT] = {DLOG_MESSAGES(DLOG_FORMAT)};
+
+/**
+ * @brief Ring of records from any number of tasks to the drain task.  A
+ * writer claims a slot by moving nHead on with a compare and swap, fills
+ * it, then publishes it by storing its sequence number in anPublished, so
+ * the drain never reads a slot that is still being written.
+ *
+ */
+typedef struct
+{
+    DLOG_RECORD aRecords[DLOG_RING_SIZE];    // Ring storage
+    atomic_uint anPublished[DLOG_RING_SIZE]; // One more than the count of the record in each slot, once written
+    atomic_uint nHead;                       // Count of slots claimed by writers
+    atomic_uint nTail;                       // Count of records drained, written by the drain task
+    uint32_t nDroppedReported;               // nDropped when the drain last warned about it
+    DLOG_STATS stats;                        // Counters
+} DLOG_DATA;
+
+static DLOG_DATA dlogData;
+// Kept apart from dlogData so the level can be set before Dlog_Initialize
+static int nDlogLevelRank = 3;
+
+/**
+ * @brief Rank a log level letter so they can be compared
+ *
+ * @param cLevel ESP-IDF level letter (E, W, I, D, V)
+ * @return int Rank of the level, higher is more verbose
+ */
+static int Dlog_Level_Rank(char cLevel)
+{
+    switch (cLevel)
+    {
+    case 'E':
+        return 1;
+    case 'W':
+        return 2;
+    case 'I':
+        return 3;
+    case 'D':
+        return 4;
+    case 'V':
+        return 5;
+    }
+    return 0;
+}
+#if !DLOG_DEFERRED
+/**
+ * @brief Format a record and log it with ESP_LOG at its level
+ *
+ * @param pRecord Record to log
+ */
+static void Dlog_Print(const DLOG_RECORD *pRecord)
+{
+    char szText[DLOG_TEXT_MAX];
+    const char *pszTag = Dlog_Tag(pRecord);
+
+    Dlog_Format(pRecord, szText, sizeof(szText));
+    switch (Dlog_Level(pRecord))
+    {
+    case 'E':
+        ESP_LOGE(pszTag, "%s", szText);
+        break;
+    case 'W':
+        ESP_LOGW(pszTag, "%s", szText);
+        break;
+    case 'I':
+        ESP_LOGI(pszTag, "%s", szText);
+        break;
+    default:
+        ESP_LOGD(pszTag, "%s", szText);
+        break;
+    }
+}
+#endif
+/**
+ * @brief Empty the ring and start counting again.  Call before the drain
+ * task is started with HAL_Log_Initialize.
+ *
+ */
+void Dlog_Initialize(void)
+{
+    memset(&dlogData, 0, sizeof(dlogData));
+    HAL_Log_Initialize(&Dlog_Service);
+}
+/**
+ * @brief Record a message for the drain task.  This only copies the
+ * arguments, so it is cheap enough for the timing critical tasks.  When
+ * the ring is full the message is dropped and counted.  Use it through
+ * the DLOG macro.
+ *
+ * @param nId Message to log
+ * @param anArgs Arguments of its format
+ * @param nArgs Number of arguments, at most DLOG_MAX_ARGS are kept
+ */
+void Dlog_Write(DLOG_ID nId, const int32_t *anArgs, size_t nArgs)
+{
+    DLOG_RECORD record = {
+        .tTime = (uint32_t)HAL_Get_Time(),
+        .nId = (uint16_t)nId,
+        .nArgs = (uint8_t)(nArgs < DLOG_MAX_ARGS ? nArgs : DLOG_MAX_ARGS),
+    };
+
+    if ((unsigned)nId >= DLOG_MESSAGE_COUNT || Dlog_Level_Rank(acDlogLevels[nId]) > nDlogLevelRank)
+    {
+        return;
+    }
+    memcpy(record.anArgs, anArgs, record.nArgs * sizeof(int32_t));
+#if !DLOG_DEFERRED
+    Dlog_Print(&record);
+#else
+    unsigned nHead = atomic_load_explicit(&dlogData.nHead, memory_order_relaxed);
+    unsigned nTail;
+
+    do
+    {
+        nTail = atomic_load_explicit(&dlogData.nTail, memory_order_acquire);
+        if (nHead - nTail >= DLOG_RING_SIZE)
+        {
+            atomic_fetch_add_explicit(&dlogData.stats.nDropped, 1, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&dlogData.nHead, &nHead, nHead + 1,
+                                                    memory_order_relaxed, memory_order_relaxed));
+    dlogData.aRecords[nHead & (DLOG_RING_SIZE - 1)] = record;
+    // Publish the record only after it is completely written
+    atomic_store_explicit(&dlogData.anPublished[nHead & (DLOG_RING_SIZE - 1)], nHead + 1, memory_order_seq_cst);
+    atomic_fetch_add_explicit(&dlogData.stats.nWritten, 1, memory_order_relaxed);
+    // The drain runs until it reaches a slot not yet published and leaves
+    // nTail there, whether the ring was empty or a writer was still between
+    // its claim and its publish.  Either way it needs a wake once this slot
+    // is published.  The tail is read again after the publish, and both
+    // sides are sequentially consistent, so the drain either saw the record
+    // or its nTail is seen here.
+    if (atomic_load_explicit(&dlogData.nTail, memory_order_seq_cst) == nHead)
+    {
+        HAL_Log_Wake_Service();
+    }
+#endif
+}
+/**
+ * @brief Drain task service.  Sends every published record to the console
+ * as a DLOG_PREFIX line for the host decoder.  It runs below every other
+ * task, so the console only gets the time nothing else needs.
+ *
+ * @param tNow Current time in microseconds
+ * @return int64_t HAL_NO_DEADLINE, the next record wakes it
+ */
+int64_t Dlog_Service(int64_t tNow)
+{
+    unsigned nTail = atomic_load_explicit(&dlogData.nTail, memory_order_relaxed);
+    unsigned nQueued = atomic_load_explicit(&dlogData.nHead, memory_order_relaxed) - nTail;
+    uint32_t nDropped = atomic_load_explicit(&dlogData.stats.nDropped, memory_order_relaxed);
+    char szLine[DLOG_LINE_MAX];
+
+    if (nQueued > dlogData.stats.nMaxQueued)
+    {
+        dlogData.stats.nMaxQueued = nQueued;
+    }
+    // Sequentially consistent against the writer's publish and reread of nTail
+    while (atomic_load_explicit(&dlogData.anPublished[nTail & (DLOG_RING_SIZE - 1)], memory_order_seq_cst) ==
+           nTail + 1)
+    {
+        DLOG_RECORD record = dlogData.aRecords[nTail & (DLOG_RING_SIZE - 1)];
+
+        // Hand the slot back only after the record has been copied out
+        atomic_store_explicit(&dlogData.nTail, ++nTail, memory_order_seq_cst);
+        Dlog_Encode(&record, szLine);
+        HAL_Console_Write(szLine);
+        dlogData.stats.nDrained++;
+    }
+    if (nDropped != dlogData.nDroppedReported)
+    {
+        ESP_LOGW(TAG, "%lu records dropped", (unsigned long)(nDropped - dlogData.nDroppedReported));
+        dlogData.nDroppedReported = nDropped;
+    }
+    return HAL_NO_DEADLINE;
+}
+/**
+ * @brief Set the most verbose level of message to record
+ *
+ * @param cLevel ESP-IDF level letter, 'N' to record nothing
+ */
+void Dlog_Set_Level(char cLevel)
+{
+    nDlogLevelRank = Dlog_Level_Rank(cLevel);
+}
+/**
+ * @brief Write a record as a console line: DLOG_PREFIX, then the time, id,
+ * argument count and arguments as little endian hex
+ *
+ * @param pRecord Record to write
+ * @param pszLine Where to put the line, DLOG_LINE_MAX characters
+ * @return size_t Length of the line
+ */
+size_t Dlog_Encode(const DLOG_RECORD *pRecord, char *pszLine)
+{
+    static const char acHex[] = "0123456789abcdef";
+    uint8_t aBytes[4 + 2 + 1 + 4 * DLOG_MAX_ARGS];
+    size_t nBytes = 0;
+    size_t nLength = sizeof(DLOG_PREFIX) - 1;
+
+    for (int n = 0; n < 4; n++)
+    {
+        aBytes[nBytes++] = (uint8_t)(pRecord->tTime >> (8 * n));
+    }
+    aBytes[nBytes++] = (uint8_t)pRecord->nId;
+    aBytes[nBytes++] = (uint8_t)(pRecord->nId >> 8);
+    aBytes[nBytes++] = pRecord->nArgs;
+    for (int nArg = 0; nArg < pRecord->nArgs; nArg++)
+    {
+        for (int n = 0; n < 4; n++)
+        {
+            aBytes[nBytes++] = (uint8_t)((uint32_t)pRecord->anArgs[nArg] >> (8 * n));
+        }
+    }
+    memcpy(pszLine, DLOG_PREFIX, nLength);
+    for (size_t n = 0; n < nBytes; n++)
+    {
+        pszLine[nLength++] = acHex[aBytes[n] >> 4];
+        pszLine[nLength++] = acHex[aBytes[n] & 0x0f];
+    }
+    pszLine[nLength] = '\0';
+    return nLength;
+}
+/**
+ * @brief Get the value of a hex digit
+ *
+ * @param ch Character to convert
+ * @return int Value 0-15, -1 when not a hex digit
+ */
+static int Dlog_Hex_Value(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+    {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f')
+    {
+        return ch - 'a' + 10;
+    }
+    return -1;
+}
+/**
+ * @brief Read back a line written by Dlog_Encode
+ *
+ * @param pszLine Console line, with or without the line ending
+ * @param pRecord Where to put the record
+ * @return true The line is a valid record
+ * @return false The line is something else
+ */
+bool Dlog_Decode(const char *pszLine, DLOG_RECORD *pRecord)
+{
+    uint8_t aBytes[4 + 2 + 1 + 4 * DLOG_MAX_ARGS];
+    size_t nBytes = 0;
+    const char *pch;
+
+    if (strncmp(pszLine, DLOG_PREFIX, sizeof(DLOG_PREFIX) - 1) != 0)
+    {
+        return false;
+    }
+    for (pch = pszLine + sizeof(DLOG_PREFIX) - 1; nBytes < sizeof(aBytes); pch += 2)
+    {
+        int nHigh = Dlog_Hex_Value(pch[0]);
+        int nLow = nHigh < 0 ? -1 : Dlog_Hex_Value(pch[1]);
+        if (nLow < 0)
+        {
+            break;
+        }
+        aBytes[nBytes++] = (uint8_t)((nHigh << 4) | nLow);
+    }
+    if (nBytes < 7 || (*pch != '\0' && *pch != '\r' && *pch != '\n'))
+    {
+        return false;
+    }
+    memset(pRecord, 0, sizeof(*pRecord));
+    pRecord->tTime = aBytes[0] | (aBytes[1] << 8) | (aBytes[2] << 16) | ((uint32_t)aBytes[3] << 24);
+    pRecord->nId = (uint16_t)(aBytes[4] | (aBytes[5] << 8));
+    pRecord->nArgs = aBytes[6];
+    if (pRecord->nId >= DLOG_MESSAGE_COUNT || pRecord->nArgs > DLOG_MAX_ARGS || nBytes != 7 + 4u * pRecord->nArgs)
+    {
+        return false;
+    }
+    for (int nArg = 0; nArg < pRecord->nArgs; nArg++)
+    {
+        const uint8_t *pArg = &aBytes[7 + 4 * nArg];
+        pRecord->anArgs[nArg] = (int32_t)(pArg[0] | (pArg[1] << 8) | (pArg[2] << 16) | ((uint32_t)pArg[3] << 24));
+    }
+    return true;
+}
+/**
+ * @brief Format the message of a record
+ *
+ * @param pRecord Record to format
+ * @param pszText Where to put the text
+ * @param nMax Size of pszText
+ * @return int Length of the text, as snprintf
+ */
+int Dlog_Format(const DLOG_RECORD *pRecord, char *pszText, size_t nMax)
+{
+    const int32_t *anArgs = pRecord->anArgs;
+
+    if (pRecord->nId >= DLOG_MESSAGE_COUNT)
+    {
+        return snprintf(pszText, nMax, "unknown message %u", pRecord->nId);
+    }
+    // Unused arguments are zero, and extra arguments are ignored by printf
+    return snprintf(pszText, nMax, apszDlogFormats[pRecord->nId], anArgs[0], anArgs[1], anArgs[2], anArgs[3]);
+}
+/**
+ * @brief Get the level letter of a record
+ *
+ * @param pRecord Record
+ * @return char ESP-IDF level letter
+ */
+char Dlog_Level(const DLOG_RECORD *pRecord)
+{
+    return pRecord->nId < DLOG_MESSAGE_COUNT ? acDlogLevels[pRecord->nId] : 'E';
+}
+/**
+ * @brief Get the tag of the module that logged a record
+ *
+ * @param pRecord Record
+ * @return const char* Tag
+ */
+const char *Dlog_Tag(const DLOG_RECORD *pRecord)
+{
+    return pRecord->nId < DLOG_MESSAGE_COUNT ? apszDlogTags[pRecord->nId] : TAG;
+}
+/**
+ * @brief Get the deferred log counters
+ *
+ * @return const DLOG_STATS* Counters
+ */
+const DLOG_STATS *Dlog_Get_Stats(void)
+{
+    return &dlogData.stats;
+}
+/**
+ * @brief Report how the deferred log kept up
+ *
+ */
+void Dlog_Log_Stats(void)
+{
+    ESP_LOGI(TAG, "%lu written, %lu drained, %lu dropped, %lu most queued of %d",
+             (unsigned long)atomic_load(&dlogData.stats.nWritten), (unsigned long)dlogData.stats.nDrained,
+             (unsigned long)atomic_load(&dlogData.stats.nDropped), (unsigned long)dlogData.stats.nMaxQueued,
+             DLOG_RING_SIZE);
+}
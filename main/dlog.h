@@ -0,0 +1,136 @@
+/**
+ * @file dlog.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Deferred binary log, formatted off the timing critical path
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _DLOG_H
+#define _DLOG_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+// Must be a power of two so the indexes can wrap freely
+#define DLOG_RING_SIZE 64
+#define DLOG_MAX_ARGS 4
+// Start of a drained record on the console, followed by the record in hex
+#define DLOG_PREFIX "DLOG "
+// Longest drained line: prefix, time, id, argument count and arguments in hex
+#define DLOG_LINE_MAX (sizeof(DLOG_PREFIX) + 2 * (4 + 2 + 1 + 4 * DLOG_MAX_ARGS) + 1)
+// Longest formatted message
+#define DLOG_TEXT_MAX 96
+
+/**
+ * @brief Every message that can be logged through DLOG.  Each is
+ * X(id, level, tag, format), where the format only takes int sized
+ * arguments (%d, %u, %x and their widths) since the arguments are stored
+ * as int32_t.  The decoder is built from this same list, so a message is
+ * only ever added at the end.
+ */
+#define DLOG_MESSAGES(X)                                                          \
+  X(DLOG_REMAIN, 'I', "app", "Remain: %02d:%02d Time: %d.%d")                     \
+  X(DLOG_TRACK_FINISHED, 'D', "app", "Track %u finished")                         \
+  X(DLOG_COMMAND_FAILED, 'W', "app", "DFPlayer command %02x %u failed")           \
+  X(DLOG_QUEUE_FULL, 'W', "DFPlayer", "Queue full, dropping command %02x")        \
+  X(DLOG_COMMAND_SENT, 'D', "DFPlayer", "Sent %02x %u (attempt %d)")              \
+  X(DLOG_COMMAND_GIVE_UP, 'W', "DFPlayer", "Giving up on command %02x %u")        \
+  X(DLOG_MODULE_ERROR, 'W', "DFPlayer", "Module reported error %u")                \
+  X(DLOG_TRACK_LATENCY, 'D', "DFPlayer", "Track %u started after %d us, latency %d us")
+
+#define DLOG_ENUM(id, level, tag, format) id,
+
+  /**
+   * @brief Identifier of each DLOG message
+   *
+   */
+  typedef enum
+  {
+    DLOG_MESSAGES(DLOG_ENUM)
+    DLOG_MESSAGE_COUNT, // Number of messages
+  } DLOG_ID;
+
+  /**
+   * @brief One logged message, with its arguments still in binary
+   *
+   */
+  typedef struct
+  {
+    uint32_t tTime;                // HAL_Get_Time when logged, low 32 bits
+    uint16_t nId;                  // DLOG_ID of the message
+    uint8_t nArgs;                 // Arguments used in anArgs
+    uint8_t nReserved;             // Zero
+    int32_t anArgs[DLOG_MAX_ARGS]; // Arguments of the format
+  } DLOG_RECORD;
+
+  /**
+   * @brief Counters kept by the deferred log
+   *
+   */
+  typedef struct
+  {
+    atomic_uint nWritten; // Records put in the ring
+    atomic_uint nDropped; // Records lost because the ring was full
+    uint32_t nDrained;    // Records taken out by the drain task
+    uint32_t nMaxQueued;  // Most records waiting at once
+  } DLOG_STATS;
+
+/**
+ * @brief Log a message by id with one to DLOG_MAX_ARGS int arguments.
+ * Only the record is stored here, formatting waits for the drain task.
+ * Any task may log, but not an interrupt.
+ */
+#define DLOG(id, ...)                                      \
+  Dlog_Write((id), (const int32_t[]){__VA_ARGS__},         \
+             sizeof((const int32_t[]){__VA_ARGS__}) / sizeof(int32_t))
+
+  extern void Dlog_Initialize(void);
+  extern void Dlog_Write(DLOG_ID nId, const int32_t *anArgs, size_t nArgs);
+  extern int64_t Dlog_Service(int64_t tNow);
+  extern void Dlog_Set_Level(char cLevel);
+  extern size_t Dlog_Encode(const DLOG_RECORD *pRecord, char *pszLine);
+  extern bool Dlog_Decode(const char *pszLine, DLOG_RECORD *pRecord);
+  extern int Dlog_Format(const DLOG_RECORD *pRecord, char *pszText, size_t nMax);
+  extern char Dlog_Level(const DLOG_RECORD *pRecord);
+  extern const char *Dlog_Tag(const DLOG_RECORD *pRecord);
+  extern const DLOG_STATS *Dlog_Get_Stats(void);
+  extern void Dlog_Log_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DLOG_H */
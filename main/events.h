@@ -0,0 +1,142 @@
+/**
+ * @file events.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Typed events passed between tasks through lock-free rings
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _EVENTS_H
+#define _EVENTS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+// Must be a power of two so the indexes can wrap freely
+#define EVENT_RING_SIZE 16
+
+  /**
+   * @brief Kinds of event the app task handles
+   *
+   */
+  typedef enum
+  {
+    EVENT_BUTTON_PRESS,   // Debounced press of the button
+    EVENT_BUTTON_RELEASE, // Debounced release of the button
+    EVENT_AUDIO_COMMAND,  // Command for the DFPlayer, nParam from DFPLAYER_PACK
+    EVENT_AUDIO_FINISHED, // DFPlayer finished playing, nParam is the track
+    EVENT_AUDIO_FAILED,   // DFPlayer never took a command, nParam from DFPLAYER_PACK
+    EVENT_AUDIO_READY,    // DFPlayer is up and taking commands
+    EVENT_SYNC_ANNOUNCE,  // Event of this timer for the followers, tTime is its start, nParam from SYNC_PACK
+    EVENT_SYNC_LEADER,    // Event of the leader, tTime is its start in local time, nParam from SYNC_PACK
+    EVENT_CONSOLE_KEY,    // Key typed on the console, nParam is the character
+  } EVENT_TYPE;
+
+  /**
+   * @brief Something that happened outside the app task, timestamped where it happened
+   *
+   */
+  typedef struct
+  {
+    EVENT_TYPE eType; // What happened
+    int64_t tTime;    // When it happened in microseconds
+    uint32_t nParam;  // Event specific value
+  } EVENT;
+
+  /**
+   * @brief Single producer, single consumer ring of events.
+   * The producer only writes nHead and the consumer only writes nTail, so
+   * neither side needs a lock and the producer may be an interrupt.
+   *
+   */
+  typedef struct
+  {
+    EVENT aEvents[EVENT_RING_SIZE]; // Ring storage
+    atomic_uint nHead;              // Count of events pushed, written by the producer
+    atomic_uint nTail;              // Count of events popped, written by the consumer
+    uint32_t nDropped;              // Events lost because the ring was full
+  } EVENT_RING;
+
+  /**
+   * @brief Add an event to the ring.  Only the producer may call this.
+   *
+   * @param pRing Ring to add to
+   * @param pEvent Event to copy in
+   * @return true Event was added
+   * @return false Ring is full, the event is dropped
+   */
+  static inline bool Event_Ring_Push(EVENT_RING *pRing, const EVENT *pEvent)
+  {
+    unsigned nHead = atomic_load_explicit(&pRing->nHead, memory_order_relaxed);
+    unsigned nTail = atomic_load_explicit(&pRing->nTail, memory_order_acquire);
+
+    if (nHead - nTail >= EVENT_RING_SIZE)
+    {
+      pRing->nDropped++;
+      return false;
+    }
+    pRing->aEvents[nHead & (EVENT_RING_SIZE - 1)] = *pEvent;
+    // Publish the event only after it is completely written
+    atomic_store_explicit(&pRing->nHead, nHead + 1, memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Take the oldest event from the ring.  Only the consumer may call this.
+   *
+   * @param pRing Ring to take from
+   * @param pEvent Where to copy the event
+   * @return true An event was returned
+   * @return false Ring is empty
+   */
+  static inline bool Event_Ring_Pop(EVENT_RING *pRing, EVENT *pEvent)
+  {
+    unsigned nTail = atomic_load_explicit(&pRing->nTail, memory_order_relaxed);
+    unsigned nHead = atomic_load_explicit(&pRing->nHead, memory_order_acquire);
+
+    if (nHead == nTail)
+    {
+      return false;
+    }
+    *pEvent = pRing->aEvents[nTail & (EVENT_RING_SIZE - 1)];
+    // Hand the slot back only after the event has been copied out
+    atomic_store_explicit(&pRing->nTail, nTail + 1, memory_order_release);
+    return true;
+  }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EVENTS_H */
@@ -0,0 +1,136 @@
+# Turn a display layout description into the header the renderer reads.
+#   cmake -DLAYOUT_FILE=<file.layout> -DOUTPUT_FILE=<layout_map.h> -P gen_layout.cmake
+# See display.layout for the format.
+
+set(SEGMENT_NAMES A B C D E F G DP)
+set(LAYOUT_SKIP 255)
+
+file(STRINGS "${LAYOUT_FILE}" LAYOUT_LINES)
+get_filename_component(LAYOUT_NAME "${LAYOUT_FILE}" NAME)
+
+set(DIGITS 0)
+set(TOTAL_LEDS 0)
+set(MAX_DIGIT_LEDS 0)
+set(DIGIT_LEDS "")
+set(DIGIT_FIRST "")
+set(SEGMENT_OF "")
+set(POSITION_OF "")
+set(SEGMENT_FIRST "")
+set(LINE_NUMBER 0)
+set(PREVIOUS_RUNS "")
+
+foreach(LINE IN LISTS LAYOUT_LINES)
+    math(EXPR LINE_NUMBER "${LINE_NUMBER} + 1")
+    string(REGEX REPLACE "#.*$" "" LINE "${LINE}")
+    string(STRIP "${LINE}" LINE)
+    if(LINE STREQUAL "")
+        continue()
+    endif()
+    string(REGEX REPLACE "[ \t]+" ";" WORDS "${LINE}")
+    list(GET WORDS 0 KEYWORD)
+    if(NOT KEYWORD STREQUAL "digit")
+        message(FATAL_ERROR "${LAYOUT_NAME}:${LINE_NUMBER}: expected \"digit\", found \"${KEYWORD}\"")
+    endif()
+    list(REMOVE_AT WORDS 0)
+    if(WORDS STREQUAL "same")
+        if(PREVIOUS_RUNS STREQUAL "")
+            message(FATAL_ERROR "${LAYOUT_NAME}:${LINE_NUMBER}: \"same\" needs a digit before it")
+        endif()
+        set(WORDS ${PREVIOUS_RUNS})
+    endif()
+    set(PREVIOUS_RUNS ${WORDS})
+
+    # First LED of each segment within the digit, -1 when it has none
+    set(FIRSTS -1 -1 -1 -1 -1 -1 -1 -1)
+    set(LED 0)
+    foreach(RUN IN LISTS WORDS)
+        if(NOT RUN MATCHES "^([A-Za-z]+):([0-9]+)(r?)$")
+            message(FATAL_ERROR "${LAYOUT_NAME}:${LINE_NUMBER}: bad run \"${RUN}\"")
+        endif()
+        string(TOUPPER "${CMAKE_MATCH_1}" NAME)
+        set(COUNT ${CMAKE_MATCH_2})
+        set(REVERSED ${CMAKE_MATCH_3})
+        if(COUNT EQUAL 0)
+            message(FATAL_ERROR "${LAYOUT_NAME}:${LINE_NUMBER}: run \"${RUN}\" has no LEDs")
+        endif()
+        if(NAME STREQUAL "SKIP")
+            if(REVERSED)
+                message(FATAL_ERROR "${LAYOUT_NAME}:${LINE_NUMBER}: skipped LEDs have no direction")
+            endif()
+            set(SEGMENT ${LAYOUT_SKIP})
+        else()
+            list(FIND SEGMENT_NAMES "${NAME}" SEGMENT)
+            if(SEGMENT LESS 0)
+                message(FATAL_ERROR "${LAYOUT_NAME}:${LINE_NUMBER}: unknown segment \"${NAME}\"")
+            endif()
+            list(GET FIRSTS ${SEGMENT} FIRST)
+            if(NOT FIRST EQUAL -1)
+                message(FATAL_ERROR "${LAYOUT_NAME}:${LINE_NUMBER}: segment ${NAME} appears twice")
+            endif()
+            list(REMOVE_AT FIRSTS ${SEGMENT})
+            list(INSERT FIRSTS ${SEGMENT} ${LED})
+        endif()
+        math(EXPR LAST "${COUNT} - 1")
+        foreach(INDEX RANGE 0 ${LAST})
+            if(REVERSED)
+                math(EXPR POSITION "${LAST} - ${INDEX}")
+            elseif(SEGMENT EQUAL LAYOUT_SKIP)
+                set(POSITION 0)
+            else()
+                set(POSITION ${INDEX})
+            endif()
+            list(APPEND SEGMENT_OF ${SEGMENT})
+            list(APPEND POSITION_OF ${POSITION})
+        endforeach()
+        math(EXPR LED "${LED} + ${COUNT}")
+    endforeach()
+    if(LED GREATER 255)
+        message(FATAL_ERROR "${LAYOUT_NAME}:${LINE_NUMBER}: a digit can have at most 255 LEDs")
+    endif()
+
+    list(APPEND DIGIT_FIRST ${TOTAL_LEDS})
+    list(APPEND DIGIT_LEDS ${LED})
+    string(REPLACE ";" ", " FIRSTS "${FIRSTS}")
+    list(APPEND SEGMENT_FIRST "{${FIRSTS}}")
+    math(EXPR TOTAL_LEDS "${TOTAL_LEDS} + ${LED}")
+    if(LED GREATER MAX_DIGIT_LEDS)
+        set(MAX_DIGIT_LEDS ${LED})
+    endif()
+    math(EXPR DIGITS "${DIGITS} + 1")
+endforeach()
+
+if(DIGITS EQUAL 0)
+    message(FATAL_ERROR "${LAYOUT_NAME}: no digits")
+endif()
+
+string(REPLACE ";" ", " DIGIT_LEDS "${DIGIT_LEDS}")
+string(REPLACE ";" ", " DIGIT_FIRST "${DIGIT_FIRST}")
+string(REPLACE ";" ", " SEGMENT_OF "${SEGMENT_OF}")
+string(REPLACE ";" ", " POSITION_OF "${POSITION_OF}")
+string(REPLACE ";" ", " SEGMENT_FIRST "${SEGMENT_FIRST}")
+
+file(WRITE "${OUTPUT_FILE}" "/* Generated from ${LAYOUT_NAME} by gen_layout.cmake, do not edit */
+#ifndef _LAYOUT_MAP_H
+#define _LAYOUT_MAP_H
+
+// Digits on the display, LEDs of all of them and of the largest
+#define LAYOUT_DIGITS ${DIGITS}
+#define LAYOUT_TOTAL_LEDS ${TOTAL_LEDS}
+#define LAYOUT_MAX_DIGIT_LEDS ${MAX_DIGIT_LEDS}
+// Segment of an LED that belongs to none
+#define LAYOUT_SKIP ${LAYOUT_SKIP}
+
+// LEDs of each digit
+#define LAYOUT_DIGIT_LEDS_INIT {${DIGIT_LEDS}}
+// First LED of each digit, counting over all the digits
+#define LAYOUT_DIGIT_FIRST_INIT {${DIGIT_FIRST}}
+// Segment bit of each LED, or LAYOUT_SKIP
+#define LAYOUT_SEGMENT_INIT {${SEGMENT_OF}}
+// Place of each LED along its segment in the direction the segment is
+// drawn, for effects that run along the segments
+#define LAYOUT_POSITION_INIT {${POSITION_OF}}
+// First LED of each segment of each digit in wiring order, -1 when it has none
+#define LAYOUT_SEGMENT_FIRST_INIT {${SEGMENT_FIRST}}
+
+#endif /* _LAYOUT_MAP_H */
+")
@@ -0,0 +1,303 @@
+/**
+ * @file hal.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Hardware abstraction layer between the timer logic and the board
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _HAL_H
+#define _HAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "events.h"
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+// Most LED strips, one per RMT transmit channel
+#define HAL_LED_MAX_STRIPS 4
+// Deadline meaning there is nothing scheduled
+#define HAL_NO_DEADLINE INT64_MAX
+// Edges closer than this to the last accepted edge are contact bounce
+#define HAL_BUTTON_DEBOUNCE_US 20000
+// Bytes of memory kept through a warm reset
+#define HAL_RETAINED_SIZE 64
+// Largest packet a sync transport carries
+#define HAL_SYNC_PACKET_MAX 64
+// Most tasks in a memory report
+#define HAL_MEMORY_TASKS 10
+
+  /**
+   * @brief Work run by a HAL task whenever it is woken or its deadline passes
+   *
+   * @param tNow Current time in microseconds
+   * @return int64_t When to run again if nothing else wakes it, HAL_NO_DEADLINE for never
+   */
+  typedef int64_t (*HAL_SERVICE)(int64_t tNow);
+
+  /**
+   * @brief Debounce state for one button input
+   *
+   */
+  typedef struct
+  {
+    int64_t tLastEdge; // Time of the last accepted edge
+    bool bPressed;     // Level of the last accepted edge
+  } HAL_DEBOUNCE;
+
+  /**
+   * @brief Decide if a raw edge is a real change of the button.
+   * The first edge of a change is taken immediately and the bounce after it
+   * is ignored, so a press is seen with no added latency.  Runs in the ISR.
+   *
+   * @param pDebounce Debounce state of the input
+   * @param tEdge Time of the raw edge
+   * @param bPressed Level after the raw edge
+   * @return true Edge accepted
+   * @return false Bounce or no change of level
+   */
+  static inline bool HAL_Debounce_Edge(HAL_DEBOUNCE *pDebounce, int64_t tEdge, bool bPressed)
+  {
+    if (bPressed == pDebounce->bPressed ||
+        tEdge - pDebounce->tLastEdge < HAL_BUTTON_DEBOUNCE_US)
+    {
+      return false;
+    }
+    pDebounce->tLastEdge = tEdge;
+    pDebounce->bPressed = bPressed;
+    return true;
+  }
+
+  /**
+   * @brief Reasons to keep the clock at full speed.  With none held the
+   * clock scales down and the chip light sleeps until the next deadline.
+   *
+   */
+  typedef enum
+  {
+    HAL_POWER_LOCK_LED,   // LED frames being clocked out
+    HAL_POWER_LOCK_AUDIO, // DFPlayer command written and not yet answered
+    HAL_POWER_LOCK_LINK,  // Sync link up, packets can arrive at any time
+    HAL_POWER_LOCKS,
+  } HAL_POWER_LOCK;
+
+  /**
+   * @brief Time spent under each power lock since boot
+   *
+   */
+  typedef struct
+  {
+    int64_t tUnlocked;                 // Time with no lock held, free to scale down and sleep
+    int64_t atHeld[HAL_POWER_LOCKS];   // Time each lock was held
+    uint32_t anTaken[HAL_POWER_LOCKS]; // Times each lock was taken
+    int64_t atTaken[HAL_POWER_LOCKS];  // When each lock still held was taken
+    int64_t tFreed;                    // When the last lock held was given back
+    uint32_t nHeld;                    // Bit for each lock held
+  } HAL_POWER_STATS;
+
+  /**
+   * @brief Count a power lock being taken or given back
+   *
+   * @param pStats Time under each lock
+   * @param eLock Lock
+   * @param bTake Taken rather than given back
+   * @param tNow Current time
+   * @return true The lock changed hands, so take or give the real one
+   * @return false It was already held, or already free
+   */
+  static inline bool HAL_Power_Account(HAL_POWER_STATS *pStats, HAL_POWER_LOCK eLock, bool bTake, int64_t tNow)
+  {
+    uint32_t nBit = 1u << eLock;
+
+    if (bTake == ((pStats->nHeld & nBit) != 0))
+    {
+      return false;
+    }
+    if (bTake)
+    {
+      if (pStats->nHeld == 0)
+      {
+        pStats->tUnlocked += tNow - pStats->tFreed;
+      }
+      pStats->nHeld |= nBit;
+      pStats->atTaken[eLock] = tNow;
+      pStats->anTaken[eLock]++;
+    }
+    else
+    {
+      pStats->nHeld &= ~nBit;
+      pStats->atHeld[eLock] += tNow - pStats->atTaken[eLock];
+      if (pStats->nHeld == 0)
+      {
+        pStats->tFreed = tNow;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Bring the times up to now, counting the locks still held
+   *
+   * @param pStats Time under each lock, a copy to change
+   * @param tNow Current time
+   */
+  static inline void HAL_Power_Settle(HAL_POWER_STATS *pStats, int64_t tNow)
+  {
+    if (pStats->nHeld == 0)
+    {
+      pStats->tUnlocked += tNow - pStats->tFreed;
+      pStats->tFreed = tNow;
+    }
+    for (int nLock = 0; nLock < HAL_POWER_LOCKS; nLock++)
+    {
+      if (pStats->nHeld & (1u << nLock))
+      {
+        pStats->atHeld[nLock] += tNow - pStats->atTaken[nLock];
+        pStats->atTaken[nLock] = tNow;
+      }
+    }
+  }
+
+  /**
+   * @brief How much of its stack a task has used
+   *
+   */
+  typedef struct
+  {
+    const char *pszName; // Name of the task
+    uint32_t nStack;     // Bytes of stack it was created with
+    uint32_t nUnused;    // Fewest bytes of stack it has had free
+  } HAL_TASK_STACK;
+
+  /**
+   * @brief RAM used by the firmware
+   *
+   */
+  typedef struct
+  {
+    uint32_t nStatic;                        // Bytes of .data and .bss
+    uint32_t nHeapSize;                      // Bytes in the heap
+    uint32_t nHeapFree;                      // Bytes of heap free now
+    uint32_t nHeapMinFree;                   // Fewest bytes of heap ever free
+    int nTasks;                              // Tasks in aTasks
+    HAL_TASK_STACK aTasks[HAL_MEMORY_TASKS]; // Stack of each task started
+  } HAL_MEMORY_STATS;
+
+  /**
+   * @brief Links that can carry the clock sync between timers
+   *
+   */
+  typedef enum
+  {
+    HAL_LINK_NONE,      // Not synchronized
+    HAL_LINK_ESPNOW,    // ESP-NOW broadcast on the WiFi radio
+    HAL_LINK_UART,      // The spare UART, wired between the timers
+    HAL_LINK_SIMULATED, // In-process link to a simulated timer, for the host build
+  } HAL_LINK;
+
+  /**
+   * @brief A link to the other timers in the room.  Packets are broadcast
+   * to every other timer, and timestamped with HAL_Get_Time as they arrive
+   * so the time spent queued does not count against the sync.
+   *
+   */
+  typedef struct
+  {
+    const char *pszName;                                                 // Shown in the log
+    bool (*pfnOpen)(void);                                               // Bring the link up
+    bool (*pfnSend)(const void *pData, size_t nLength);                  // Broadcast a packet
+    size_t (*pfnReceive)(void *pData, size_t nMaxLength, int64_t *ptAt); // Take the next packet, 0 when none waits
+  } HAL_TRANSPORT;
+
+  // LED strip, double buffered: a blit queues the frame and returns at once
+  extern void HAL_LED_Initialize(int nStrips, const int *anGpios, const int *anLeds);
+  extern void HAL_LED_Blit(const uint32_t *aFrame, const int *anLeds);
+
+  // Render task, runs the compositor service on its own timer
+  extern void HAL_Render_Initialize(HAL_SERVICE pfnService);
+  extern void HAL_Render_Wake_Service(void);
+
+  // Push button (and touch pad), edges are timestamped in the interrupt
+  extern void HAL_Button_Initialize(void);
+  extern bool HAL_Button_Is_Pressed(void);
+
+  // Log console, each key typed reaches the app as an EVENT_CONSOLE_KEY
+  extern void HAL_Console_Initialize(void);
+  extern void HAL_Console_Write(const char *pszLine);
+
+  // Deferred log drain, a task below all the others runs the service when woken
+  extern void HAL_Log_Initialize(HAL_SERVICE pfnService);
+  extern void HAL_Log_Wake_Service(void);
+
+  // UART to the DFPlayer, owned by a task running the service
+  extern void HAL_UART_Initialize(HAL_SERVICE pfnService);
+  extern void HAL_UART_Write(const uint8_t *pData, size_t nLength);
+  extern size_t HAL_UART_Read(uint8_t *pData, size_t nMaxLength);
+  extern void HAL_UART_Wake_Service(void);
+
+  // Settings kept in flash, read back after a reset
+  extern bool HAL_Settings_Initialize(void);
+  extern bool HAL_Settings_Load(const char *pszKey, void *pData, size_t nLength);
+  extern bool HAL_Settings_Save(const char *pszKey, const void *pData, size_t nLength);
+
+  // Clock sync between timers, a task runs the service whenever a packet arrives
+  extern const HAL_TRANSPORT *HAL_Sync_Transport(HAL_LINK eLink);
+  extern void HAL_Sync_Initialize(HAL_SERVICE pfnService);
+  extern void HAL_Sync_Wake_Service(void);
+
+  // Memory kept through a warm reset, lost when the power goes
+  extern bool HAL_Retained_Load(void *pData, size_t nLength);
+  extern void HAL_Retained_Save(const void *pData, size_t nLength);
+
+  // Power management, the clock scales down and the chip light sleeps while no lock is held
+  extern void HAL_Power_Initialize(void);
+  extern void HAL_Power_Get_Stats(HAL_POWER_STATS *pStats);
+  extern void HAL_Power_Log_Modes(void);
+
+  // RAM footprint, the static sections, the heap and the stack high-water of each task
+  extern void HAL_Memory_Get_Stats(HAL_MEMORY_STATS *pStats);
+
+  // Time base and scheduling
+  extern int64_t HAL_Get_Time(void);
+  extern int64_t HAL_Get_Epoch(void);
+  extern void HAL_Delay_ms(uint32_t nMilliseconds);
+  extern bool HAL_Initialize_Wake(void);
+  extern bool HAL_Wait_Until(int64_t tDeadline);
+  extern void HAL_Wake_App(void);
+  extern bool HAL_Get_Event(EVENT *pEvent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HAL_H */
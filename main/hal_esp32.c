@@ -0,0 +1,1668 @@
+/**
+ * @file hal_esp32.c
+ * @author John Toebes (john@toebes.com)
+ * @brief ESP-IDF implementation of the hardware abstraction layer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <driver/rmt_tx.h>
+#include <driver/rmt_encoder.h>
+#include <soc/soc_caps.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include <freertos/queue.h>
+#include <nvs_flash.h>
+#include <nvs.h>
+#include <sys/time.h>
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <esp_wifi.h>
+#include <esp_event.h>
+#include <esp_now.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <hal/gpio_ll.h>
+#include <esp_heap_caps.h>
+#include <esp_vfs_dev.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "app.h"
+#if TOUCH_BUTTON_ENABLE
+#include <touch_element/touch_button.h>
+#endif
+
+// 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
+#define LED_STRIP_RMT_RES_HZ (10 * 1000 * 1000)
+// WS2812 bit timings in RMT ticks and the low time that latches a frame
+#define WS2812_T0H_TICKS 3
+#define WS2812_T0L_TICKS 9
+#define WS2812_T1H_TICKS 9
+#define WS2812_T1L_TICKS 3
+#define WS2812_RESET_US 280
+#define WS2812_RESET_TICKS (WS2812_RESET_US * (LED_STRIP_RMT_RES_HZ / 1000000))
+#if SOC_RMT_SUPPORT_DMA
+// With DMA the RMT memory is only a staging area, so make it large
+#define LED_RMT_MEM_SYMBOLS 1024
+#define LED_RMT_WITH_DMA true
+#else
+#define LED_RMT_MEM_SYMBOLS 64
+#define LED_RMT_WITH_DMA false
+#endif
+
+static const char *TAG = "hal";
+
+// The touch pad cannot wake the chip from light sleep, so it keeps power save off
+#define HAL_POWER_SAVE (POWER_SAVE_ENABLE && !TOUCH_BUTTON_ENABLE)
+// With no power lock held the CPU drops to the crystal
+#define POWER_MIN_FREQ_MHZ CONFIG_XTAL_FREQ
+#if HAL_POWER_SAVE
+// The 1MHz reference tick keeps its rate when the APB clock scales down
+#define UART_CLOCK UART_SCLK_REF_TICK
+#else
+#define UART_CLOCK UART_SCLK_DEFAULT
+#endif
+
+// The audio task owns the DFPlayer UART
+#define UART_RX_BUFFER_SIZE 256
+#define UART_EVENT_QUEUE_LENGTH 8
+#define AUDIO_TASK_STACK 3072
+#define AUDIO_TASK_PRIORITY 2
+// Event posted to the UART queue to wake the audio task
+#define UART_EVENT_WAKE UART_EVENT_MAX
+// NVS namespace of the settings
+#define SETTINGS_NAMESPACE "cbtimer"
+// The render task composes display frames, above the audio so fades stay smooth
+#define RENDER_TASK_STACK 3072
+#define RENDER_TASK_PRIORITY 3
+// The sync task answers the other timers, above the render task so replies are prompt
+#define SYNC_TASK_STACK 3072
+#define SYNC_TASK_PRIORITY 4
+#define SYNC_QUEUE_LENGTH 8 // Packets received and not yet taken by the sync service
+#define SYNC_ESPNOW_CHANNEL 1
+#define SYNC_UART_BAUD 115200
+#define SYNC_UART_START 0xA5 // First byte of a packet on the sync UART
+#define SYNC_UART_TASK_STACK 2048
+// The console task reads keys typed on the log console
+#define CONSOLE_TASK_STACK 2048
+#define CONSOLE_TASK_PRIORITY 1
+// The log task drains the deferred log to the console when nothing else runs
+#define LOG_TASK_STACK 2048
+#define LOG_TASK_PRIORITY 1
+
+/**
+ * @brief RMT encoder for a WS2812 frame: the GRB bytes followed by the low
+ * reset time that latches it, so frames can be queued back to back
+ *
+ */
+typedef struct
+{
+    rmt_encoder_t base;          // Encoder interface, must be first
+    rmt_encoder_handle_t hBytes; // Encodes the GRB bytes as WS2812 bits
+    rmt_encoder_handle_t hCopy;  // Copies the reset symbol
+    int nState;                  // 0 while sending bytes, 1 while sending the reset
+    rmt_symbol_word_t symReset;  // Low for WS2812_RESET_US
+} WS2812_ENCODER;
+
+/**
+ * @brief One LED strip on its own GPIO and RMT channel
+ *
+ */
+typedef struct
+{
+    rmt_channel_handle_t hChannel; // RMT channel driving the strip
+    WS2812_ENCODER encoder;        // Encodes a whole WS2812 frame
+    int nLeds;                     // Number of LEDs in the strip
+    int nOffset;                   // First byte of the strip in the frame buffers
+    uint32_t anFrameSeq[2];        // Transmission number last queued from each buffer
+    uint32_t nQueued;              // Transmissions queued
+    volatile uint32_t nDone;       // Transmissions finished, counted in the done callback
+} HAL_STRIP;
+
+typedef struct
+{
+    HAL_STRIP aStrips[HAL_LED_MAX_STRIPS];        // The strips, sent in parallel
+    int nStrips;                                  // Number of strips
+    uint8_t aFrames[2][LED_STRIP_TOTAL_LEDS * 3]; // GRB bytes of every strip, one buffer filled while the other is sent
+    int nBack;                                    // Buffer HAL_LED_Blit writes into
+    SemaphoreHandle_t hLEDDone;                   // Given when any transmission finishes
+    TaskHandle_t hAppTask;                        // Task woken by notification for the app
+    esp_timer_handle_t hDeadlineTimer;            // One-shot timer for the next app deadline
+    EVENT_RING ringButton;                        // Debounced button edges, pushed by the interrupt
+    EVENT_RING ringConsole;                       // Keys typed on the console, pushed by the console task
+    HAL_DEBOUNCE debounce;                        // Debounce state of the combined button
+    bool bGPIOPressed;                            // Level of the push button
+    bool bTouchPressed;                           // Level of the touch pad
+    portMUX_TYPE muxButton;                       // Guards the button state between sources
+    QueueHandle_t hUARTEvents;                    // UART driver events, also used to wake the audio task
+    HAL_SERVICE pfnUARTService;                   // Run by the audio task
+    TaskHandle_t hRenderTask;                     // Task running the render service
+    esp_timer_handle_t hRenderTimer;              // One-shot timer for the next frame
+    HAL_SERVICE pfnRenderService;                 // Run by the render task
+    nvs_handle_t hSettings;                       // Open settings namespace, 0 when NVS is not usable
+    QueueHandle_t hSyncPackets;                   // HAL_SYNC_RX packets for the sync service
+    QueueHandle_t hSyncUARTEvents;                // Sync UART driver events
+    TaskHandle_t hSyncTask;                       // Task running the sync service
+    esp_timer_handle_t hSyncTimer;                // One-shot timer for the next sync deadline
+    HAL_SERVICE pfnSyncService;                   // Run by the sync task
+    TaskHandle_t hLogTask;                        // Task draining the deferred log
+    TaskHandle_t hAudioTask;                      // Task running the audio service
+    TaskHandle_t hConsoleTask;                    // Task reading the console
+    QueueHandle_t hConsoleEvents;                 // Console UART driver events, the console task waits on them
+    TaskHandle_t hSyncUARTTask;                   // Task reading the sync UART
+    HAL_SERVICE pfnLogService;                    // Run by the log task
+    bool bLEDEnabled;                             // RMT channels enabled, the driver holds its APB lock
+    esp_pm_lock_handle_t ahPM[HAL_POWER_LOCKS];   // PM lock behind each power lock, NULL without power management
+    HAL_POWER_STATS power;                        // Time under each power lock
+    portMUX_TYPE muxPower;                        // Guards the power stats between the tasks taking locks
+} HAL_DATA;
+
+/**
+ * @brief A packet from another timer, stamped when it arrived
+ *
+ */
+typedef struct
+{
+    int64_t tAt;                        // Time it arrived
+    size_t nLength;                     // Bytes in aData
+    uint8_t aData[HAL_SYNC_PACKET_MAX]; // The packet
+} HAL_SYNC_RX;
+
+static HAL_DATA halData = {.muxButton = portMUX_INITIALIZER_UNLOCKED, .muxPower = portMUX_INITIALIZER_UNLOCKED};
+
+#if STATIC_ALLOCATION_ENABLE
+/**
+ * @brief Stacks, control blocks and queue storage of everything the HAL
+ * creates, placed by the linker so they count against the static budget
+ *
+ */
+typedef struct
+{
+    StackType_t aAudioStack[AUDIO_TASK_STACK];                     // Stack of the audio task
+    StackType_t aRenderStack[RENDER_TASK_STACK];                   // Stack of the render task
+    StackType_t aSyncStack[SYNC_TASK_STACK];                       // Stack of the sync task
+    StackType_t aSyncUARTStack[SYNC_UART_TASK_STACK];              // Stack of the sync UART task
+    StackType_t aConsoleStack[CONSOLE_TASK_STACK];                 // Stack of the console task
+    StackType_t aLogStack[LOG_TASK_STACK];                         // Stack of the log task
+    StaticTask_t tcbAudio;                                         // Control block of the audio task
+    StaticTask_t tcbRender;                                        // Control block of the render task
+    StaticTask_t tcbSync;                                          // Control block of the sync task
+    StaticTask_t tcbSyncUART;                                      // Control block of the sync UART task
+    StaticTask_t tcbConsole;                                       // Control block of the console task
+    StaticTask_t tcbLog;                                           // Control block of the log task
+    StaticSemaphore_t semLEDDone;                                  // Storage of hLEDDone
+    StaticQueue_t queueSyncPackets;                                // Control block of hSyncPackets
+    uint8_t aSyncPackets[SYNC_QUEUE_LENGTH * sizeof(HAL_SYNC_RX)]; // Storage of hSyncPackets
+} HAL_STATIC;
+
+static HAL_STATIC halStatic;
+
+// Create a task on its stack and control block in halStatic
+#define HAL_TASK_CREATE(pfnTask, pszName, nStack, nPriority, phTask, Name)                              \
+    (*(phTask) = xTaskCreateStatic(pfnTask, pszName, nStack, NULL, nPriority, halStatic.a##Name##Stack, \
+                                   &halStatic.tcb##Name))
+#else
+#define HAL_TASK_CREATE(pfnTask, pszName, nStack, nPriority, phTask, Name) \
+    xTaskCreate(pfnTask, pszName, nStack, NULL, nPriority, phTask)
+#endif
+
+// Ends of the .data and .bss sections in DRAM, from the IDF linker script
+extern uint8_t _data_start;
+extern uint8_t _bss_end;
+
+// Marks RTC memory written by HAL_Retained_Save rather than left from power on
+#define RETAINED_MAGIC 0x43425452
+
+/**
+ * @brief Block in RTC memory that is not cleared by a warm reset
+ *
+ */
+typedef struct
+{
+    uint32_t nMagic;                  // RETAINED_MAGIC once written
+    uint32_t nLength;                 // Bytes of aData in use
+    uint32_t nCRC;                    // CRC32 of those bytes
+    uint8_t aData[HAL_RETAINED_SIZE]; // Caller's data
+} HAL_RETAINED;
+
+static RTC_NOINIT_ATTR HAL_RETAINED halRetained;
+
+/**
+ * @brief Take or give back a power lock, counting the time under it.  Each
+ * lock is only ever taken and given back by one task.
+ *
+ * @param eLock Lock
+ * @param bTake Take it rather than give it back
+ */
+static void HAL_Power_Lock(HAL_POWER_LOCK eLock, bool bTake)
+{
+    bool bChanged;
+
+    portENTER_CRITICAL(&halData.muxPower);
+    bChanged = HAL_Power_Account(&halData.power, eLock, bTake, esp_timer_get_time());
+    portEXIT_CRITICAL(&halData.muxPower);
+    if (!bChanged || halData.ahPM[eLock] == NULL)
+    {
+        return;
+    }
+    if (bTake)
+    {
+        esp_pm_lock_acquire(halData.ahPM[eLock]);
+    }
+    else
+    {
+        esp_pm_lock_release(halData.ahPM[eLock]);
+    }
+}
+/**
+ * @brief Let the clock scale down and the chip light sleep whenever no
+ * power lock is held.  The LED and audio locks keep the CPU at full speed,
+ * the link lock only keeps the chip awake for the radio or the sync UART.
+ * esp_timer keeps time through light sleep and its deadlines wake the chip,
+ * so the countdown does not drift.  A key typed on the console also wakes
+ * it, but is lost doing so.
+ *
+ */
+void HAL_Power_Initialize(void)
+{
+#if HAL_POWER_SAVE && CONFIG_PM_ENABLE
+    static const char *apszLocks[HAL_POWER_LOCKS] = {"led", "audio", "link"};
+    static const esp_pm_lock_type_t aeTypes[HAL_POWER_LOCKS] = {ESP_PM_CPU_FREQ_MAX, ESP_PM_CPU_FREQ_MAX,
+                                                                 ESP_PM_NO_LIGHT_SLEEP};
+    esp_pm_config_t config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = POWER_MIN_FREQ_MHZ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t err = esp_pm_configure(&config);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Power management off: %s", esp_err_to_name(err));
+        return;
+    }
+    for (int nLock = 0; nLock < HAL_POWER_LOCKS; nLock++)
+    {
+        ESP_ERROR_CHECK(esp_pm_lock_create(aeTypes[nLock], 0, apszLocks[nLock], &halData.ahPM[nLock]));
+    }
+#if CONFIG_ESP_CONSOLE_UART
+    uart_set_wakeup_threshold(CONFIG_ESP_CONSOLE_UART_NUM, 3);
+    esp_sleep_enable_uart_wakeup(CONFIG_ESP_CONSOLE_UART_NUM);
+#endif
+    ESP_LOGI(TAG, "Clock %d to %d MHz, light sleep between deadlines", POWER_MIN_FREQ_MHZ,
+             CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#else
+    ESP_LOGI(TAG, "Power management off, clock fixed at %d MHz", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#endif
+}
+/**
+ * @brief Get the time spent under each power lock up to now
+ *
+ * @param pStats Where to put the times
+ */
+void HAL_Power_Get_Stats(HAL_POWER_STATS *pStats)
+{
+    portENTER_CRITICAL(&halData.muxPower);
+    *pStats = halData.power;
+    portEXIT_CRITICAL(&halData.muxPower);
+    HAL_Power_Settle(pStats, esp_timer_get_time());
+}
+/**
+ * @brief Print the time power management measured in each mode (light
+ * sleep, the lowest clock, full APB and full CPU) and the locks that held it
+ *
+ */
+void HAL_Power_Log_Modes(void)
+{
+#if CONFIG_PM_PROFILING
+    esp_pm_dump_locks(stdout);
+#else
+    ESP_LOGI(TAG, "Set CONFIG_PM_PROFILING to measure the time in each power mode");
+#endif
+}
+/**
+ * @brief Add a task to the memory report, if it has been started
+ *
+ * @param pStats Report
+ * @param hTask Task, NULL when never started
+ * @param nStack Bytes of stack the task was created with
+ */
+static void HAL_Memory_Add_Task(HAL_MEMORY_STATS *pStats, TaskHandle_t hTask, uint32_t nStack)
+{
+    HAL_TASK_STACK *pTask;
+
+    if (hTask == NULL || pStats->nTasks >= HAL_MEMORY_TASKS)
+    {
+        return;
+    }
+    pTask = &pStats->aTasks[pStats->nTasks++];
+    pTask->pszName = pcTaskGetName(hTask);
+    pTask->nStack = nStack;
+    // The IDF counts stacks in bytes, not words
+    pTask->nUnused = uxTaskGetStackHighWaterMark(hTask);
+}
+/**
+ * @brief Get the RAM the firmware uses: the static sections, the heap and
+ * how deep each task has gone into its stack
+ *
+ * @param pStats Where to put the report
+ */
+void HAL_Memory_Get_Stats(HAL_MEMORY_STATS *pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+    pStats->nStatic = &_bss_end - &_data_start;
+    pStats->nHeapSize = heap_caps_get_total_size(MALLOC_CAP_DEFAULT);
+    pStats->nHeapFree = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    pStats->nHeapMinFree = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    HAL_Memory_Add_Task(pStats, halData.hAppTask, CONFIG_ESP_MAIN_TASK_STACK_SIZE);
+    HAL_Memory_Add_Task(pStats, xTaskGetHandle("esp_timer"), CONFIG_ESP_TIMER_TASK_STACK_SIZE);
+    HAL_Memory_Add_Task(pStats, xTaskGetHandle(CONFIG_FREERTOS_TIMER_SERVICE_TASK_NAME),
+                        CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH);
+    HAL_Memory_Add_Task(pStats, halData.hAudioTask, AUDIO_TASK_STACK);
+    HAL_Memory_Add_Task(pStats, halData.hRenderTask, RENDER_TASK_STACK);
+    HAL_Memory_Add_Task(pStats, halData.hSyncTask, SYNC_TASK_STACK);
+    HAL_Memory_Add_Task(pStats, halData.hSyncUARTTask, SYNC_UART_TASK_STACK);
+    HAL_Memory_Add_Task(pStats, halData.hConsoleTask, CONSOLE_TASK_STACK);
+    HAL_Memory_Add_Task(pStats, halData.hLogTask, LOG_TASK_STACK);
+}
+
+/**
+ * @brief Encode a frame for the RMT: the bytes, then the reset symbol
+ *
+ * @param pEncoder WS2812_ENCODER to run
+ * @param hChannel Channel being encoded for
+ * @param pData GRB bytes
+ * @param nSize Number of bytes
+ * @param pState Returns whether the frame is complete or the RMT memory is full
+ * @return size_t Number of symbols encoded
+ */
+static size_t WS2812_Encode(rmt_encoder_t *pEncoder, rmt_channel_handle_t hChannel,
+                            const void *pData, size_t nSize, rmt_encode_state_t *pState)
+{
+    WS2812_ENCODER *pWS2812 = __containerof(pEncoder, WS2812_ENCODER, base);
+    rmt_encode_state_t sessionState = RMT_ENCODING_RESET;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t nEncoded = 0;
+
+    if (pWS2812->nState == 0)
+    {
+        nEncoded += pWS2812->hBytes->encode(pWS2812->hBytes, hChannel, pData, nSize, &sessionState);
+        if (sessionState & RMT_ENCODING_COMPLETE)
+        {
+            pWS2812->nState = 1;
+        }
+        if (sessionState & RMT_ENCODING_MEM_FULL)
+        {
+            *pState = RMT_ENCODING_MEM_FULL;
+            return nEncoded;
+        }
+    }
+    nEncoded += pWS2812->hCopy->encode(pWS2812->hCopy, hChannel, &pWS2812->symReset, sizeof(pWS2812->symReset), &sessionState);
+    if (sessionState & RMT_ENCODING_COMPLETE)
+    {
+        pWS2812->nState = 0;
+        state |= RMT_ENCODING_COMPLETE;
+    }
+    if (sessionState & RMT_ENCODING_MEM_FULL)
+    {
+        state |= RMT_ENCODING_MEM_FULL;
+    }
+    *pState = state;
+    return nEncoded;
+}
+/**
+ * @brief Start the next frame from the beginning
+ *
+ * @param pEncoder WS2812_ENCODER to reset
+ * @return esp_err_t ESP_OK
+ */
+static esp_err_t WS2812_Reset(rmt_encoder_t *pEncoder)
+{
+    WS2812_ENCODER *pWS2812 = __containerof(pEncoder, WS2812_ENCODER, base);
+
+    rmt_encoder_reset(pWS2812->hBytes);
+    rmt_encoder_reset(pWS2812->hCopy);
+    pWS2812->nState = 0;
+    return ESP_OK;
+}
+/**
+ * @brief Release the encoders the WS2812 encoder is built from
+ *
+ * @param pEncoder WS2812_ENCODER to delete
+ * @return esp_err_t ESP_OK
+ */
+static esp_err_t WS2812_Delete(rmt_encoder_t *pEncoder)
+{
+    WS2812_ENCODER *pWS2812 = __containerof(pEncoder, WS2812_ENCODER, base);
+
+    rmt_del_encoder(pWS2812->hBytes);
+    rmt_del_encoder(pWS2812->hCopy);
+    return ESP_OK;
+}
+/**
+ * @brief RMT callback when a frame has been sent.  Runs in the ISR.
+ *
+ * @param hChannel Channel that finished
+ * @param pEvent Details of the transmission
+ * @param pArg HAL_STRIP that was sent
+ * @return true A higher priority task was woken
+ * @return false Nothing was woken
+ */
+static bool IRAM_ATTR HAL_LED_Done(rmt_channel_handle_t hChannel, const rmt_tx_done_event_data_t *pEvent, void *pArg)
+{
+    BaseType_t bWoken = pdFALSE;
+    HAL_STRIP *pStrip = pArg;
+
+    pStrip->nDone++;
+    xSemaphoreGiveFromISR(halData.hLEDDone, &bWoken);
+    return bWoken == pdTRUE;
+}
+/**
+ * @brief Create the RMT channel and WS2812 encoder for the LED strip
+ *
+ * The strip is driven with its own encoder rather than the led_strip
+ * component so that a refresh can clock out just a prefix of the strip, and
+ * so that frames can be queued without waiting for the last one to latch.
+ *
+ * @param pStrip Strip to set up
+ * @param gpio GPIO connected to the data line of the strip
+ */
+static void configure_led(HAL_STRIP *pStrip, int gpio)
+{
+    rmt_tx_channel_config_t tx_config = {
+        .gpio_num = gpio,                         // The GPIO that connected to the LED strip's data line
+        .clk_src = RMT_CLK_SRC_DEFAULT,           // different clock source can lead to different power consumption
+        .resolution_hz = LED_STRIP_RMT_RES_HZ,    // RMT counter clock frequency
+        .mem_block_symbols = LED_RMT_MEM_SYMBOLS, // RMT memory for the channel
+        .trans_queue_depth = 4,                   // Pending transmissions
+        .flags.invert_out = false,                // whether to invert the output signal
+        .flags.with_dma = LED_RMT_WITH_DMA,       // DMA feature is available on ESP target like ESP32-S3
+    };
+    rmt_bytes_encoder_config_t encoder_config = {
+        .bit0 = {.level0 = 1, .duration0 = WS2812_T0H_TICKS, .level1 = 0, .duration1 = WS2812_T0L_TICKS},
+        .bit1 = {.level0 = 1, .duration0 = WS2812_T1H_TICKS, .level1 = 0, .duration1 = WS2812_T1L_TICKS},
+        .flags.msb_first = 1,
+    };
+    rmt_copy_encoder_config_t copy_config = {};
+    rmt_tx_event_callbacks_t callbacks = {
+        .on_trans_done = HAL_LED_Done,
+    };
+    WS2812_ENCODER *pWS2812 = &pStrip->encoder;
+
+    pWS2812->base.encode = WS2812_Encode;
+    pWS2812->base.reset = WS2812_Reset;
+    pWS2812->base.del = WS2812_Delete;
+    pWS2812->symReset = (rmt_symbol_word_t){
+        .level0 = 0,
+        .duration0 = WS2812_RESET_TICKS / 2,
+        .level1 = 0,
+        .duration1 = WS2812_RESET_TICKS / 2,
+    };
+
+    ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_config, &pStrip->hChannel));
+    ESP_ERROR_CHECK(rmt_new_bytes_encoder(&encoder_config, &pWS2812->hBytes));
+    ESP_ERROR_CHECK(rmt_new_copy_encoder(&copy_config, &pWS2812->hCopy));
+    ESP_ERROR_CHECK(rmt_tx_register_event_callbacks(pStrip->hChannel, &callbacks, pStrip));
+    ESP_LOGI(TAG, "Created LED strip object with RMT backend%s on GPIO %d", LED_RMT_WITH_DMA ? " and DMA" : "", gpio);
+}
+/**
+ * @brief Create the LED strips, each on its own GPIO and RMT channel
+ *
+ * @param nStrips Number of strips
+ * @param anGpios GPIO of each strip
+ * @param anLeds Number of LEDs in each strip
+ */
+void HAL_LED_Initialize(int nStrips, const int *anGpios, const int *anLeds)
+{
+    int nOffset = 0;
+
+    ESP_ERROR_CHECK(nStrips > HAL_LED_MAX_STRIPS ? ESP_ERR_INVALID_SIZE : ESP_OK);
+#if STATIC_ALLOCATION_ENABLE
+    halData.hLEDDone = xSemaphoreCreateBinaryStatic(&halStatic.semLEDDone);
+#else
+    halData.hLEDDone = xSemaphoreCreateBinary();
+#endif
+    halData.nStrips = nStrips;
+    for (int nStrip = 0; nStrip < nStrips; nStrip++)
+    {
+        HAL_STRIP *pStrip = &halData.aStrips[nStrip];
+
+        ESP_LOGI(TAG, "Initializing strip %d with %d LEDS", nStrip, anLeds[nStrip]);
+        pStrip->nLeds = anLeds[nStrip];
+        pStrip->nOffset = nOffset;
+        nOffset += anLeds[nStrip] * 3;
+        ESP_ERROR_CHECK(nOffset > sizeof(halData.aFrames[0]) ? ESP_ERR_INVALID_SIZE : ESP_OK);
+        configure_led(pStrip, anGpios[nStrip]);
+    }
+}
+/**
+ * @brief Wait until no strip is sending from a frame buffer
+ *
+ * @param nBuffer Which of the two buffers
+ */
+static void HAL_LED_Wait_Buffer(int nBuffer)
+{
+    for (int nStrip = 0; nStrip < halData.nStrips; nStrip++)
+    {
+        HAL_STRIP *pStrip = &halData.aStrips[nStrip];
+
+        while ((int32_t)(pStrip->nDone - pStrip->anFrameSeq[nBuffer]) < 0)
+        {
+            xSemaphoreTake(halData.hLEDDone, portMAX_DELAY);
+        }
+    }
+}
+/**
+ * @brief Enable the RMT channels and take the LED power lock, unless a
+ * frame is already on its way
+ *
+ */
+static void HAL_LED_Wake(void)
+{
+    if (halData.bLEDEnabled)
+    {
+        return;
+    }
+    HAL_Power_Lock(HAL_POWER_LOCK_LED, true);
+    for (int nStrip = 0; nStrip < halData.nStrips; nStrip++)
+    {
+        ESP_ERROR_CHECK(rmt_enable(halData.aStrips[nStrip].hChannel));
+    }
+    halData.bLEDEnabled = true;
+}
+/**
+ * @brief Once the last frame has latched, disable the RMT channels, which
+ * gives back the APB lock the driver holds while they are enabled, and give
+ * back the LED power lock.  The lines stay low, so the strips keep showing
+ * the frame.
+ *
+ */
+static void HAL_LED_Idle(void)
+{
+    if (!halData.bLEDEnabled)
+    {
+        return;
+    }
+    HAL_LED_Wait_Buffer(0);
+    HAL_LED_Wait_Buffer(1);
+    for (int nStrip = 0; nStrip < halData.nStrips; nStrip++)
+    {
+        ESP_ERROR_CHECK(rmt_disable(halData.aStrips[nStrip].hChannel));
+    }
+    halData.bLEDEnabled = false;
+    HAL_Power_Lock(HAL_POWER_LOCK_LED, false);
+}
+/**
+ * @brief Copy the first LEDs of each strip into the back buffer as GRB
+ * bytes, queue them to be sent and make the other buffer the back buffer.
+ * Every strip is queued before any is waited on, so the strips are sent in
+ * parallel and a frame takes as long as the longest one.  Returns without
+ * waiting for the transmissions; the done callbacks track when the buffer
+ * is free again.  LEDs past the last one clocked out keep showing their old
+ * values.
+ *
+ * @param aFrame Color (0x00RRGGBB) of every LED, the strips one after the other
+ * @param anLeds Number of LEDs to send from the start of each strip, 0 to leave it alone
+ */
+void HAL_LED_Blit(const uint32_t *aFrame, const int *anLeds)
+{
+    rmt_transmit_config_t tx_config = {
+        .loop_count = 0, // no transfer loop
+    };
+    int nFront = halData.nBack;
+    int nBack = nFront ^ 1;
+
+    for (int nStrip = 0; nStrip < halData.nStrips; nStrip++)
+    {
+        HAL_STRIP *pStrip = &halData.aStrips[nStrip];
+        int nLeds = anLeds[nStrip] < pStrip->nLeds ? anLeds[nStrip] : pStrip->nLeds;
+        const uint32_t *pColor = aFrame + pStrip->nOffset / 3;
+        uint8_t *pPixel = halData.aFrames[nFront] + pStrip->nOffset;
+
+        for (int nLed = 0; nLed < nLeds; nLed++, pPixel += 3)
+        {
+            pPixel[0] = (uint8_t)(pColor[nLed] >> 8);
+            pPixel[1] = (uint8_t)(pColor[nLed] >> 16);
+            pPixel[2] = (uint8_t)pColor[nLed];
+        }
+    }
+    // The new back buffer was sent two frames ago, this only waits when
+    // frames come faster than the strips can take them
+    HAL_LED_Wait_Buffer(nBack);
+    HAL_LED_Wake();
+    for (int nStrip = 0; nStrip < halData.nStrips; nStrip++)
+    {
+        HAL_STRIP *pStrip = &halData.aStrips[nStrip];
+        int nLeds = anLeds[nStrip] < pStrip->nLeds ? anLeds[nStrip] : pStrip->nLeds;
+
+        if (nLeds <= 0)
+        {
+            continue;
+        }
+        pStrip->anFrameSeq[nFront] = ++pStrip->nQueued;
+        ESP_ERROR_CHECK(rmt_transmit(pStrip->hChannel, &pStrip->encoder.base,
+                                     halData.aFrames[nFront] + pStrip->nOffset, nLeds * 3, &tx_config));
+    }
+    // Only the changed prefix of each strip is copied in, so the back
+    // buffer has to start out as the frame just queued
+    memcpy(halData.aFrames[nBack], halData.aFrames[nFront], sizeof(halData.aFrames[nBack]));
+    halData.nBack = nBack;
+}
+/**
+ * @brief esp_timer callback for the next frame of the render task
+ *
+ * @param pArg Unused
+ */
+static void HAL_Render_Timer_Callback(void *pArg)
+{
+    xTaskNotifyGive(halData.hRenderTask);
+}
+/**
+ * @brief Render task.  Runs the service, then sleeps until it is woken or
+ * its deadline passes.  The deadline is kept by an esp_timer since frames
+ * come faster than the FreeRTOS tick.  The strips are kept powered through
+ * a fade and let go once the service has nothing more to send.
+ *
+ * @param pArg Unused
+ */
+static void HAL_Render_Task(void *pArg)
+{
+    for (;;)
+    {
+        int64_t tNow = esp_timer_get_time();
+        int64_t tNext = halData.pfnRenderService(tNow);
+
+        esp_timer_stop(halData.hRenderTimer);
+        if (tNext != HAL_NO_DEADLINE)
+        {
+            int64_t tDelay = tNext - tNow;
+            if (tDelay <= 0)
+            {
+                continue;
+            }
+            esp_timer_start_once(halData.hRenderTimer, tDelay);
+        }
+        else
+        {
+            HAL_LED_Idle();
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+/**
+ * @brief Start the render task that runs the compositor
+ *
+ * @param pfnService Run by the render task when woken or when its frame is due
+ */
+void HAL_Render_Initialize(HAL_SERVICE pfnService)
+{
+    const esp_timer_create_args_t render_args = {
+        .callback = &HAL_Render_Timer_Callback,
+        .name = "Render",
+    };
+
+    halData.pfnRenderService = pfnService;
+    ESP_ERROR_CHECK(esp_timer_create(&render_args, &halData.hRenderTimer));
+    HAL_TASK_CREATE(HAL_Render_Task, "render", RENDER_TASK_STACK, RENDER_TASK_PRIORITY, &halData.hRenderTask, Render);
+}
+/**
+ * @brief Wake the render task to take a new scene
+ *
+ */
+void HAL_Render_Wake_Service(void)
+{
+    xTaskNotifyGive(halData.hRenderTask);
+}
+/**
+ * @brief Hand a packet that just arrived to the sync service
+ *
+ * @param pData Packet
+ * @param nLength Size of the packet
+ * @param tAt Time it arrived
+ */
+static void HAL_Sync_Queue_Packet(const uint8_t *pData, size_t nLength, int64_t tAt)
+{
+    HAL_SYNC_RX rx = {.tAt = tAt, .nLength = nLength};
+
+    if (nLength > HAL_SYNC_PACKET_MAX)
+    {
+        return;
+    }
+    memcpy(rx.aData, pData, nLength);
+    if (xQueueSend(halData.hSyncPackets, &rx, 0) == pdTRUE)
+    {
+        HAL_Sync_Wake_Service();
+    }
+}
+/**
+ * @brief Take the next packet that arrived over either link
+ *
+ * @param pData Where to put the packet
+ * @param nMaxLength Room at pData
+ * @param ptAt Returns the time it arrived
+ * @return size_t Size of the packet, 0 when none is waiting
+ */
+static size_t HAL_Sync_Receive(void *pData, size_t nMaxLength, int64_t *ptAt)
+{
+    HAL_SYNC_RX rx;
+
+    if (xQueueReceive(halData.hSyncPackets, &rx, 0) != pdTRUE || rx.nLength > nMaxLength)
+    {
+        return 0;
+    }
+    memcpy(pData, rx.aData, rx.nLength);
+    *ptAt = rx.tAt;
+    return rx.nLength;
+}
+/**
+ * @brief ESP-NOW receive callback, runs in the WiFi task
+ *
+ * @param pInfo Sender and radio details (unused)
+ * @param pData Packet
+ * @param nLength Size of the packet
+ */
+static void HAL_ESPNOW_Receive_Callback(const esp_now_recv_info_t *pInfo, const uint8_t *pData, int nLength)
+{
+    HAL_Sync_Queue_Packet(pData, (size_t)nLength, esp_timer_get_time());
+}
+/**
+ * @brief Bring up the radio in station mode, without joining a network, and
+ * ESP-NOW on it with a broadcast peer
+ *
+ * @return true Up
+ * @return false The radio could not be started
+ */
+static bool HAL_ESPNOW_Open(void)
+{
+    wifi_init_config_t wifi_config = WIFI_INIT_CONFIG_DEFAULT();
+    esp_now_peer_info_t peer = {
+        .peer_addr = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+        .channel = SYNC_ESPNOW_CHANNEL,
+        .ifidx = WIFI_IF_STA,
+        .encrypt = false,
+    };
+    esp_err_t err = esp_event_loop_create_default();
+
+    if (err == ESP_OK || err == ESP_ERR_INVALID_STATE)
+    {
+        err = esp_wifi_init(&wifi_config);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_wifi_set_mode(WIFI_MODE_STA);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_wifi_start();
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_wifi_set_channel(SYNC_ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_now_init();
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_now_register_recv_cb(&HAL_ESPNOW_Receive_Callback);
+    }
+    if (err == ESP_OK)
+    {
+        err = esp_now_add_peer(&peer);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "ESP-NOW failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    // The radio misses broadcasts while the chip light sleeps
+    HAL_Power_Lock(HAL_POWER_LOCK_LINK, true);
+    return true;
+}
+/**
+ * @brief Broadcast a packet over ESP-NOW
+ *
+ * @param pData Packet
+ * @param nLength Size of the packet
+ * @return true Queued to the radio
+ * @return false Not sent
+ */
+static bool HAL_ESPNOW_Send(const void *pData, size_t nLength)
+{
+    static const uint8_t abBroadcast[ESP_NOW_ETH_ALEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+    return esp_now_send(abBroadcast, pData, nLength) == ESP_OK;
+}
+/**
+ * @brief Frame the bytes arriving on the sync UART into packets.  A packet
+ * is SYNC_UART_START, its length, the bytes, and their sum.  It is stamped
+ * with the time the driver reported its first byte.
+ *
+ * @param pArg Unused
+ */
+static void HAL_Sync_UART_Task(void *pArg)
+{
+    uint8_t aFrame[HAL_SYNC_PACKET_MAX + 3];
+    size_t nFrame = 0;
+    int64_t tFrame = 0;
+
+    for (;;)
+    {
+        uart_event_t event;
+        uint8_t aData[64];
+        int nRead;
+
+        if (xQueueReceive(halData.hSyncUARTEvents, &event, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        int64_t tAt = esp_timer_get_time();
+        if (event.type != UART_DATA)
+        {
+            if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL)
+            {
+                uart_flush_input(SYNC_UART_NUM);
+                xQueueReset(halData.hSyncUARTEvents);
+                nFrame = 0;
+            }
+            continue;
+        }
+        while ((nRead = uart_read_bytes(SYNC_UART_NUM, aData, sizeof(aData), 0)) > 0)
+        {
+            for (int n = 0; n < nRead; n++)
+            {
+                if (nFrame == 0)
+                {
+                    if (aData[n] != SYNC_UART_START)
+                    {
+                        continue;
+                    }
+                    tFrame = tAt;
+                }
+                aFrame[nFrame++] = aData[n];
+                if (nFrame == 2 && aFrame[1] > HAL_SYNC_PACKET_MAX)
+                {
+                    nFrame = 0;
+                }
+                else if (nFrame > 2 && nFrame == (size_t)aFrame[1] + 3)
+                {
+                    uint8_t nSum = 0;
+                    for (size_t nByte = 2; nByte < nFrame - 1; nByte++)
+                    {
+                        nSum += aFrame[nByte];
+                    }
+                    if (nSum == aFrame[nFrame - 1])
+                    {
+                        HAL_Sync_Queue_Packet(aFrame + 2, aFrame[1], tFrame);
+                    }
+                    nFrame = 0;
+                }
+            }
+        }
+    }
+}
+/**
+ * @brief Start the spare UART for the sync link.  It is UART0, so the
+ * console has to be on USB (CONFIG_ESP_CONSOLE_USB_CDC); with the console
+ * on the same UART the link is refused rather than mixed with the log.
+ *
+ * @return true Up
+ * @return false The console has the UART, or the driver could not be installed
+ */
+static bool HAL_Sync_UART_Open(void)
+{
+    const uart_config_t uart_config = {
+        .baud_rate = SYNC_UART_BAUD,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_CLOCK};
+
+#if CONFIG_ESP_CONSOLE_UART && CONFIG_ESP_CONSOLE_UART_NUM == SYNC_UART_PORT
+    ESP_LOGE(TAG, "Sync UART %d is the console, move the console to USB CDC to use it", SYNC_UART_PORT);
+    return false;
+#endif
+    if (uart_driver_install(SYNC_UART_NUM, UART_RX_BUFFER_SIZE, 0, UART_EVENT_QUEUE_LENGTH,
+                            &halData.hSyncUARTEvents, 0) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Sync UART is in use");
+        return false;
+    }
+    uart_param_config(SYNC_UART_NUM, &uart_config);
+    uart_set_pin(SYNC_UART_NUM, SYNC_TXD_PIN, SYNC_RXD_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    HAL_TASK_CREATE(HAL_Sync_UART_Task, "syncrx", SYNC_UART_TASK_STACK, SYNC_TASK_PRIORITY + 1,
+                    &halData.hSyncUARTTask, SyncUART);
+    // Packets can come at any time, and the UART hears nothing in light sleep
+    HAL_Power_Lock(HAL_POWER_LOCK_LINK, true);
+    return true;
+}
+/**
+ * @brief Send a packet over the sync UART
+ *
+ * @param pData Packet
+ * @param nLength Size of the packet
+ * @return true Written
+ * @return false Too big
+ */
+static bool HAL_Sync_UART_Send(const void *pData, size_t nLength)
+{
+    uint8_t aFrame[HAL_SYNC_PACKET_MAX + 3];
+    uint8_t nSum = 0;
+
+    if (nLength > HAL_SYNC_PACKET_MAX)
+    {
+        return false;
+    }
+    aFrame[0] = SYNC_UART_START;
+    aFrame[1] = (uint8_t)nLength;
+    memcpy(aFrame + 2, pData, nLength);
+    for (size_t n = 0; n < nLength; n++)
+    {
+        nSum += aFrame[n + 2];
+    }
+    aFrame[nLength + 2] = nSum;
+    return uart_write_bytes(SYNC_UART_NUM, aFrame, nLength + 3) == (int)(nLength + 3);
+}
+/**
+ * @brief Get a link to the other timers, creating the receive queue the
+ * links share
+ *
+ * @param eLink Which link
+ * @return const HAL_TRANSPORT* The link, NULL when this build has none of that kind
+ */
+const HAL_TRANSPORT *HAL_Sync_Transport(HAL_LINK eLink)
+{
+    static const HAL_TRANSPORT transportESPNOW = {"ESP-NOW", &HAL_ESPNOW_Open, &HAL_ESPNOW_Send, &HAL_Sync_Receive};
+    static const HAL_TRANSPORT transportUART = {"UART", &HAL_Sync_UART_Open, &HAL_Sync_UART_Send, &HAL_Sync_Receive};
+
+    if (halData.hSyncPackets == NULL)
+    {
+#if STATIC_ALLOCATION_ENABLE
+        halData.hSyncPackets = xQueueCreateStatic(SYNC_QUEUE_LENGTH, sizeof(HAL_SYNC_RX), halStatic.aSyncPackets,
+                                                  &halStatic.queueSyncPackets);
+#else
+        halData.hSyncPackets = xQueueCreate(SYNC_QUEUE_LENGTH, sizeof(HAL_SYNC_RX));
+#endif
+    }
+    switch (eLink)
+    {
+    case HAL_LINK_ESPNOW:
+        return &transportESPNOW;
+    case HAL_LINK_UART:
+        return &transportUART;
+    default:
+        return NULL;
+    }
+}
+/**
+ * @brief esp_timer callback for the next deadline of the sync task
+ *
+ * @param pArg Unused
+ */
+static void HAL_Sync_Timer_Callback(void *pArg)
+{
+    xTaskNotifyGive(halData.hSyncTask);
+}
+/**
+ * @brief Sync task.  Runs the service, then sleeps until a packet arrives
+ * or its deadline passes.
+ *
+ * @param pArg Unused
+ */
+static void HAL_Sync_Task(void *pArg)
+{
+    for (;;)
+    {
+        int64_t tNow = esp_timer_get_time();
+        int64_t tNext = halData.pfnSyncService(tNow);
+
+        esp_timer_stop(halData.hSyncTimer);
+        if (tNext != HAL_NO_DEADLINE)
+        {
+            int64_t tDelay = tNext - tNow;
+            if (tDelay <= 0)
+            {
+                continue;
+            }
+            esp_timer_start_once(halData.hSyncTimer, tDelay);
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+/**
+ * @brief Start the sync task
+ *
+ * @param pfnService Run by the sync task when a packet arrives or its deadline passes
+ */
+void HAL_Sync_Initialize(HAL_SERVICE pfnService)
+{
+    const esp_timer_create_args_t sync_args = {
+        .callback = &HAL_Sync_Timer_Callback,
+        .name = "Sync",
+    };
+
+    halData.pfnSyncService = pfnService;
+    ESP_ERROR_CHECK(esp_timer_create(&sync_args, &halData.hSyncTimer));
+    HAL_TASK_CREATE(HAL_Sync_Task, "sync", SYNC_TASK_STACK, SYNC_TASK_PRIORITY, &halData.hSyncTask, Sync);
+}
+/**
+ * @brief Wake the sync task, from any task
+ *
+ */
+void HAL_Sync_Wake_Service(void)
+{
+    if (halData.hSyncTask != NULL)
+    {
+        xTaskNotifyGive(halData.hSyncTask);
+    }
+}
+/**
+ * @brief Debounce a change of either button source and pass accepted edges
+ * to the app.  Must be called with muxButton held, which also keeps the
+ * button ring down to a single producer when the touch pad is enabled.
+ *
+ * @param tEdge Time of the raw edge
+ * @param pbWoken Set when a higher priority task was woken
+ */
+static void IRAM_ATTR HAL_Button_Edge(int64_t tEdge, BaseType_t *pbWoken)
+{
+    bool bPressed = halData.bGPIOPressed || halData.bTouchPressed;
+    EVENT event = {
+        .eType = bPressed ? EVENT_BUTTON_PRESS : EVENT_BUTTON_RELEASE,
+        .tTime = tEdge,
+    };
+
+    if (HAL_Debounce_Edge(&halData.debounce, tEdge, bPressed))
+    {
+        Event_Ring_Push(&halData.ringButton, &event);
+        if (halData.hAppTask != NULL)
+        {
+            vTaskNotifyGiveFromISR(halData.hAppTask, pbWoken);
+        }
+    }
+}
+/**
+ * @brief Timestamp every edge of the push button
+ *
+ * @param pArg Unused
+ */
+static void IRAM_ATTR HAL_Button_ISR(void *pArg)
+{
+    BaseType_t bWoken = pdFALSE;
+    int64_t tEdge = esp_timer_get_time();
+
+    portENTER_CRITICAL_ISR(&halData.muxButton);
+    halData.bGPIOPressed = gpio_get_level(PUSH_BUTTON_PORT) == 0;
+#if HAL_POWER_SAVE
+    // Only a level wakes the chip, so wait for the level the button goes to next
+    gpio_ll_set_intr_type(&GPIO, PUSH_BUTTON_PORT, halData.bGPIOPressed ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+#endif
+    HAL_Button_Edge(tEdge, &bWoken);
+    portEXIT_CRITICAL_ISR(&halData.muxButton);
+    portYIELD_FROM_ISR(bWoken);
+}
+#if TOUCH_BUTTON_ENABLE
+/**
+ * @brief Feed touch pad presses and releases through the same path as the
+ * push button.  Runs in the touch element task.
+ *
+ * @param hButton Touch button handle
+ * @param pMessage What happened to the touch button
+ * @param pArg Unused
+ */
+static void HAL_Touch_Callback(touch_button_handle_t hButton, touch_button_message_t *pMessage, void *pArg)
+{
+    BaseType_t bWoken = pdFALSE;
+    int64_t tEdge = esp_timer_get_time();
+
+    if (pMessage->event != TOUCH_BUTTON_EVT_ON_PRESS &&
+        pMessage->event != TOUCH_BUTTON_EVT_ON_RELEASE)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&halData.muxButton);
+    halData.bTouchPressed = pMessage->event == TOUCH_BUTTON_EVT_ON_PRESS;
+    HAL_Button_Edge(tEdge, &bWoken);
+    portEXIT_CRITICAL(&halData.muxButton);
+}
+/**
+ * @brief Set up the capacitive touch pad as a second button
+ *
+ */
+static void HAL_Touch_Initialize(void)
+{
+    touch_elem_global_config_t global_config = TOUCH_ELEM_GLOBAL_DEFAULT_CONFIG();
+    touch_button_global_config_t button_global_config = TOUCH_BUTTON_GLOBAL_DEFAULT_CONFIG();
+    touch_button_config_t button_config = {
+        .channel_num = TOUCH_BUTTON_CHANNEL,
+        .channel_sens = 0.1F,
+    };
+    touch_button_handle_t hButton;
+
+    ESP_ERROR_CHECK(touch_element_install(&global_config));
+    ESP_ERROR_CHECK(touch_button_install(&button_global_config));
+    ESP_ERROR_CHECK(touch_button_create(&button_config, &hButton));
+    ESP_ERROR_CHECK(touch_button_subscribe_event(hButton, TOUCH_ELEM_EVENT_ON_PRESS | TOUCH_ELEM_EVENT_ON_RELEASE, NULL));
+    ESP_ERROR_CHECK(touch_button_set_dispatch_method(hButton, TOUCH_ELEM_DISP_CALLBACK));
+    ESP_ERROR_CHECK(touch_button_set_callback(hButton, &HAL_Touch_Callback));
+    ESP_ERROR_CHECK(touch_element_start());
+}
+#endif
+/**
+ * @brief Configure the push button as an input with a pull-up and an
+ * interrupt on both edges, so the button is never polled.  With power save
+ * the interrupt is on the level the button is not at, flipped after every
+ * edge, since only a level can wake the chip from light sleep.
+ *
+ */
+void HAL_Button_Initialize(void)
+{
+    // zero-initialize the config structure.
+    gpio_config_t io_conf = {};
+    // interrupt when the button is pressed or released
+#if HAL_POWER_SAVE
+    io_conf.intr_type = GPIO_INTR_LOW_LEVEL;
+#else
+    io_conf.intr_type = GPIO_INTR_ANYEDGE;
+#endif
+    // set as output mode
+    io_conf.mode = GPIO_MODE_INPUT;
+    // bit mask of the pins that you want to set,e.g.GPIO18/19
+    io_conf.pin_bit_mask = 1ULL << PUSH_BUTTON_PORT;
+    // disable pull-down mode
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    // enable pull-up mode
+    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+    // configure GPIO with the given settings
+    gpio_config(&io_conf);
+#if HAL_POWER_SAVE
+    gpio_wakeup_enable(PUSH_BUTTON_PORT, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+#endif
+
+    // Edges are measured from boot, so the first one is never taken as bounce
+    halData.debounce.tLastEdge = -HAL_BUTTON_DEBOUNCE_US;
+    gpio_install_isr_service(0);
+    gpio_isr_handler_add(PUSH_BUTTON_PORT, HAL_Button_ISR, NULL);
+#if TOUCH_BUTTON_ENABLE
+    HAL_Touch_Initialize();
+#endif
+}
+/**
+ * @brief Determine if the push button (or touch pad) is currently held down
+ *
+ * @return true Button is pressed (pulled to ground)
+ * @return false Button is released
+ */
+bool HAL_Button_Is_Pressed(void)
+{
+    return gpio_get_level(PUSH_BUTTON_PORT) == 0 || halData.bTouchPressed;
+}
+/**
+ * @brief Console task.  Passes each key typed on the log console to the
+ * app.  It blocks until a byte arrives, on the UART driver's events when
+ * the console is a UART and in a blocking read otherwise.
+ *
+ * @param pArg Unused
+ */
+static void HAL_Console_Task(void *pArg)
+{
+    for (;;)
+    {
+        uint8_t aKeys[16];
+        int nRead;
+
+#if CONFIG_ESP_CONSOLE_UART
+        uart_event_t uartEvent;
+
+        if (xQueueReceive(halData.hConsoleEvents, &uartEvent, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        if (uartEvent.type != UART_DATA)
+        {
+            if (uartEvent.type == UART_FIFO_OVF || uartEvent.type == UART_BUFFER_FULL)
+            {
+                uart_flush_input(CONFIG_ESP_CONSOLE_UART_NUM);
+                xQueueReset(halData.hConsoleEvents);
+            }
+            continue;
+        }
+        nRead = uart_read_bytes(CONFIG_ESP_CONSOLE_UART_NUM, aKeys, sizeof(aKeys), 0);
+#else
+        nRead = read(STDIN_FILENO, aKeys, sizeof(aKeys));
+#endif
+        int64_t tAt = esp_timer_get_time();
+        for (int n = 0; n < nRead; n++)
+        {
+            EVENT event = {
+                .eType = EVENT_CONSOLE_KEY,
+                .tTime = tAt,
+                .nParam = aKeys[n],
+            };
+            if (Event_Ring_Push(&halData.ringConsole, &event))
+            {
+                HAL_Wake_App();
+            }
+        }
+    }
+}
+/**
+ * @brief Start reading keys from the log console.  A UART console gets its
+ * driver, with the log written through it, so the console task can wait on
+ * its events; any other console has its reads made blocking.
+ *
+ */
+void HAL_Console_Initialize(void)
+{
+#if CONFIG_ESP_CONSOLE_NONE
+    return;
+#else
+#if CONFIG_ESP_CONSOLE_UART
+    if (uart_driver_install(CONFIG_ESP_CONSOLE_UART_NUM, UART_RX_BUFFER_SIZE, 0, UART_EVENT_QUEUE_LENGTH,
+                            &halData.hConsoleEvents, 0) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Console UART is in use, keys are ignored");
+        return;
+    }
+    esp_vfs_dev_uart_use_driver(CONFIG_ESP_CONSOLE_UART_NUM);
+#else
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) & ~O_NONBLOCK);
+#endif
+    HAL_TASK_CREATE(HAL_Console_Task, "console", CONSOLE_TASK_STACK, CONSOLE_TASK_PRIORITY, &halData.hConsoleTask,
+                    Console);
+#endif
+}
+/**
+ * @brief Write a line to the log console
+ *
+ * @param pszLine Line, without the line ending
+ */
+void HAL_Console_Write(const char *pszLine)
+{
+    fputs(pszLine, stdout);
+    fputc('\n', stdout);
+}
+/**
+ * @brief Log task.  Runs the drain service each time it is woken.
+ *
+ * @param pArg Unused
+ */
+static void HAL_Log_Task(void *pArg)
+{
+    for (;;)
+    {
+        halData.pfnLogService(esp_timer_get_time());
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+/**
+ * @brief Start the log task that drains the deferred log
+ *
+ * @param pfnService Run by the log task whenever it is woken
+ */
+void HAL_Log_Initialize(HAL_SERVICE pfnService)
+{
+    halData.pfnLogService = pfnService;
+    HAL_TASK_CREATE(HAL_Log_Task, "log", LOG_TASK_STACK, LOG_TASK_PRIORITY, &halData.hLogTask, Log);
+}
+/**
+ * @brief Wake the log task to drain what has been logged.  Any task may
+ * call this, even before the log task has started.
+ *
+ */
+void HAL_Log_Wake_Service(void)
+{
+    if (halData.hLogTask != NULL)
+    {
+        xTaskNotifyGive(halData.hLogTask);
+    }
+}
+/**
+ * @brief Audio task.  Runs the service, then sleeps on the UART event queue
+ * until bytes arrive, the service is woken, or its deadline passes.  The
+ * audio power lock is given back once the service has nothing left to wait
+ * for, since the UART hears nothing while the chip light sleeps.
+ *
+ * @param pArg Unused
+ */
+static void HAL_UART_Task(void *pArg)
+{
+    for (;;)
+    {
+        int64_t tNow = esp_timer_get_time();
+        int64_t tNext = halData.pfnUARTService(tNow);
+        TickType_t nTicks = portMAX_DELAY;
+        uart_event_t event;
+
+        if (tNext != HAL_NO_DEADLINE)
+        {
+            int64_t tDelay = tNext - tNow;
+            if (tDelay <= 0)
+            {
+                continue;
+            }
+            // Round up so the service never runs before its deadline
+            nTicks = (tDelay + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000);
+        }
+        else
+        {
+            HAL_Power_Lock(HAL_POWER_LOCK_AUDIO, false);
+        }
+        if (xQueueReceive(halData.hUARTEvents, &event, nTicks) == pdTRUE &&
+            (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL))
+        {
+            ESP_LOGW(TAG, "DFPlayer UART overflow");
+            uart_flush_input(UART_NUM);
+            xQueueReset(halData.hUARTEvents);
+        }
+    }
+}
+/**
+ * @brief Initialize the UART connected to the DFPlayer and start the audio
+ * task that owns it.  The audio power lock is held until the module has
+ * reported in and taken the first commands.
+ *
+ * @param pfnService Run by the audio task whenever there is something to do
+ */
+void HAL_UART_Initialize(HAL_SERVICE pfnService)
+{
+    const uart_config_t uart_config = {
+        .baud_rate = 9600,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_CLOCK};
+
+    HAL_Power_Lock(HAL_POWER_LOCK_AUDIO, true);
+    uart_driver_install(UART_NUM, UART_RX_BUFFER_SIZE, 0, UART_EVENT_QUEUE_LENGTH, &halData.hUARTEvents, 0);
+    uart_param_config(UART_NUM, &uart_config);
+    uart_set_pin(UART_NUM, TXD_PIN, RXD_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+
+    halData.pfnUARTService = pfnService;
+    HAL_TASK_CREATE(HAL_UART_Task, "audio", AUDIO_TASK_STACK, AUDIO_TASK_PRIORITY, &halData.hAudioTask, Audio);
+}
+/**
+ * @brief Read whatever the DFPlayer has sent, without waiting
+ *
+ * @param pData Where to put the bytes
+ * @param nMaxLength Most bytes to read
+ * @return size_t Number of bytes read
+ */
+size_t HAL_UART_Read(uint8_t *pData, size_t nMaxLength)
+{
+    int nRead = uart_read_bytes(UART_NUM, pData, nMaxLength, 0);
+    return nRead > 0 ? (size_t)nRead : 0;
+}
+/**
+ * @brief Wake the audio task to run its service
+ *
+ */
+void HAL_UART_Wake_Service(void)
+{
+    uart_event_t event = {.type = UART_EVENT_WAKE};
+
+    xQueueSend(halData.hUARTEvents, &event, 0);
+}
+/**
+ * @brief Write bytes to the DFPlayer UART, taking the audio power lock
+ * until the audio service has its answer
+ *
+ * @param pData Bytes to write
+ * @param nLength Number of bytes
+ */
+void HAL_UART_Write(const uint8_t *pData, size_t nLength)
+{
+    HAL_Power_Lock(HAL_POWER_LOCK_AUDIO, true);
+    uart_write_bytes(UART_NUM, (const char *)pData, nLength);
+}
+/**
+ * @brief Bring up NVS and open the settings namespace.  A partition that is
+ * full or from a newer layout is erased, losing the settings.
+ *
+ * @return true Settings can be read and written
+ * @return false NVS is not usable, loads fail and saves are dropped
+ */
+bool HAL_Settings_Initialize(void)
+{
+    esp_err_t err = nvs_flash_init();
+
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_LOGW(TAG, "Erasing NVS: %s", esp_err_to_name(err));
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_open(SETTINGS_NAMESPACE, NVS_READWRITE, &halData.hSettings);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Settings unavailable: %s", esp_err_to_name(err));
+        halData.hSettings = 0;
+        return false;
+    }
+    return true;
+}
+/**
+ * @brief Read a setting
+ *
+ * @param pszKey Name of the setting, at most 15 characters
+ * @param pData Where to put the value
+ * @param nLength Size of the value
+ * @return true Read
+ * @return false Not stored, or stored with a different size
+ */
+bool HAL_Settings_Load(const char *pszKey, void *pData, size_t nLength)
+{
+    size_t nStored = nLength;
+
+    if (halData.hSettings == 0 ||
+        nvs_get_blob(halData.hSettings, pszKey, NULL, &nStored) != ESP_OK || nStored != nLength)
+    {
+        return false;
+    }
+    return nvs_get_blob(halData.hSettings, pszKey, pData, &nStored) == ESP_OK;
+}
+/**
+ * @brief Write a setting and commit it to flash
+ *
+ * @param pszKey Name of the setting, at most 15 characters
+ * @param pData Value to store
+ * @param nLength Size of the value
+ * @return true Written
+ * @return false NVS is not usable or the write failed
+ */
+bool HAL_Settings_Save(const char *pszKey, const void *pData, size_t nLength)
+{
+    esp_err_t err;
+
+    if (halData.hSettings == 0)
+    {
+        return false;
+    }
+    err = nvs_set_blob(halData.hSettings, pszKey, pData, nLength);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(halData.hSettings);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Saving %s failed: %s", pszKey, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+/**
+ * @brief Read back what was kept through a warm reset
+ *
+ * @param pData Where to put the data
+ * @param nLength Size of the data
+ * @return true Read
+ * @return false Nothing was kept (power on), or it was of a different size
+ */
+bool HAL_Retained_Load(void *pData, size_t nLength)
+{
+    if (halRetained.nMagic != RETAINED_MAGIC || halRetained.nLength != nLength ||
+        nLength > HAL_RETAINED_SIZE ||
+        esp_rom_crc32_le(0, halRetained.aData, nLength) != halRetained.nCRC)
+    {
+        return false;
+    }
+    memcpy(pData, halRetained.aData, nLength);
+    return true;
+}
+/**
+ * @brief Keep data in RTC memory through a warm reset
+ *
+ * @param pData Data to keep
+ * @param nLength Size of the data, at most HAL_RETAINED_SIZE
+ */
+void HAL_Retained_Save(const void *pData, size_t nLength)
+{
+    ESP_ERROR_CHECK(nLength > HAL_RETAINED_SIZE ? ESP_ERR_INVALID_SIZE : ESP_OK);
+    memcpy(halRetained.aData, pData, nLength);
+    halRetained.nLength = nLength;
+    halRetained.nCRC = esp_rom_crc32_le(0, halRetained.aData, nLength);
+    halRetained.nMagic = RETAINED_MAGIC;
+}
+/**
+ * @brief Get the current time
+ *
+ * @return int64_t Time in microseconds since boot
+ */
+int64_t HAL_Get_Time(void)
+{
+    return esp_timer_get_time();
+}
+/**
+ * @brief Get the system time, which the RTC timer keeps running through a
+ * warm reset.  It starts again from zero when the power comes back.
+ *
+ * @return int64_t Time in microseconds
+ */
+int64_t HAL_Get_Epoch(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+/**
+ * @brief Block the calling task
+ *
+ * @param nMilliseconds How long to wait
+ */
+void HAL_Delay_ms(uint32_t nMilliseconds)
+{
+    vTaskDelay(pdMS_TO_TICKS(nMilliseconds));
+}
+/**
+ * @brief esp_timer callback for the app deadline
+ *
+ * @param pArg Unused
+ */
+static void HAL_Deadline_Callback(void *pArg)
+{
+    xTaskNotifyGive(halData.hAppTask);
+}
+/**
+ * @brief Create the app deadline timer and remember the calling task as the
+ * one to notify when the app needs to run
+ *
+ * @return true Timer was created
+ * @return false Timer could not be created
+ */
+bool HAL_Initialize_Wake(void)
+{
+    const esp_timer_create_args_t deadline_args = {
+        .callback = &HAL_Deadline_Callback,
+        .name = "Deadline",
+    };
+
+    halData.hAppTask = xTaskGetCurrentTaskHandle();
+    if (esp_timer_create(&deadline_args, &halData.hDeadlineTimer) != ESP_OK)
+    {
+        ESP_LOGI(TAG, "Failed to create deadline timer");
+        return false;
+    }
+    return true;
+}
+/**
+ * @brief Sleep until the deadline or until HAL_Wake_App is called
+ *
+ * @param tDeadline Time in microseconds to wake, HAL_NO_DEADLINE to wait for a wake
+ * @return true Always, the firmware runs forever
+ */
+bool HAL_Wait_Until(int64_t tDeadline)
+{
+    esp_timer_stop(halData.hDeadlineTimer);
+    if (tDeadline != HAL_NO_DEADLINE)
+    {
+        int64_t tDelay = tDeadline - esp_timer_get_time();
+        if (tDelay <= 0)
+        {
+            return true;
+        }
+        esp_timer_start_once(halData.hDeadlineTimer, tDelay);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return true;
+}
+/**
+ * @brief Wake the app before its deadline
+ *
+ */
+void HAL_Wake_App(void)
+{
+    xTaskNotifyGive(halData.hAppTask);
+}
+/**
+ * @brief Get the next event for the app.  Only the app task may call this.
+ *
+ * @param pEvent Where to put the event
+ * @return true An event was returned
+ * @return false No events are waiting
+ */
+bool HAL_Get_Event(EVENT *pEvent)
+{
+    return Event_Ring_Pop(&halData.ringButton, pEvent) || Event_Ring_Pop(&halData.ringConsole, pEvent);
+}
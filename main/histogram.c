@@ -0,0 +1,165 @@
+/**
+ * @file histogram.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Fixed bucket histograms of timing measurements
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "app.h"
+#include "histogram.h"
+
+static const char *TAG = "histogram";
+
+/**
+ * @brief Find the bucket for a value.  Values below HISTOGRAM_SUB_BUCKETS
+ * get a bucket each, and every power of two above that is split into
+ * HISTOGRAM_SUB_BUCKETS equal buckets.
+ *
+ * @param nValue Value to place
+ * @return int Bucket index
+ */
+static inline int Histogram_Bucket(uint32_t nValue)
+{
+    int nTopBit;
+
+    if (nValue < HISTOGRAM_SUB_BUCKETS)
+    {
+        return (int)nValue;
+    }
+    nTopBit = 31 - __builtin_clz(nValue);
+    return ((nTopBit - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) +
+           (int)((nValue >> (nTopBit - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+/**
+ * @brief Get the largest value that falls in a bucket
+ *
+ * @param nBucket Bucket index
+ * @return uint32_t Largest value of the bucket
+ */
+static uint32_t Histogram_Bucket_Top(int nBucket)
+{
+    int nShift;
+
+    if (nBucket < HISTOGRAM_SUB_BUCKETS)
+    {
+        return (uint32_t)nBucket;
+    }
+    nShift = (nBucket >> HISTOGRAM_SUB_BITS) - 1;
+    return (uint32_t)((((uint64_t)(nBucket & (HISTOGRAM_SUB_BUCKETS - 1)) + HISTOGRAM_SUB_BUCKETS + 1) << nShift) - 1);
+}
+/**
+ * @brief Forget every sample
+ *
+ * @param pHistogram Histogram to clear
+ */
+void Histogram_Reset(HISTOGRAM *pHistogram)
+{
+    memset(pHistogram, 0, sizeof(*pHistogram));
+}
+/**
+ * @brief Add a sample.  Cheap enough to call on every wake or frame.
+ *
+ * @param pHistogram Histogram to add to
+ * @param nValue Sample, negative values count as 0 and values past
+ * UINT32_MAX as UINT32_MAX
+ */
+void Histogram_Record(HISTOGRAM *pHistogram, int64_t nValue)
+{
+    uint32_t nSample = nValue < 0 ? 0 : nValue > UINT32_MAX ? UINT32_MAX : (uint32_t)nValue;
+
+    if (pHistogram->nCount == 0 || nSample < pHistogram->nMin)
+    {
+        pHistogram->nMin = nSample;
+    }
+    if (nSample > pHistogram->nMax)
+    {
+        pHistogram->nMax = nSample;
+    }
+    pHistogram->nTotal += nSample;
+    pHistogram->anBuckets[Histogram_Bucket(nSample)]++;
+    pHistogram->nCount++;
+}
+/**
+ * @brief Get a percentile.  The answer is the top of the bucket the
+ * percentile falls in, so it is never below the true value and at most a
+ * quarter above it.
+ *
+ * @param pHistogram Histogram to read
+ * @param nPerMille Percentile in tenths of a percent, 0 to 1000
+ * @return uint32_t Value at or below which the share of samples falls, 0 when empty
+ */
+uint32_t Histogram_Percentile(const HISTOGRAM *pHistogram, uint32_t nPerMille)
+{
+    uint64_t nRank = ((uint64_t)pHistogram->nCount * nPerMille + 999) / 1000;
+    uint64_t nSeen = 0;
+
+    if (pHistogram->nCount == 0)
+    {
+        return 0;
+    }
+    for (int nBucket = 0; nBucket < HISTOGRAM_BUCKETS; nBucket++)
+    {
+        nSeen += pHistogram->anBuckets[nBucket];
+        if (nSeen >= nRank && nSeen > 0)
+        {
+            uint32_t nTop = Histogram_Bucket_Top(nBucket);
+            return nTop < pHistogram->nMax ? nTop : pHistogram->nMax;
+        }
+    }
+    return pHistogram->nMax;
+}
+/**
+ * @brief Log the summary of a histogram and its buckets that hold samples
+ *
+ * @param pszName What the histogram measures
+ * @param pHistogram Histogram to log
+ */
+void Histogram_Log(const char *pszName, const HISTOGRAM *pHistogram)
+{
+    // Copied first so a task recording into it cannot move it under us
+    HISTOGRAM copy = *pHistogram;
+
+    if (copy.nCount == 0)
+    {
+        ESP_LOGI(TAG, "%s: no samples", pszName);
+        return;
+    }
+    ESP_LOGI(TAG, "%s: %lu samples, min %lu mean %lu p50 %lu p90 %lu p99 %lu p99.9 %lu max %lu us", pszName,
+             (unsigned long)copy.nCount, (unsigned long)copy.nMin, (unsigned long)(copy.nTotal / copy.nCount),
+             (unsigned long)Histogram_Percentile(&copy, 500), (unsigned long)Histogram_Percentile(&copy, 900),
+             (unsigned long)Histogram_Percentile(&copy, 990), (unsigned long)Histogram_Percentile(&copy, 999),
+             (unsigned long)copy.nMax);
+    for (int nBucket = 0; nBucket < HISTOGRAM_BUCKETS; nBucket++)
+    {
+        if (copy.anBuckets[nBucket] != 0)
+        {
+            ESP_LOGI(TAG, "%s: <= %lu us %lu", pszName, (unsigned long)Histogram_Bucket_Top(nBucket),
+                     (unsigned long)copy.anBuckets[nBucket]);
+        }
+    }
+}
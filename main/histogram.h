@@ -0,0 +1,75 @@
+/**
+ * @file histogram.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Fixed bucket histograms of timing measurements
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _HISTOGRAM_H
+#define _HISTOGRAM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+// Buckets per power of two, as a power of two.  Each bucket is at most a
+// quarter wider than the one before it.
+#define HISTOGRAM_SUB_BITS 2
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+// Enough buckets to hold any uint32_t
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * (32 - HISTOGRAM_SUB_BITS + 1))
+
+  /**
+   * @brief Distribution of a measurement in microseconds.  Only one task
+   * may record into a histogram; others may read it at any time and see
+   * counts that are at most one sample apart.
+   *
+   */
+  typedef struct
+  {
+    uint32_t nCount;                       // Samples recorded
+    uint32_t nMin;                         // Smallest sample
+    uint32_t nMax;                         // Largest sample
+    uint64_t nTotal;                       // Sum of the samples, for the mean
+    uint32_t anBuckets[HISTOGRAM_BUCKETS]; // Samples in each bucket
+  } HISTOGRAM;
+
+  extern void Histogram_Reset(HISTOGRAM *pHistogram);
+  extern void Histogram_Record(HISTOGRAM *pHistogram, int64_t nValue);
+  extern uint32_t Histogram_Percentile(const HISTOGRAM *pHistogram, uint32_t nPerMille);
+  extern void Histogram_Log(const char *pszName, const HISTOGRAM *pHistogram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HISTOGRAM_H */
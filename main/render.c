@@ -0,0 +1,444 @@
+/**
+ * @file render.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Compositor that fades the display between scenes in its own task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "app.h"
+#include "render.h"
+
+static const char *TAG = "render";
+
+// Set on the published slot until the render task takes it
+#define RENDER_SLOT_FRESH 0x80u
+
+/**
+ * @brief Everything the LEDs should end up showing
+ *
+ */
+typedef struct
+{
+    uint32_t amDigits[DISPLAY_DIGITS]; // Segments lit on each digit
+    rgb_t color;                       // Color of the lit segments
+    uint8_t nBrightness;               // Overall brightness (0-255)
+    int64_t tFade;                     // Time to fade to this scene, 0 to cut
+    int64_t tDue;                      // When the clock said it should appear, 0 if it is not timed
+} RENDER_SCENE;
+
+typedef struct
+{
+    RENDER_SCENE aScenes[3];             // Triple buffer between the app and the render task
+    atomic_uint nPublished;              // Slot last published, RENDER_SLOT_FRESH until taken
+    unsigned nWriting;                   // Slot the app fills, owned by the app task
+    unsigned nReading;                   // Slot being rendered, owned by the render task
+    RENDER_SCENE sceneLast;              // Scene last published, to skip repeats
+    bool bSceneValid;                    // sceneLast has been set
+    int anDigitFrame[DISPLAY_DIGITS];    // First LED of each digit in the frame
+    int anStripFrame[LED_STRIPS];        // First LED of each strip in the frame
+    int anStripLeds[LED_STRIPS];         // Number of LEDs on each strip
+    rgb_t aFrom[LED_STRIP_TOTAL_LEDS];   // Every LED when the fade started
+    rgb_t aTo[LED_STRIP_TOTAL_LEDS];     // Every LED once the fade is done
+    rgb_t aFrame[LED_STRIP_TOTAL_LEDS];  // Every LED in the last frame, before brightness
+    rgb_t aOut[LED_STRIP_TOTAL_LEDS];    // Every LED of the frame being composed, as it will be sent
+    rgb_t aShown[LED_STRIP_TOTAL_LEDS];  // Every LED as sent to the strips
+    bool bShownValid;                    // The LEDs hold a frame we sent
+    uint8_t aColorLUT[256];              // Gamma corrected brightness of each channel value
+    int nLUTBrightness;                  // Brightness aColorLUT was built for, -1 for none
+    int64_t tFadeStart;                  // When the current fade started
+    int64_t tFadeLength;                 // How long the current fade lasts
+    bool bFading;                        // Frames are still due for the current fade
+    int64_t nLastSlot;                   // Frame slot of the fade last rendered
+    int64_t tSceneDue;                   // tDue of the scene until its first frame is out, 0 for none
+    int64_t tFirstFrame;                 // When the first frame was clocked out, set before bFirstFrame
+    atomic_bool bFirstFrame;             // tFirstFrame is set and the app task may read it
+    RENDER_STATS stats;                  // Counters
+} RENDER_DATA;
+
+static RENDER_DATA renderData;
+
+/**
+ * @brief The LED map generated from display.layout.  Frames hold the LEDs
+ * in the order they are clocked out, the strips one after the other.
+ */
+static const uint8_t anLayoutSegment[LAYOUT_TOTAL_LEDS] = LAYOUT_SEGMENT_INIT;      // Segment bit of each LED, digits in order
+static const uint16_t anLayoutDigitFirst[DISPLAY_DIGITS] = LAYOUT_DIGIT_FIRST_INIT; // First LED of each digit in anLayoutSegment
+static const uint16_t anLayoutDigitLeds[DISPLAY_DIGITS] = LAYOUT_DIGIT_LEDS_INIT;   // LEDs of each digit
+
+/**
+ * @brief Perceived brightness to PWM value, 255 * (n / 255) ^ 2.2
+ */
+static const uint8_t aGamma[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+/**
+ * @brief Build the channel lookup table for a brightness
+ *
+ * @param nBrightness Overall brightness (0-255), applied before gamma
+ */
+static void Render_Set_Brightness(uint8_t nBrightness)
+{
+    for (int nValue = 0; nValue < 256; nValue++)
+    {
+        renderData.aColorLUT[nValue] = aGamma[(nValue * nBrightness + 127) / 255];
+    }
+    renderData.nLUTBrightness = nBrightness;
+}
+/**
+ * @brief Mix two colors a channel at a time
+ *
+ * @param from Color at nAlpha 0
+ * @param to Color at RENDER_FADE_ALPHA_MAX
+ * @param nAlpha Weight of to, 0 to RENDER_FADE_ALPHA_MAX
+ * @return rgb_t Blended color
+ */
+static inline rgb_t Render_Blend(rgb_t from, rgb_t to, uint32_t nAlpha)
+{
+    uint32_t nKeep = RENDER_FADE_ALPHA_MAX - nAlpha;
+
+    if (from == to)
+    {
+        return to;
+    }
+    return rgb((RGB_GET_R(from) * nKeep + RGB_GET_R(to) * nAlpha) >> 8,
+               (RGB_GET_G(from) * nKeep + RGB_GET_G(to) * nAlpha) >> 8,
+               (RGB_GET_B(from) * nKeep + RGB_GET_B(to) * nAlpha) >> 8);
+}
+/**
+ * @brief Start fading from whatever is on the display to a new scene.
+ * A scene arriving part way through a fade starts from the blend shown,
+ * so nothing jumps.
+ *
+ * @param pScene Scene to fade to
+ * @param tNow Current time
+ */
+static void Render_Start_Scene(const RENDER_SCENE *pScene, int64_t tNow)
+{
+    memcpy(renderData.aFrom, renderData.aFrame, sizeof(renderData.aFrom));
+    for (int nDigit = 0; nDigit < DISPLAY_DIGITS; nDigit++)
+    {
+        uint32_t mThisDigit = pScene->amDigits[nDigit];
+        const uint8_t *pnSegment = &anLayoutSegment[anLayoutDigitFirst[nDigit]];
+        rgb_t *pTo = &renderData.aTo[renderData.anDigitFrame[nDigit]];
+
+        for (int nLed = 0; nLed < anLayoutDigitLeds[nDigit]; nLed++)
+        {
+            // LEDs the layout skips stay dark
+            pTo[nLed] = (pnSegment[nLed] != LAYOUT_SKIP && (mThisDigit & (1u << pnSegment[nLed]))) ? pScene->color : RGB_BLACK;
+        }
+    }
+    if (pScene->nBrightness != renderData.nLUTBrightness)
+    {
+        Render_Set_Brightness(pScene->nBrightness);
+    }
+    renderData.tFadeStart = tNow;
+    // Nothing to fade from until the LEDs hold a frame we sent
+    renderData.tFadeLength = renderData.bShownValid ? pScene->tFade : 0;
+    renderData.nLastSlot = -1;
+    renderData.tSceneDue = pScene->tDue;
+    renderData.bFading = true;
+}
+/**
+ * @brief Compose the frame for a point in the fade and send the LEDs that
+ * changed.  The channels go through the brightness table, then if the
+ * frame would draw more than LED_CURRENT_BUDGET_MA every LED is scaled
+ * down so it just fits.  Only the shortest prefix of each strip covering
+ * its changed LEDs is clocked out.
+ *
+ * @param nAlpha Weight of the new scene, 0 to RENDER_FADE_ALPHA_MAX
+ */
+static void Render_Compose(uint32_t nAlpha)
+{
+    uint32_t nChannelSum = 0;
+    uint64_t nLitUA;
+    uint32_t nIdleUA = (uint32_t)LED_STRIP_TOTAL_LEDS * LED_IDLE_UA;
+    uint32_t nBudgetUA = (uint32_t)LED_CURRENT_BUDGET_MA * 1000;
+    uint32_t nAvailableUA = nBudgetUA > nIdleUA ? nBudgetUA - nIdleUA : 0;
+    int anSendLeds[LED_STRIPS] = {0};
+    int nSendLeds = 0;
+    int nLed = 0;
+
+    for (nLed = 0; nLed < LED_STRIP_TOTAL_LEDS; nLed++)
+    {
+        rgb_t color = Render_Blend(renderData.aFrom[nLed], renderData.aTo[nLed], nAlpha);
+        uint32_t nRed = renderData.aColorLUT[RGB_GET_R(color)];
+        uint32_t nGreen = renderData.aColorLUT[RGB_GET_G(color)];
+        uint32_t nBlue = renderData.aColorLUT[RGB_GET_B(color)];
+
+        renderData.aFrame[nLed] = color;
+        renderData.aOut[nLed] = rgb(nRed, nGreen, nBlue);
+        nChannelSum += nRed + nGreen + nBlue;
+    }
+    // Microamps drawn by the lit LEDs, and what is left for them
+    nLitUA = (uint64_t)nChannelSum * LED_CHANNEL_UA / 255;
+    if (nLitUA > nAvailableUA)
+    {
+        // Scale in 1/256ths, rounding down so the frame stays under budget
+        uint32_t nScale = (uint32_t)(((uint64_t)nAvailableUA << 8) / nLitUA);
+        nChannelSum = 0;
+        for (nLed = 0; nLed < LED_STRIP_TOTAL_LEDS; nLed++)
+        {
+            rgb_t color = renderData.aOut[nLed];
+            uint32_t nRed = (RGB_GET_R(color) * nScale) >> 8;
+            uint32_t nGreen = (RGB_GET_G(color) * nScale) >> 8;
+            uint32_t nBlue = (RGB_GET_B(color) * nScale) >> 8;
+
+            renderData.aOut[nLed] = rgb(nRed, nGreen, nBlue);
+            nChannelSum += nRed + nGreen + nBlue;
+        }
+        nLitUA = (uint64_t)nChannelSum * LED_CHANNEL_UA / 255;
+        renderData.stats.nFramesLimited++;
+    }
+    if ((nLitUA + nIdleUA) / 1000 > renderData.stats.nPeakMilliamps)
+    {
+        renderData.stats.nPeakMilliamps = (uint32_t)((nLitUA + nIdleUA) / 1000);
+    }
+
+    // Each strip sends up to its last changed LED, found from the end
+    for (int nStrip = 0; nStrip < LED_STRIPS; nStrip++)
+    {
+        const rgb_t *pOut = &renderData.aOut[renderData.anStripFrame[nStrip]];
+        const rgb_t *pShown = &renderData.aShown[renderData.anStripFrame[nStrip]];
+        int nLeds = renderData.anStripLeds[nStrip];
+
+        if (renderData.bShownValid)
+        {
+            while (nLeds > 0 && pOut[nLeds - 1] == pShown[nLeds - 1])
+            {
+                nLeds--;
+            }
+        }
+        anSendLeds[nStrip] = nLeds;
+        nSendLeds += nLeds;
+    }
+    if (nSendLeds == 0)
+    {
+        // Steps of a fade too small to change any LED after gamma
+        renderData.stats.nRefreshSkipped++;
+        return;
+    }
+    memcpy(renderData.aShown, renderData.aOut, sizeof(renderData.aShown));
+    renderData.bShownValid = true;
+    HAL_LED_Blit(renderData.aOut, anSendLeds);
+    Trace_Frame(HAL_Get_Time(), renderData.aOut, LED_STRIP_TOTAL_LEDS);
+    if (!atomic_load_explicit(&renderData.bFirstFrame, memory_order_relaxed))
+    {
+        renderData.tFirstFrame = HAL_Get_Time();
+        atomic_store_explicit(&renderData.bFirstFrame, true, memory_order_release);
+    }
+    renderData.stats.nRefreshSent++;
+    renderData.stats.nPixelsSent += nSendLeds;
+}
+/**
+ * @brief Remember where the digits are and start the render task.
+ * HAL_LED_Initialize must already have been called.
+ *
+ * @param anDigitStrip Strip each digit is on
+ * @param anDigitFirstLed First LED of each digit within its strip
+ * @param anStripLeds Number of LEDs on each strip
+ */
+void Render_Initialize(const int *anDigitStrip, const int *anDigitFirstLed, const int *anStripLeds)
+{
+    int nFrameLed = 0;
+
+    memset(&renderData, 0, sizeof(renderData));
+    for (int nStrip = 0; nStrip < LED_STRIPS; nStrip++)
+    {
+        renderData.anStripFrame[nStrip] = nFrameLed;
+        renderData.anStripLeds[nStrip] = anStripLeds[nStrip];
+        nFrameLed += anStripLeds[nStrip];
+    }
+    for (int nDigit = 0; nDigit < DISPLAY_DIGITS; nDigit++)
+    {
+        renderData.anDigitFrame[nDigit] = renderData.anStripFrame[anDigitStrip[nDigit]] + anDigitFirstLed[nDigit];
+    }
+    renderData.nWriting = 0;
+    atomic_init(&renderData.nPublished, 1);
+    renderData.nReading = 2;
+    renderData.nLUTBrightness = -1;
+    HAL_Render_Initialize(&Render_Service);
+}
+/**
+ * @brief Hand a scene to the render task, which fades to it over tFade.
+ * Only the app task may call this.  The render task always works from the
+ * latest scene, so one published before the last was taken is replaced.
+ *
+ * @param amDigits Segments lit on each of the DISPLAY_DIGITS digits
+ * @param color Color of the lit segments
+ * @param nBrightness Overall brightness (0-255), applied before gamma
+ * @param tFade Microseconds to fade from what is shown, 0 to cut
+ * @param tDue When the clock changed to this scene, 0 when it is not timed
+ */
+void Render_Show(const uint32_t *amDigits, uint32_t color, uint8_t nBrightness, int64_t tFade, int64_t tDue)
+{
+    RENDER_SCENE *pScene = &renderData.aScenes[renderData.nWriting];
+
+    renderData.stats.nScenes++;
+    if (renderData.bSceneValid &&
+        color == renderData.sceneLast.color &&
+        nBrightness == renderData.sceneLast.nBrightness &&
+        memcmp(amDigits, renderData.sceneLast.amDigits, sizeof(renderData.sceneLast.amDigits)) == 0)
+    {
+        renderData.stats.nScenesSkipped++;
+        return;
+    }
+    memcpy(pScene->amDigits, amDigits, sizeof(pScene->amDigits));
+    pScene->color = color;
+    pScene->nBrightness = nBrightness;
+    pScene->tFade = tFade;
+    pScene->tDue = tDue;
+    renderData.sceneLast = *pScene;
+    renderData.bSceneValid = true;
+    renderData.nWriting = atomic_exchange(&renderData.nPublished, renderData.nWriting | RENDER_SLOT_FRESH) & ~RENDER_SLOT_FRESH;
+    HAL_Render_Wake_Service();
+}
+/**
+ * @brief Render task service.  Takes any new scene and composes the next
+ * frame of the fade.  While a fade runs frames are due every
+ * RENDER_FRAME_US from its start, and a slot that passed without a frame
+ * is counted as dropped.
+ *
+ * @param tNow Current time in microseconds
+ * @return int64_t When the next frame is due, HAL_NO_DEADLINE once the fade is done
+ */
+int64_t Render_Service(int64_t tNow)
+{
+    int64_t tStart = HAL_Get_Time();
+    int64_t nSlot;
+    int64_t tNext;
+    int64_t tEnd;
+    uint32_t nAlpha = RENDER_FADE_ALPHA_MAX;
+    uint32_t tRender;
+
+    if (atomic_load(&renderData.nPublished) & RENDER_SLOT_FRESH)
+    {
+        renderData.nReading = atomic_exchange(&renderData.nPublished, renderData.nReading) & ~RENDER_SLOT_FRESH;
+        Render_Start_Scene(&renderData.aScenes[renderData.nReading], tNow);
+    }
+    if (!renderData.bFading)
+    {
+        return HAL_NO_DEADLINE;
+    }
+    nSlot = (tNow - renderData.tFadeStart) / RENDER_FRAME_US;
+    if (nSlot > renderData.nLastSlot + 1)
+    {
+        renderData.stats.nFramesDropped += (uint32_t)(nSlot - renderData.nLastSlot - 1);
+    }
+    renderData.nLastSlot = nSlot;
+    if (tNow - renderData.tFadeStart < renderData.tFadeLength)
+    {
+        nAlpha = (uint32_t)((tNow - renderData.tFadeStart) * RENDER_FADE_ALPHA_MAX / renderData.tFadeLength);
+    }
+    Render_Compose(nAlpha);
+    renderData.stats.nFrames++;
+    tRender = (uint32_t)(HAL_Get_Time() - tStart);
+    renderData.stats.tRenderTotal += tRender;
+    if (tRender > renderData.stats.tRenderMax)
+    {
+        renderData.stats.tRenderMax = tRender;
+    }
+    Histogram_Record(&renderData.stats.histFrame, tRender);
+    // The first frame of a fade is when the change shows
+    if (renderData.tSceneDue != 0)
+    {
+        Histogram_Record(&renderData.stats.histLag, tStart + tRender - renderData.tSceneDue);
+        renderData.tSceneDue = 0;
+    }
+    if (nAlpha >= RENDER_FADE_ALPHA_MAX)
+    {
+        renderData.bFading = false;
+        return HAL_NO_DEADLINE;
+    }
+    // The next slot, or the end of the fade when that is less than half a
+    // frame after it
+    tNext = renderData.tFadeStart + (nSlot + 1) * RENDER_FRAME_US;
+    tEnd = renderData.tFadeStart + renderData.tFadeLength;
+    return tNext + RENDER_FRAME_US / 2 < tEnd ? tNext : tEnd;
+}
+/**
+ * @brief Get when the first frame was clocked out to the strips.  The boot
+ * phases belong to the app task, so it asks rather than being told.
+ *
+ * @param ptAt Where to put the time
+ * @return true The first frame is out
+ * @return false No frame has been sent yet
+ */
+bool Render_Get_First_Frame(int64_t *ptAt)
+{
+    if (!atomic_load_explicit(&renderData.bFirstFrame, memory_order_acquire))
+    {
+        return false;
+    }
+    *ptAt = renderData.tFirstFrame;
+    return true;
+}
+/**
+ * @brief Get the compositor counters
+ *
+ * @return const RENDER_STATS* Counters, updated as the render task runs
+ */
+const RENDER_STATS *Render_Get_Stats(void)
+{
+    return &renderData.stats;
+}
+/**
+ * @brief Report how much work the compositor and LED refreshes have done
+ *
+ */
+void Render_Log_Stats(void)
+{
+    const RENDER_STATS *pStats = &renderData.stats;
+
+    ESP_LOGI(TAG, "%lu scenes, %lu repeated, %lu frames, %lu dropped, %lu us per frame, %lu us max",
+             (unsigned long)pStats->nScenes, (unsigned long)pStats->nScenesSkipped,
+             (unsigned long)pStats->nFrames, (unsigned long)pStats->nFramesDropped,
+             (unsigned long)(pStats->nFrames ? pStats->tRenderTotal / pStats->nFrames : 0),
+             (unsigned long)pStats->tRenderMax);
+    ESP_LOGI(TAG, "%lu refreshes skipped, %lu sent, %llu of %llu pixels sent",
+             (unsigned long)pStats->nRefreshSkipped, (unsigned long)pStats->nRefreshSent,
+             (unsigned long long)pStats->nPixelsSent,
+             (unsigned long long)pStats->nFrames * LED_STRIP_TOTAL_LEDS);
+    ESP_LOGI(TAG, "%lu frames dimmed to %d mA budget, peak %lu mA",
+             (unsigned long)pStats->nFramesLimited, LED_CURRENT_BUDGET_MA,
+             (unsigned long)pStats->nPeakMilliamps);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file render.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Compositor that fades the display between scenes in its own task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _RENDER_H
+#define _RENDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "histogram.h"
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+#define RENDER_FRAME_US (1000000 / 60) // Frame interval while a fade is running
+#define RENDER_FADE_ALPHA_MAX 256      // Fixed point blend weight of a finished fade
+
+  /**
+   * @brief Counters for the compositor and the LED output
+   *
+   */
+  typedef struct
+  {
+    uint32_t nScenes;         // Calls to Render_Show
+    uint32_t nScenesSkipped;  // Scenes identical to the one before
+    uint32_t nFrames;         // Frames composed by the render task
+    uint32_t nFramesDropped;  // Frame slots of a fade that passed without a frame
+    uint32_t nRefreshSkipped; // Frames identical to what the LEDs already show
+    uint32_t nRefreshSent;    // Frames clocked out to the strips
+    uint64_t nPixelsSent;     // LEDs clocked out over all refreshes
+    uint32_t nFramesLimited;  // Frames dimmed to stay within LED_CURRENT_BUDGET_MA
+    uint32_t nPeakMilliamps;  // Highest estimated draw of a frame as sent
+    uint64_t tRenderTotal;    // Microseconds spent composing and queuing frames
+    uint32_t tRenderMax;      // Longest time taken by a single frame
+    HISTOGRAM histFrame;      // Microseconds to compose and queue each frame
+    HISTOGRAM histLag;        // How long after it was due a clock driven scene reached the LEDs
+  } RENDER_STATS;
+
+  extern void Render_Initialize(const int *anDigitStrip, const int *anDigitFirstLed, const int *anStripLeds);
+  extern void Render_Show(const uint32_t *amDigits, uint32_t color, uint8_t nBrightness, int64_t tFade,
+                          int64_t tDue);
+  extern int64_t Render_Service(int64_t tNow);
+  extern bool Render_Get_First_Frame(int64_t *ptAt);
+  extern const RENDER_STATS *Render_Get_Stats(void);
+  extern void Render_Log_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RENDER_H */
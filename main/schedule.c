@@ -0,0 +1,374 @@
+/**
+ * @file schedule.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Event schedules, stored as settings and compiled into a timeline
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "app.h"
+#include "schedule.h"
+
+static const char *TAG = "schedule";
+
+typedef struct
+{
+    SCHEDULE_TABLE table; // Schedules to choose from
+    int nSelected;        // Schedule the timeline was compiled from
+    int nSaved;           // Selection last read from or written to the settings
+    TIMELINE timeline;    // The selected schedule, compiled
+} SCHEDULE_DATA;
+
+static SCHEDULE_DATA scheduleData;
+
+/**
+ * @brief Schedules used when none are stored
+ */
+static const SCHEDULE_TABLE tableBuiltIn = {
+    .nSchedules = 2,
+    .aSchedules = {
+        {
+            .szName = "Codebusters",
+            .nLengthSeconds = 50 * 60,
+            .nEndTrack = TRACK_TIMES_UP,
+            .nScale = 1,
+            .nCues = 6,
+            .aCues = {
+                {0, 0, RGB_GREEN, 0},
+                {10 * 60, TRACK_NO_MORE_TIMED_BONUS, RGB_WHITE, 0},
+                {25 * 60, TRACK_25_MINUTES_REMAIN, 0, SCHEDULE_FROM_END},
+                {10 * 60, TRACK_10_MINUTES_REMAIN, 0, SCHEDULE_FROM_END},
+                {2 * 60, TRACK_2_MINUTES_REMAIN, 0, SCHEDULE_FROM_END},
+                {10, 0, RGB_YELLOW, SCHEDULE_FROM_END | SCHEDULE_TENTHS},
+            },
+        },
+        {
+            // The whole event in 50 seconds, showing seconds as minutes
+            .szName = "Quick test",
+            .nLengthSeconds = 50,
+            .nEndTrack = TRACK_TIMES_UP,
+            .nScale = 60,
+            .nCues = 6,
+            .aCues = {
+                {0, 0, RGB_GREEN, 0},
+                {10, TRACK_NO_MORE_TIMED_BONUS, RGB_WHITE, 0},
+                {15, TRACK_25_MINUTES_REMAIN, 0, 0},
+                {30, TRACK_10_MINUTES_REMAIN, 0, 0},
+                {38, TRACK_2_MINUTES_REMAIN, 0, 0},
+                {40, 0, RGB_YELLOW, SCHEDULE_TENTHS},
+            },
+        },
+    },
+};
+
+/**
+ * @brief Resolve the cues of a schedule to elapsed times and sort them
+ * into a timeline ending with the end of the event.  A cue without a color
+ * keeps the color of the cue before it.
+ *
+ * @param pDef Schedule to compile
+ * @param pTimeline Where to put the timeline
+ * @return true Compiled
+ * @return false The schedule is not valid, pTimeline is unchanged
+ */
+bool Schedule_Compile(const SCHEDULE_DEF *pDef, TIMELINE *pTimeline)
+{
+    TIMELINE timeline = {
+        .pszName = pDef->szName,
+        .nLengthSeconds = pDef->nLengthSeconds,
+        .nScale = pDef->nScale,
+    };
+    rgb_t color = RGB_WHITE;
+
+    if (pDef->nLengthSeconds == 0 || pDef->nScale == 0 || pDef->nCues > SCHEDULE_MAX_CUES ||
+        memchr(pDef->szName, '\0', sizeof(pDef->szName)) == NULL)
+    {
+        return false;
+    }
+    for (int nCue = 0; nCue < pDef->nCues; nCue++)
+    {
+        const SCHEDULE_CUE *pCue = &pDef->aCues[nCue];
+        TIMELINE_ENTRY entry = {
+            .nTenths = pCue->nSeconds * 10,
+            .nTrack = pCue->nTrack,
+            .color = pCue->color,
+            .nFlags = pCue->nFlags & SCHEDULE_TENTHS,
+        };
+        int nEntry = timeline.nEntries;
+
+        if (pCue->nSeconds > pDef->nLengthSeconds)
+        {
+            return false;
+        }
+        if (pCue->nFlags & SCHEDULE_FROM_END)
+        {
+            entry.nTenths = (pDef->nLengthSeconds - pCue->nSeconds) * 10;
+        }
+        // Insert in time order, after any cue at the same time
+        while (nEntry > 0 && timeline.aEntries[nEntry - 1].nTenths > entry.nTenths)
+        {
+            timeline.aEntries[nEntry] = timeline.aEntries[nEntry - 1];
+            nEntry--;
+        }
+        timeline.aEntries[nEntry] = entry;
+        timeline.nEntries++;
+    }
+    timeline.aEntries[timeline.nEntries++] = (TIMELINE_ENTRY){
+        .nTenths = pDef->nLengthSeconds * 10,
+        .nTrack = pDef->nEndTrack,
+        .nFlags = SCHEDULE_END,
+    };
+    // Colors and the tenths display carry on until a cue changes them
+    for (int nEntry = 0; nEntry < timeline.nEntries; nEntry++)
+    {
+        TIMELINE_ENTRY *pEntry = &timeline.aEntries[nEntry];
+        if (pEntry->color == RGB_BLACK)
+        {
+            pEntry->color = color;
+        }
+        color = pEntry->color;
+        if (nEntry > 0)
+        {
+            pEntry->nFlags |= timeline.aEntries[nEntry - 1].nFlags & SCHEDULE_TENTHS;
+        }
+    }
+    *pTimeline = timeline;
+    return true;
+}
+/**
+ * @brief Put a little endian value into the blob
+ *
+ * @param pBlob Where it goes
+ * @param nValue Value
+ * @param nBytes Bytes of it to store
+ * @return uint8_t* Just past it
+ */
+static uint8_t *Schedule_Put(uint8_t *pBlob, uint32_t nValue, int nBytes)
+{
+    for (int n = 0; n < nBytes; n++)
+    {
+        *pBlob++ = (uint8_t)(nValue >> (8 * n));
+    }
+    return pBlob;
+}
+/**
+ * @brief Take a little endian value out of the blob
+ *
+ * @param ppBlob Where it is, moved past it
+ * @param nBytes Bytes of it stored
+ * @return uint32_t Value
+ */
+static uint32_t Schedule_Get(const uint8_t **ppBlob, int nBytes)
+{
+    uint32_t nValue = 0;
+
+    for (int n = 0; n < nBytes; n++)
+    {
+        nValue |= (uint32_t)*(*ppBlob)++ << (8 * n);
+    }
+    return nValue;
+}
+/**
+ * @brief Turn schedules into the stored blob (see SCHEDULE_BLOB_HEADER)
+ *
+ * @param pTable Schedules
+ * @param pBlob Where to put the SCHEDULE_BLOB_SIZE bytes
+ */
+void Schedule_Encode(const SCHEDULE_TABLE *pTable, uint8_t *pBlob)
+{
+    uint8_t *pPut = pBlob;
+
+    memset(pBlob, 0, SCHEDULE_BLOB_SIZE);
+    pPut = Schedule_Put(pPut, SCHEDULE_VERSION, 2);
+    pPut = Schedule_Put(pPut, SCHEDULE_BLOB_SIZE, 2);
+    Schedule_Put(pPut, pTable->nSchedules, 1);
+    for (int nSchedule = 0; nSchedule < pTable->nSchedules && nSchedule < SCHEDULE_MAX; nSchedule++)
+    {
+        const SCHEDULE_DEF *pDef = &pTable->aSchedules[nSchedule];
+
+        pPut = pBlob + SCHEDULE_BLOB_HEADER + nSchedule * SCHEDULE_BLOB_DEF;
+        memcpy(pPut, pDef->szName, SCHEDULE_NAME_LENGTH);
+        pPut = Schedule_Put(pPut + SCHEDULE_NAME_LENGTH, pDef->nLengthSeconds, 2);
+        pPut = Schedule_Put(pPut, pDef->nEndTrack, 2);
+        pPut = Schedule_Put(pPut, pDef->nScale, 1);
+        pPut = Schedule_Put(pPut, pDef->nCues, 1);
+        for (int nCue = 0; nCue < pDef->nCues && nCue < SCHEDULE_MAX_CUES; nCue++)
+        {
+            const SCHEDULE_CUE *pCue = &pDef->aCues[nCue];
+
+            pPut = Schedule_Put(pPut, pCue->nSeconds, 2);
+            pPut = Schedule_Put(pPut, pCue->nTrack, 2);
+            pPut = Schedule_Put(pPut, pCue->color, 4);
+            pPut = Schedule_Put(pPut, pCue->nFlags, 1);
+        }
+    }
+}
+/**
+ * @brief Read schedules back from the stored blob.  Each schedule is only
+ * checked for what could overrun the table here, Schedule_Compile checks
+ * the rest when it is selected.
+ *
+ * @param pBlob SCHEDULE_BLOB_SIZE bytes as stored
+ * @param pTable Where to put the schedules
+ * @return true Read
+ * @return false Another version or size, or more schedules or cues than fit
+ */
+bool Schedule_Decode(const uint8_t *pBlob, SCHEDULE_TABLE *pTable)
+{
+    const uint8_t *pGet = pBlob;
+    SCHEDULE_TABLE table;
+
+    memset(&table, 0, sizeof(table));
+    if (Schedule_Get(&pGet, 2) != SCHEDULE_VERSION || Schedule_Get(&pGet, 2) != SCHEDULE_BLOB_SIZE)
+    {
+        return false;
+    }
+    table.nSchedules = (uint16_t)Schedule_Get(&pGet, 1);
+    if (table.nSchedules == 0 || table.nSchedules > SCHEDULE_MAX)
+    {
+        return false;
+    }
+    for (int nSchedule = 0; nSchedule < table.nSchedules; nSchedule++)
+    {
+        SCHEDULE_DEF *pDef = &table.aSchedules[nSchedule];
+
+        pGet = pBlob + SCHEDULE_BLOB_HEADER + nSchedule * SCHEDULE_BLOB_DEF;
+        memcpy(pDef->szName, pGet, SCHEDULE_NAME_LENGTH);
+        pGet += SCHEDULE_NAME_LENGTH;
+        pDef->nLengthSeconds = (uint16_t)Schedule_Get(&pGet, 2);
+        pDef->nEndTrack = (uint16_t)Schedule_Get(&pGet, 2);
+        pDef->nScale = (uint8_t)Schedule_Get(&pGet, 1);
+        pDef->nCues = (uint8_t)Schedule_Get(&pGet, 1);
+        if (pDef->nCues > SCHEDULE_MAX_CUES)
+        {
+            return false;
+        }
+        for (int nCue = 0; nCue < pDef->nCues; nCue++)
+        {
+            SCHEDULE_CUE *pCue = &pDef->aCues[nCue];
+
+            pCue->nSeconds = (uint16_t)Schedule_Get(&pGet, 2);
+            pCue->nTrack = (uint16_t)Schedule_Get(&pGet, 2);
+            pCue->color = Schedule_Get(&pGet, 4);
+            pCue->nFlags = (uint8_t)Schedule_Get(&pGet, 1);
+        }
+    }
+    *pTable = table;
+    return true;
+}
+/**
+ * @brief Load the stored schedules and the selection, falling back to the
+ * built in schedules when none are stored or they are from another version
+ *
+ */
+void Schedule_Initialize(void)
+{
+    uint8_t aBlob[SCHEDULE_BLOB_SIZE];
+    uint8_t nSelected = 0;
+
+    scheduleData.table = tableBuiltIn;
+    if (HAL_Settings_Load(SCHEDULE_KEY, aBlob, sizeof(aBlob)) && !Schedule_Decode(aBlob, &scheduleData.table))
+    {
+        ESP_LOGW(TAG, "Stored schedules are not version %d, using the built in ones", SCHEDULE_VERSION);
+    }
+    if (!HAL_Settings_Load(SCHEDULE_SELECT_KEY, &nSelected, sizeof(nSelected)))
+    {
+        nSelected = 0;
+    }
+    scheduleData.nSaved = nSelected;
+    if (!Schedule_Select(nSelected) && !Schedule_Select(0))
+    {
+        ESP_LOGE(TAG, "No usable schedule, using the built in one");
+        scheduleData.table = tableBuiltIn;
+        Schedule_Select(0);
+    }
+}
+/**
+ * @brief Get how many schedules there are to choose from
+ *
+ * @return int Number of schedules
+ */
+int Schedule_Count(void)
+{
+    return scheduleData.table.nSchedules;
+}
+/**
+ * @brief Get the schedule in use
+ *
+ * @return int Schedule number, from 0
+ */
+int Schedule_Selected(void)
+{
+    return scheduleData.nSelected;
+}
+/**
+ * @brief Compile a schedule to use for the next event
+ *
+ * @param nSchedule Schedule number, from 0
+ * @return true Selected
+ * @return false No such schedule or it is not valid, the selection is unchanged
+ */
+bool Schedule_Select(int nSchedule)
+{
+    if (nSchedule < 0 || nSchedule >= scheduleData.table.nSchedules)
+    {
+        return false;
+    }
+    if (!Schedule_Compile(&scheduleData.table.aSchedules[nSchedule], &scheduleData.timeline))
+    {
+        ESP_LOGW(TAG, "Schedule %d is not valid", nSchedule);
+        return false;
+    }
+    scheduleData.nSelected = nSchedule;
+    ESP_LOGI(TAG, "Schedule %d: %s, %ld seconds, %d cues", nSchedule, scheduleData.timeline.pszName,
+             (long)scheduleData.timeline.nLengthSeconds, scheduleData.timeline.nEntries - 1);
+    return true;
+}
+/**
+ * @brief Store the selection so it is used after a reboot.  Nothing is
+ * written when it has not changed.
+ *
+ */
+void Schedule_Save_Selection(void)
+{
+    uint8_t nSelected = (uint8_t)scheduleData.nSelected;
+
+    if (scheduleData.nSelected != scheduleData.nSaved &&
+        HAL_Settings_Save(SCHEDULE_SELECT_KEY, &nSelected, sizeof(nSelected)))
+    {
+        scheduleData.nSaved = scheduleData.nSelected;
+    }
+}
+/**
+ * @brief Get the compiled timeline of the selected schedule
+ *
+ * @return const TIMELINE* Timeline, valid until the next Schedule_Select
+ */
+const TIMELINE *Schedule_Timeline(void)
+{
+    return &scheduleData.timeline;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file schedule.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Event schedules, stored as settings and compiled into a timeline
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SCHEDULE_H
+#define _SCHEDULE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+#define SCHEDULE_MAX 4              // Schedules that can be stored
+#define SCHEDULE_MAX_CUES 8         // Cues in one schedule
+#define SCHEDULE_NAME_LENGTH 16     // Room for a schedule name, including the terminator
+#define SCHEDULE_VERSION 2          // Layout of the stored schedules blob
+#define SCHEDULE_KEY "schedules"    // Setting holding the schedules blob
+#define SCHEDULE_SELECT_KEY "sched" // Setting holding the selected schedule number
+
+/**
+ * @brief Cue flags
+ */
+#define SCHEDULE_FROM_END 0x01 // nSeconds counts back from the end of the event
+#define SCHEDULE_TENTHS 0x02   // Show seconds and tenths from this cue on
+#define SCHEDULE_END 0x80      // End of the event, only set by Schedule_Compile
+
+/**
+ * @brief Stored schedules blob, little endian and without padding:
+ * u16 version, u16 size of the blob, u8 schedules, 3 bytes of zero, then
+ * SCHEDULE_MAX schedules of char name[SCHEDULE_NAME_LENGTH], u16 length,
+ * u16 end track, u8 scale, u8 cues and SCHEDULE_MAX_CUES cues of u16
+ * seconds, u16 track, u32 color and u8 flags.  Unused entries are zero.
+ */
+#define SCHEDULE_BLOB_HEADER 8                                                               // Bytes before the first schedule
+#define SCHEDULE_BLOB_CUE 9                                                                  // Bytes of a stored cue
+#define SCHEDULE_BLOB_DEF (SCHEDULE_NAME_LENGTH + 6 + SCHEDULE_MAX_CUES * SCHEDULE_BLOB_CUE) // Bytes of a stored schedule
+#define SCHEDULE_BLOB_SIZE (SCHEDULE_BLOB_HEADER + SCHEDULE_MAX * SCHEDULE_BLOB_DEF)         // Bytes of the whole blob
+
+  /**
+   * @brief Something that happens at a point in the event
+   *
+   */
+  typedef struct
+  {
+    uint16_t nSeconds; // When, in seconds from the start (or to the end with SCHEDULE_FROM_END)
+    uint16_t nTrack;   // Track to play, 0 for none
+    uint32_t color;    // Color of the display from here on, 0 to keep the color
+    uint8_t nFlags;    // SCHEDULE_FROM_END, SCHEDULE_TENTHS
+  } SCHEDULE_CUE;
+
+  /**
+   * @brief An event format as it is stored
+   *
+   */
+  typedef struct
+  {
+    char szName[SCHEDULE_NAME_LENGTH];     // Shown in the log when it is selected
+    uint16_t nLengthSeconds;               // Length of the event
+    uint16_t nEndTrack;                    // Track played at the end, 0 for none
+    uint8_t nScale;                        // Minutes shown per real minute, 1 except for testing
+    uint8_t nCues;                         // Cues used in aCues
+    SCHEDULE_CUE aCues[SCHEDULE_MAX_CUES]; // Cues in any order
+  } SCHEDULE_DEF;
+
+  /**
+   * @brief Every schedule to choose from, stored as a single blob
+   *
+   */
+  typedef struct
+  {
+    uint16_t nSchedules;                   // Schedules used in aSchedules
+    SCHEDULE_DEF aSchedules[SCHEDULE_MAX]; // The schedules
+  } SCHEDULE_TABLE;
+
+  /**
+   * @brief A cue resolved to the elapsed time it happens at
+   *
+   */
+  typedef struct
+  {
+    int32_t nTenths; // Elapsed tenths of a second since the start
+    uint16_t nTrack; // Track to play, 0 for none
+    uint32_t color;  // Color of the display from here on
+    uint8_t nFlags;  // SCHEDULE_TENTHS, SCHEDULE_END
+  } TIMELINE_ENTRY;
+
+  /**
+   * @brief A schedule compiled for the main loop to walk with a cursor.
+   * The entries are in time order and the last one is the end.
+   *
+   */
+  typedef struct
+  {
+    const char *pszName;                            // Name of the schedule
+    int32_t nLengthSeconds;                         // Length of the event
+    int nScale;                                     // Minutes shown per real minute
+    int nEntries;                                   // Entries used in aEntries
+    TIMELINE_ENTRY aEntries[SCHEDULE_MAX_CUES + 1]; // The cues, then the end
+  } TIMELINE;
+
+  extern bool Schedule_Compile(const SCHEDULE_DEF *pDef, TIMELINE *pTimeline);
+  extern void Schedule_Encode(const SCHEDULE_TABLE *pTable, uint8_t *pBlob);
+  extern bool Schedule_Decode(const uint8_t *pBlob, SCHEDULE_TABLE *pTable);
+  extern void Schedule_Initialize(void);
+  extern int Schedule_Count(void);
+  extern int Schedule_Selected(void);
+  extern bool Schedule_Select(int nSchedule);
+  extern void Schedule_Save_Selection(void);
+  extern const TIMELINE *Schedule_Timeline(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SCHEDULE_H */
@@ -0,0 +1,580 @@
+/**
+ * @file sync.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Leader/follower clock sync between timers
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "app.h"
+#include "sync.h"
+
+static const char *TAG = "sync";
+
+/**
+ * @brief One time exchange between a follower and the leader
+ *
+ */
+typedef struct
+{
+    int64_t tAt;     // Our time the reply arrived
+    int64_t tOffset; // Leader's clock less ours
+    int32_t tDelay;  // Round trip, less the time the leader held the request
+} SYNC_SAMPLE;
+
+typedef struct
+{
+    SYNC_CONFIG config;                        // Role and link
+    const HAL_TRANSPORT *pTransport;           // Link to the other timers
+    EVENT_RING ringAnnounce;                   // Event changes from the app task, for a leader
+    EVENT_RING ringEvents;                     // The leader's event for the app task, for a follower
+    bool bEventKnown;                          // The event fields below are set
+    uint8_t nState;                            // APP_STATES of the leader
+    uint8_t nSchedule;                         // Schedule the leader runs
+    uint32_t nGeneration;                      // Changes with every change of the leader's event
+    int64_t tStart;                            // Leader's time its event started
+    bool bAwaiting;                            // A request is out
+    int64_t tOrigin;                           // Our time the outstanding request was sent
+    int64_t tNextRequest;                      // When to send the next request
+    int64_t tLastReply;                        // When the leader last answered
+    bool bTransmitKnown;                       // tLastTransmit is set
+    int64_t tLastTransmit;                     // Leader's time it sent the last packet we took
+    bool bLost;                                // The leader has been reported lost
+    SYNC_SAMPLE aSamples[SYNC_SAMPLES];        // The last exchanges
+    int nSamples;                              // Exchanges in aSamples
+    int nNextSample;                           // Slot the next exchange goes in
+    bool bLocked;                              // stats.tOffset holds an estimate
+    int64_t tRef;                              // Our time stats.tOffset was estimated for
+    bool bSkewPeriod;                          // skewBest holds the best exchange of the current period
+    SYNC_SAMPLE skewBest;                      // Best exchange since the period started at its tAt
+    int64_t tSkewPeriod;                       // Our time the current period started
+    SYNC_SAMPLE aSkewPoints[SYNC_SKEW_POINTS]; // Best exchange of each past period
+    int nSkewPoints;                           // Points in aSkewPoints
+    int nNextSkewPoint;                        // Slot the next point goes in
+    bool bSkewKnown;                           // stats.nSkewPPB has been measured
+    bool bPosted;                              // The app has been told of the leader's event
+    uint32_t nPostedGeneration;                // Generation the app was last told of
+    int64_t tPostedStart;                      // Start the app was last told of, in our time
+    SYNC_STATS stats;                          // Counters
+} SYNC_DATA;
+
+static SYNC_DATA syncData;
+
+/**
+ * @brief Get the leader's clock less ours at one of our times
+ *
+ * @param tLocal Our time
+ * @return int64_t Offset in microseconds
+ */
+static int64_t Sync_Offset_At(int64_t tLocal)
+{
+    return syncData.stats.tOffset + (tLocal - syncData.tRef) * syncData.stats.nSkewPPB / 1000000000;
+}
+/**
+ * @brief Broadcast a packet carrying the event of this timer
+ *
+ * @param eMsg Kind of packet
+ * @param tOrigin Follower's time of the request being answered, or 0
+ * @param tReceive Our time the request being answered arrived, or 0
+ */
+static void Sync_Send(SYNC_MSG eMsg, int64_t tOrigin, int64_t tReceive)
+{
+    SYNC_PACKET packet;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.nMagic = SYNC_MAGIC;
+    packet.nVersion = SYNC_VERSION;
+    packet.eMsg = eMsg;
+    packet.nState = syncData.nState;
+    packet.nSchedule = syncData.nSchedule;
+    packet.nGeneration = syncData.nGeneration;
+    packet.tStart = syncData.tStart;
+    packet.tOrigin = tOrigin;
+    packet.tReceive = tReceive;
+    // Stamped as late as possible, the time to send it counts as the link's
+    packet.tTransmit = HAL_Get_Time();
+    syncData.pTransport->pfnSend(&packet, sizeof(packet));
+}
+/**
+ * @brief Fit the drift to the points by least squares.  One exchange has
+ * a millisecond or so of noise, so only a line through minutes of them
+ * gives the drift to a few ppm.  Times are taken in milliseconds from the
+ * newest point so the sums stay well inside 64 bits.
+ *
+ */
+static void Sync_Fit_Skew(void)
+{
+    const SYNC_SAMPLE *pNewest = &syncData.aSkewPoints[(syncData.nNextSkewPoint + SYNC_SKEW_POINTS - 1) %
+                                                       SYNC_SKEW_POINTS];
+    int64_t nSumX = 0;
+    int64_t nSumY = 0;
+    int64_t nSumXX = 0;
+    int64_t nSumXY = 0;
+    int64_t nSkew;
+
+    for (int n = 0; n < syncData.nSkewPoints; n++)
+    {
+        nSumX += (syncData.aSkewPoints[n].tAt - pNewest->tAt) / 1000;
+        nSumY += syncData.aSkewPoints[n].tOffset - pNewest->tOffset;
+    }
+    for (int n = 0; n < syncData.nSkewPoints; n++)
+    {
+        int64_t nX = (syncData.aSkewPoints[n].tAt - pNewest->tAt) / 1000 - nSumX / syncData.nSkewPoints;
+        int64_t nY = syncData.aSkewPoints[n].tOffset - pNewest->tOffset - nSumY / syncData.nSkewPoints;
+
+        nSumXX += nX * nX;
+        nSumXY += nX * nY;
+    }
+    if (nSumXX == 0)
+    {
+        return;
+    }
+    // Microseconds of offset per millisecond is a millionth per unit, a billionth after 10^6
+    nSkew = nSumXY * 1000000 / nSumXX;
+    if (nSkew > SYNC_SKEW_MAX_PPB)
+    {
+        nSkew = SYNC_SKEW_MAX_PPB;
+    }
+    else if (nSkew < -SYNC_SKEW_MAX_PPB)
+    {
+        nSkew = -SYNC_SKEW_MAX_PPB;
+    }
+    syncData.stats.nSkewPPB = (int32_t)nSkew;
+    syncData.bSkewKnown = true;
+}
+/**
+ * @brief Keep the best exchange of each SYNC_SKEW_INTERVAL_US period as a
+ * point of the drift fit, refitting as each period ends
+ *
+ * @param pSample Exchange just made
+ */
+static void Sync_Add_Skew_Sample(const SYNC_SAMPLE *pSample)
+{
+    if (syncData.bSkewPeriod && pSample->tAt - syncData.tSkewPeriod >= SYNC_SKEW_INTERVAL_US)
+    {
+        syncData.aSkewPoints[syncData.nNextSkewPoint] = syncData.skewBest;
+        syncData.nNextSkewPoint = (syncData.nNextSkewPoint + 1) % SYNC_SKEW_POINTS;
+        if (syncData.nSkewPoints < SYNC_SKEW_POINTS)
+        {
+            syncData.nSkewPoints++;
+        }
+        if (syncData.nSkewPoints >= SYNC_SKEW_MIN_POINTS)
+        {
+            Sync_Fit_Skew();
+        }
+        syncData.bSkewPeriod = false;
+    }
+    if (!syncData.bSkewPeriod)
+    {
+        syncData.bSkewPeriod = true;
+        syncData.tSkewPeriod = pSample->tAt;
+        syncData.skewBest = *pSample;
+    }
+    else if (pSample->tDelay < syncData.skewBest.tDelay)
+    {
+        syncData.skewBest = *pSample;
+    }
+}
+/**
+ * @brief Refilter the offset after an exchange.  The exchange with the
+ * shortest round trip in the window has the least room for one way of the
+ * link to have been slower than the other, so its offset is the one used,
+ * brought forward at the measured drift.  Until the drift is known only the
+ * newest exchanges are used, so the unknown drift has little time to add up.
+ *
+ * @param tNow Current time
+ */
+static void Sync_Update_Estimate(int64_t tNow)
+{
+    int nWindow = syncData.bSkewKnown || syncData.nSamples < SYNC_EARLY_SAMPLES ? syncData.nSamples
+                                                                               : SYNC_EARLY_SAMPLES;
+    const SYNC_SAMPLE *pBest = NULL;
+
+    for (int n = 1; n <= nWindow; n++)
+    {
+        const SYNC_SAMPLE *pSample = &syncData.aSamples[(syncData.nNextSample + SYNC_SAMPLES - n) % SYNC_SAMPLES];
+        if (pBest == NULL || pSample->tDelay < pBest->tDelay)
+        {
+            pBest = pSample;
+        }
+    }
+    syncData.stats.tOffset = pBest->tOffset + (tNow - pBest->tAt) * syncData.stats.nSkewPPB / 1000000000;
+    syncData.stats.tBestDelay = pBest->tDelay;
+    syncData.tRef = tNow;
+    syncData.bLocked = true;
+}
+/**
+ * @brief Start the estimate over after the leader's clock jumped, as it
+ * does when the leader reboots.  The samples, the drift and the event were
+ * all on its old clock.  The drift is measured again rather than kept, as
+ * it may be another timer leading now.
+ *
+ */
+static void Sync_Restart_Estimate(void)
+{
+    ESP_LOGW(TAG, "Leader's clock jumped, starting the estimate over");
+    syncData.stats.nJumps++;
+    syncData.nSamples = 0;
+    syncData.nNextSample = 0;
+    syncData.bLocked = false;
+    syncData.bSkewPeriod = false;
+    syncData.nSkewPoints = 0;
+    syncData.nNextSkewPoint = 0;
+    syncData.bSkewKnown = false;
+    syncData.stats.nSkewPPB = 0;
+    syncData.bEventKnown = false;
+}
+/**
+ * @brief Take the leader's event from a reply or an announcement
+ *
+ * @param pPacket Packet from the leader
+ */
+static void Sync_Take_Event(const SYNC_PACKET *pPacket)
+{
+    if (!syncData.bEventKnown || pPacket->nGeneration != syncData.nGeneration)
+    {
+        syncData.bEventKnown = true;
+        syncData.nState = pPacket->nState;
+        syncData.nSchedule = pPacket->nSchedule;
+        syncData.nGeneration = pPacket->nGeneration;
+        syncData.tStart = pPacket->tStart;
+        syncData.stats.nAnnounces++;
+    }
+}
+/**
+ * @brief Act on a packet from another timer
+ *
+ * @param pPacket Packet received
+ * @param tAt Our time it arrived
+ */
+static void Sync_Handle_Packet(const SYNC_PACKET *pPacket, int64_t tAt)
+{
+    if (syncData.config.nRole == SYNC_ROLE_LEADER)
+    {
+        if (pPacket->eMsg == SYNC_MSG_REQUEST)
+        {
+            syncData.stats.nReplies++;
+            Sync_Send(SYNC_MSG_REPLY, pPacket->tOrigin, tAt);
+        }
+        return;
+    }
+    // Packets can pass each other on the link, only a big step back is a reboot
+    if (syncData.bTransmitKnown && pPacket->tTransmit < syncData.tLastTransmit - SYNC_JUMP_US)
+    {
+        Sync_Restart_Estimate();
+    }
+    syncData.bTransmitKnown = true;
+    syncData.tLastTransmit = pPacket->tTransmit;
+    if (pPacket->eMsg == SYNC_MSG_REPLY)
+    {
+        // Replies are broadcast, only the one to our last request is a sample
+        if (!syncData.bAwaiting || pPacket->tOrigin != syncData.tOrigin)
+        {
+            syncData.stats.nStale++;
+            return;
+        }
+        int64_t tDelay = (tAt - pPacket->tOrigin) - (pPacket->tTransmit - pPacket->tReceive);
+        syncData.bAwaiting = false;
+        syncData.tLastReply = tAt;
+        if (syncData.bLost)
+        {
+            syncData.bLost = false;
+            ESP_LOGI(TAG, "Leader is back");
+        }
+        Sync_Take_Event(pPacket);
+        if (tDelay < 0 || tDelay > SYNC_MAX_DELAY_US)
+        {
+            syncData.stats.nSlow++;
+            return;
+        }
+        syncData.stats.nReplies++;
+        int64_t tOffset = ((pPacket->tReceive - pPacket->tOrigin) + (pPacket->tTransmit - tAt)) / 2;
+        // A clock that moved forward is only seen here, in an offset far from the estimate
+        if (syncData.bLocked && llabs(tOffset - Sync_Offset_At(tAt)) > SYNC_JUMP_US)
+        {
+            Sync_Restart_Estimate();
+            Sync_Take_Event(pPacket);
+        }
+        SYNC_SAMPLE *pSample = &syncData.aSamples[syncData.nNextSample];
+        pSample->tAt = tAt;
+        pSample->tOffset = tOffset;
+        pSample->tDelay = (int32_t)tDelay;
+        syncData.nNextSample = (syncData.nNextSample + 1) % SYNC_SAMPLES;
+        Sync_Add_Skew_Sample(pSample);
+        if (syncData.nSamples < SYNC_SAMPLES)
+        {
+            syncData.nSamples++;
+        }
+        Sync_Update_Estimate(tAt);
+    }
+    else if (pPacket->eMsg == SYNC_MSG_ANNOUNCE)
+    {
+        Sync_Take_Event(pPacket);
+    }
+}
+/**
+ * @brief Tell the app where the leader's event started in our time.  As the
+ * clocks drift that moves, and it is passed on again once it has moved by
+ * SYNC_ADJUST_US.
+ *
+ * @param tNow Current time
+ */
+static void Sync_Post(int64_t tNow)
+{
+    // The first estimates, from a few exchanges, can be some milliseconds out
+    if (!syncData.bLocked || syncData.nSamples < SYNC_SAMPLES || !syncData.bEventKnown)
+    {
+        return;
+    }
+    int64_t tStart = syncData.tStart - Sync_Offset_At(tNow);
+    if (syncData.bPosted && syncData.nGeneration == syncData.nPostedGeneration &&
+        llabs(tStart - syncData.tPostedStart) < SYNC_ADJUST_US)
+    {
+        return;
+    }
+    EVENT event = {
+        .eType = EVENT_SYNC_LEADER,
+        .tTime = tStart,
+        .nParam = SYNC_PACK(syncData.nState, syncData.nSchedule),
+    };
+    if (Event_Ring_Push(&syncData.ringEvents, &event))
+    {
+        syncData.bPosted = true;
+        syncData.nPostedGeneration = syncData.nGeneration;
+        syncData.tPostedStart = tStart;
+        syncData.stats.nAdjusts++;
+        HAL_Wake_App();
+    }
+}
+/**
+ * @brief Run the sync.  Called by the sync task whenever a packet arrives,
+ * the app announces a change, or the returned deadline passes.  A leader
+ * answers requests and broadcasts changes of its event.  A follower asks
+ * for the time every SYNC_INTERVAL_US and keeps the app running the
+ * leader's event on the leader's clock.
+ *
+ * @param tNow Current time in microseconds
+ * @return int64_t When to run again if nothing else happens
+ */
+int64_t Sync_Service(int64_t tNow)
+{
+    uint8_t aPacket[HAL_SYNC_PACKET_MAX];
+    size_t nLength;
+    int64_t tAt;
+    EVENT event;
+
+    while ((nLength = syncData.pTransport->pfnReceive(aPacket, sizeof(aPacket), &tAt)) > 0)
+    {
+        const SYNC_PACKET *pPacket = (const SYNC_PACKET *)aPacket;
+
+        if (nLength != sizeof(SYNC_PACKET) || pPacket->nMagic != SYNC_MAGIC || pPacket->nVersion != SYNC_VERSION)
+        {
+            syncData.stats.nBad++;
+            continue;
+        }
+        Sync_Handle_Packet(pPacket, tAt);
+    }
+    while (Event_Ring_Pop(&syncData.ringAnnounce, &event))
+    {
+        if (!syncData.bEventKnown || event.tTime != syncData.tStart ||
+            event.nParam != SYNC_PACK(syncData.nState, syncData.nSchedule))
+        {
+            syncData.bEventKnown = true;
+            syncData.nState = SYNC_STATE(event.nParam);
+            syncData.nSchedule = SYNC_SCHEDULE(event.nParam);
+            syncData.tStart = event.tTime;
+            syncData.nGeneration++;
+            syncData.stats.nAnnounces++;
+            Sync_Send(SYNC_MSG_ANNOUNCE, 0, 0);
+        }
+    }
+    if (syncData.config.nRole != SYNC_ROLE_FOLLOWER)
+    {
+        return HAL_NO_DEADLINE;
+    }
+    if (tNow >= syncData.tNextRequest)
+    {
+        // Ask quickly until the window is full, so the first estimate is a good one
+        syncData.tNextRequest = tNow + (syncData.nSamples < SYNC_SAMPLES ? SYNC_FAST_INTERVAL_US : SYNC_INTERVAL_US);
+        syncData.bAwaiting = true;
+        syncData.tOrigin = tNow;
+        syncData.stats.nRequests++;
+        Sync_Send(SYNC_MSG_REQUEST, tNow, 0);
+    }
+    if (syncData.bLocked && !syncData.bLost && tNow - syncData.tLastReply > SYNC_LOST_US)
+    {
+        // Carry on at the measured drift until it answers again
+        syncData.bLost = true;
+        ESP_LOGW(TAG, "Lost the leader");
+    }
+    Sync_Post(tNow);
+    return syncData.tNextRequest;
+}
+/**
+ * @brief Read the sync setting and start the sync task over the link it names
+ *
+ * @return true This timer leads or follows
+ * @return false It runs on its own
+ */
+bool Sync_Initialize(void)
+{
+    memset(&syncData, 0, sizeof(syncData));
+    if (!HAL_Settings_Load(SYNC_KEY, &syncData.config, sizeof(syncData.config)) ||
+        syncData.config.nRole == SYNC_ROLE_NONE)
+    {
+        syncData.config.nRole = SYNC_ROLE_NONE;
+        return false;
+    }
+    syncData.pTransport = HAL_Sync_Transport((HAL_LINK)syncData.config.nLink);
+    if (syncData.pTransport == NULL || !syncData.pTransport->pfnOpen())
+    {
+        ESP_LOGE(TAG, "Link %d is not available, running on our own", syncData.config.nLink);
+        syncData.config.nRole = SYNC_ROLE_NONE;
+        return false;
+    }
+    ESP_LOGI(TAG, "%s over %s", syncData.config.nRole == SYNC_ROLE_LEADER ? "Leader" : "Follower",
+             syncData.pTransport->pszName);
+    syncData.tNextRequest = HAL_Get_Time();
+    HAL_Sync_Initialize(&Sync_Service);
+    return true;
+}
+/**
+ * @brief Get the part this timer plays
+ *
+ * @return SYNC_ROLE Role read from the settings
+ */
+SYNC_ROLE Sync_Role(void)
+{
+    return (SYNC_ROLE)syncData.config.nRole;
+}
+/**
+ * @brief Step the stored sync setting to the next role and link this build
+ * has: on its own, then leading and following over each link in turn.  The
+ * link in use cannot be closed, so the new setting is used from the next boot.
+ *
+ */
+void Sync_Step_Config(void)
+{
+    SYNC_CONFIG config;
+
+    if (!HAL_Settings_Load(SYNC_KEY, &config, sizeof(config)) || config.nRole == SYNC_ROLE_NONE)
+    {
+        config.nRole = SYNC_ROLE_NONE;
+        config.nLink = HAL_LINK_NONE;
+    }
+    do
+    {
+        if (config.nRole == SYNC_ROLE_LEADER)
+        {
+            config.nRole = SYNC_ROLE_FOLLOWER;
+        }
+        else if (config.nLink < HAL_LINK_SIMULATED)
+        {
+            config.nRole = SYNC_ROLE_LEADER;
+            config.nLink++;
+        }
+        else
+        {
+            config.nRole = SYNC_ROLE_NONE;
+            config.nLink = HAL_LINK_NONE;
+        }
+    } while (config.nRole != SYNC_ROLE_NONE && HAL_Sync_Transport((HAL_LINK)config.nLink) == NULL);
+    if (!HAL_Settings_Save(SYNC_KEY, &config, sizeof(config)))
+    {
+        ESP_LOGE(TAG, "Could not save the sync setting");
+    }
+    else if (config.nRole == SYNC_ROLE_NONE)
+    {
+        ESP_LOGI(TAG, "From the next boot: on our own");
+    }
+    else
+    {
+        ESP_LOGI(TAG, "From the next boot: %s over %s", config.nRole == SYNC_ROLE_LEADER ? "Leader" : "Follower",
+                 HAL_Sync_Transport((HAL_LINK)config.nLink)->pszName);
+    }
+}
+/**
+ * @brief Pass the event of this timer on to the followers.  Only the app
+ * task may call this, and only a leader's announcements go anywhere.
+ *
+ * @param nState APP_STATES of the app
+ * @param tStart Time the event started
+ * @param nSchedule Schedule the event runs
+ */
+void Sync_Announce(uint8_t nState, int64_t tStart, uint8_t nSchedule)
+{
+    EVENT event = {
+        .eType = EVENT_SYNC_ANNOUNCE,
+        .tTime = tStart,
+        .nParam = SYNC_PACK(nState, nSchedule),
+    };
+
+    if (syncData.config.nRole == SYNC_ROLE_LEADER && Event_Ring_Push(&syncData.ringAnnounce, &event))
+    {
+        HAL_Sync_Wake_Service();
+    }
+}
+/**
+ * @brief Get the next event the sync task has for the app.  Only the app
+ * task may call this.
+ *
+ * @param pEvent Where to put the event
+ * @return true An event was returned
+ * @return false No events are waiting
+ */
+bool Sync_Get_Event(EVENT *pEvent)
+{
+    return Event_Ring_Pop(&syncData.ringEvents, pEvent);
+}
+/**
+ * @brief Get the sync counters
+ *
+ * @return const SYNC_STATS* Counters and the clock estimate
+ */
+const SYNC_STATS *Sync_Get_Stats(void)
+{
+    return &syncData.stats;
+}
+/**
+ * @brief Log the sync counters
+ *
+ */
+void Sync_Log_Stats(void)
+{
+    const SYNC_STATS *pStats = &syncData.stats;
+
+    if (syncData.config.nRole == SYNC_ROLE_NONE)
+    {
+        return;
+    }
+    ESP_LOGI(TAG, "%lu requests, %lu replies, %lu slow, %lu stale, %lu bad, %lu announces, %lu adjusts, %lu jumps",
+             (unsigned long)pStats->nRequests, (unsigned long)pStats->nReplies,
+             (unsigned long)pStats->nSlow, (unsigned long)pStats->nStale, (unsigned long)pStats->nBad,
+             (unsigned long)pStats->nAnnounces, (unsigned long)pStats->nAdjusts, (unsigned long)pStats->nJumps);
+    ESP_LOGI(TAG, "Offset %lld us, drift %ld ppb, best round trip %ld us", (long long)pStats->tOffset,
+             (long)pStats->nSkewPPB, (long)pStats->tBestDelay);
+}
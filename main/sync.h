@@ -0,0 +1,155 @@
+/**
+ * @file sync.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Leader/follower clock sync between timers
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SYNC_H
+#define _SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "events.h"
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+#define SYNC_KEY "sync"                // Setting holding the SYNC_CONFIG
+#define SYNC_MAGIC 0x5943              // First bytes of every packet
+#define SYNC_VERSION 1                 // Layout of SYNC_PACKET
+#define SYNC_INTERVAL_US 1000000       // A locked follower asks the leader for the time this often
+#define SYNC_FAST_INTERVAL_US 125000   // A follower asks this often until it is locked
+#define SYNC_SAMPLES 32                // Exchanges the offset is filtered over
+#define SYNC_EARLY_SAMPLES 8           // Newest exchanges it is filtered over until the drift is known
+#define SYNC_MAX_DELAY_US 50000        // Exchanges with a longer round trip are thrown away
+#define SYNC_SKEW_INTERVAL_US 30000000 // The best exchange of each such period is a point of the drift fit
+#define SYNC_SKEW_POINTS 16            // Points the drift is fitted over, 8 minutes of them
+#define SYNC_SKEW_MIN_POINTS 3         // Points needed before the drift is fitted
+#define SYNC_SKEW_MAX_PPB 500000       // Most drift believed between two crystals, 500 ppm
+#define SYNC_JUMP_US 100000            // The leader's clock jumped, it rebooted, if it is off by more
+#define SYNC_LOST_US 10000000          // Leader is reported lost after this long without a reply
+#define SYNC_ADJUST_US 250             // Smallest move of the leader's start passed to the app
+#define SYNC_STEP_US 100000            // Moves bigger than this restart the event rather than slew it
+
+// Pack an app state and a schedule into an EVENT nParam
+#define SYNC_PACK(state, schedule) (((uint32_t)(schedule) << 8) | (uint8_t)(state))
+#define SYNC_STATE(packed) ((uint8_t)(packed))
+#define SYNC_SCHEDULE(packed) ((uint8_t)((packed) >> 8))
+
+  /**
+   * @brief Part this timer plays in the room
+   *
+   */
+  typedef enum
+  {
+    SYNC_ROLE_NONE,     // Runs on its own
+    SYNC_ROLE_LEADER,   // Its button starts the event for every timer
+    SYNC_ROLE_FOLLOWER, // Follows the leader's event and clock
+  } SYNC_ROLE;
+
+  /**
+   * @brief How the timer takes part in the sync, as it is stored
+   *
+   */
+  typedef struct
+  {
+    uint8_t nRole; // SYNC_ROLE
+    uint8_t nLink; // HAL_LINK to use
+  } SYNC_CONFIG;
+
+  /**
+   * @brief Kinds of packet
+   *
+   */
+  typedef enum
+  {
+    SYNC_MSG_REQUEST,  // Follower asks for the time
+    SYNC_MSG_REPLY,    // Leader answers a request, with its event
+    SYNC_MSG_ANNOUNCE, // Leader's event changed
+  } SYNC_MSG;
+
+  /**
+   * @brief Packet on the link.  Every timer runs the same firmware, so it is
+   * sent as it is laid out in memory.  The timestamps are those of an NTP
+   * exchange: the follower's clock at tOrigin and the packet's arrival, the
+   * leader's clock at tReceive and tTransmit.
+   *
+   */
+  typedef struct
+  {
+    uint16_t nMagic;      // SYNC_MAGIC
+    uint8_t nVersion;     // SYNC_VERSION
+    uint8_t eMsg;         // SYNC_MSG
+    uint8_t nState;       // Leader's APP_STATES
+    uint8_t nSchedule;    // Schedule the leader runs
+    uint16_t nReserved;   // Zero
+    uint32_t nGeneration; // Changes each time the leader's event changes
+    uint32_t nReserved2;  // Zero
+    int64_t tOrigin;      // Follower's time the request was sent
+    int64_t tReceive;     // Leader's time the request arrived
+    int64_t tTransmit;    // Leader's time the reply was sent
+    int64_t tStart;       // Leader's time its event started
+  } SYNC_PACKET;
+
+  /**
+   * @brief Counters and the state of the clock estimate
+   *
+   */
+  typedef struct
+  {
+    uint32_t nRequests;   // Requests sent by a follower
+    uint32_t nReplies;    // Replies sent by a leader, or taken by a follower
+    uint32_t nSlow;       // Replies thrown away for a round trip over SYNC_MAX_DELAY_US
+    uint32_t nStale;      // Replies to a request that was not the last one
+    uint32_t nBad;        // Packets of the wrong size, magic or version
+    uint32_t nAnnounces;  // Event changes sent or taken
+    uint32_t nAdjusts;    // Start times passed to the app
+    uint32_t nJumps;      // Times the leader's clock jumped and the estimate started over
+    int64_t tOffset;      // Leader's clock less ours, as last estimated
+    int32_t nSkewPPB;     // Leader's clock rate less ours, in parts per billion
+    int32_t tBestDelay;   // Round trip of the sample the offset came from
+  } SYNC_STATS;
+
+  extern bool Sync_Initialize(void);
+  extern SYNC_ROLE Sync_Role(void);
+  extern void Sync_Step_Config(void);
+  extern void Sync_Announce(uint8_t nState, int64_t tStart, uint8_t nSchedule);
+  extern int64_t Sync_Service(int64_t tNow);
+  extern bool Sync_Get_Event(EVENT *pEvent);
+  extern const SYNC_STATS *Sync_Get_Stats(void);
+  extern void Sync_Log_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SYNC_H */
@@ -0,0 +1,497 @@
+/**
+ * @file trace.c
+ * @author John Toebes (john@toebes.com)
+ * @brief Golden trace of the frames, DFPlayer commands and state changes
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "app.h"
+#include "trace.h"
+
+static const char *TAG = "trace";
+
+// Where the header fields are in a block
+#define TRACE_AT_MAGIC 0
+#define TRACE_AT_STREAM 1
+#define TRACE_AT_RECORDS 2
+#define TRACE_AT_USED 3
+#define TRACE_AT_BASE 4
+// Longest record: a time delta, a command and a parameter
+#define TRACE_RECORD_MAX (10 + 1 + 3)
+#define TRACE_BLOCKS (TRACE_FRAME_BLOCKS + TRACE_AUDIO_BLOCKS + TRACE_STATE_BLOCKS)
+
+/**
+ * @brief The ring of blocks of one stream.  Only the task that writes the
+ * stream touches it, except for a dump, which copies each block out.
+ *
+ */
+typedef struct
+{
+    TRACE_BLOCK *pBlocks; // Blocks of the stream, in traceData.aBlocks
+    int nBlocks;          // Number of blocks
+    int nCurrent;         // Block being filled
+    int nStored;          // Blocks holding records, the current one included
+    int64_t tLast;        // Time of the last record in the current block
+} TRACE_RING;
+
+typedef struct
+{
+    TRACE_BLOCK aBlocks[TRACE_BLOCKS]; // Storage for every stream
+    TRACE_RING aRings[TRACE_STREAMS];  // Blocks of each stream
+    TRACE_STATS stats;                 // Counters
+} TRACE_DATA;
+
+// The blocks are shared out between the streams from the start, so
+// tracing is safe even before Trace_Initialize
+static TRACE_DATA traceData = {
+    .aRings = {
+        {.pBlocks = &traceData.aBlocks[0], .nBlocks = TRACE_FRAME_BLOCKS},
+        {.pBlocks = &traceData.aBlocks[TRACE_FRAME_BLOCKS], .nBlocks = TRACE_AUDIO_BLOCKS},
+        {.pBlocks = &traceData.aBlocks[TRACE_FRAME_BLOCKS + TRACE_AUDIO_BLOCKS], .nBlocks = TRACE_STATE_BLOCKS},
+    },
+};
+static TRACE_SINK pfnTraceSink;
+
+/**
+ * @brief Forget everything traced
+ *
+ */
+void Trace_Initialize(void)
+{
+    memset(traceData.aBlocks, 0, sizeof(traceData.aBlocks));
+    memset(&traceData.stats, 0, sizeof(traceData.stats));
+    for (int nStream = 0; nStream < TRACE_STREAMS; nStream++)
+    {
+        traceData.aRings[nStream].nCurrent = 0;
+        traceData.aRings[nStream].nStored = 0;
+        traceData.aRings[nStream].tLast = 0;
+    }
+}
+/**
+ * @brief Have every block handed over as it fills up, for a recorder that
+ * keeps the whole trace
+ *
+ * @param pfnSink Called with each full block, NULL for none
+ */
+void Trace_Set_Sink(TRACE_SINK pfnSink)
+{
+    pfnTraceSink = pfnSink;
+}
+/**
+ * @brief Write a number as a varint, seven bits a byte from the lowest
+ *
+ * @param pOut Where to write it, up to 10 bytes
+ * @param nValue Number to write
+ * @return size_t Bytes written
+ */
+static size_t Trace_Put_Varint(uint8_t *pOut, uint64_t nValue)
+{
+    size_t nLength = 0;
+
+    while (nValue >= 0x80)
+    {
+        pOut[nLength++] = (uint8_t)(nValue | 0x80);
+        nValue >>= 7;
+    }
+    pOut[nLength++] = (uint8_t)nValue;
+    return nLength;
+}
+/**
+ * @brief Read a varint
+ *
+ * @param ppIn Where to read from, moved past it
+ * @param pEnd End of the bytes that can be read
+ * @param pnValue Returns the number
+ * @return true Read
+ * @return false It ran past pEnd or is too long
+ */
+static bool Trace_Get_Varint(const uint8_t **ppIn, const uint8_t *pEnd, uint64_t *pnValue)
+{
+    uint64_t nValue = 0;
+
+    for (int nShift = 0; *ppIn < pEnd && nShift < 64; nShift += 7)
+    {
+        uint8_t nByte = *(*ppIn)++;
+        nValue |= (uint64_t)(nByte & 0x7f) << nShift;
+        if (!(nByte & 0x80))
+        {
+            *pnValue = nValue;
+            return true;
+        }
+    }
+    return false;
+}
+/**
+ * @brief Hand the current block of a stream to the sink and move on to
+ * the next one, which is emptied
+ *
+ * @param pRing Stream to move on
+ */
+static void Trace_Next_Block(TRACE_RING *pRing)
+{
+    if (pfnTraceSink != NULL)
+    {
+        pfnTraceSink(&pRing->pBlocks[pRing->nCurrent]);
+    }
+    pRing->nCurrent = (pRing->nCurrent + 1) % pRing->nBlocks;
+    memset(&pRing->pBlocks[pRing->nCurrent], 0, sizeof(TRACE_BLOCK));
+}
+/**
+ * @brief Add a record to a stream, starting a new block when it does not
+ * fit in the current one.  The record count and bytes used are set last,
+ * so a dump never reads a record that is still being written.
+ *
+ * @param nStream Stream to add to
+ * @param tNow Time of the record
+ * @param pPayload What follows the time
+ * @param nPayload Bytes in pPayload
+ */
+static void Trace_Write(TRACE_STREAM nStream, int64_t tNow, const uint8_t *pPayload, size_t nPayload)
+{
+    TRACE_RING *pRing = &traceData.aRings[nStream];
+    TRACE_BLOCK *pBlock = &pRing->pBlocks[pRing->nCurrent];
+    uint8_t aRecord[TRACE_RECORD_MAX];
+    size_t nLength = 0;
+    size_t nUsed = pBlock->aBytes[TRACE_AT_USED];
+
+    if (nUsed != 0)
+    {
+        nLength = Trace_Put_Varint(aRecord, tNow > pRing->tLast ? (uint64_t)(tNow - pRing->tLast) : 0);
+        if (TRACE_HEADER_SIZE + nUsed + nLength + nPayload > TRACE_BLOCK_SIZE)
+        {
+            Trace_Next_Block(pRing);
+            pBlock = &pRing->pBlocks[pRing->nCurrent];
+            nUsed = 0;
+        }
+    }
+    if (nUsed == 0)
+    {
+        if (pRing->nStored < pRing->nBlocks)
+        {
+            pRing->nStored++;
+        }
+        else
+        {
+            traceData.stats.anBlocksReused[nStream]++;
+        }
+        pBlock->aBytes[TRACE_AT_MAGIC] = TRACE_MAGIC;
+        pBlock->aBytes[TRACE_AT_STREAM] = (uint8_t)nStream;
+        for (int n = 0; n < 8; n++)
+        {
+            pBlock->aBytes[TRACE_AT_BASE + n] = (uint8_t)((uint64_t)tNow >> (8 * n));
+        }
+        nLength = Trace_Put_Varint(aRecord, 0);
+    }
+    memcpy(&aRecord[nLength], pPayload, nPayload);
+    nLength += nPayload;
+    memcpy(&pBlock->aBytes[TRACE_HEADER_SIZE + nUsed], aRecord, nLength);
+    pBlock->aBytes[TRACE_AT_RECORDS]++;
+    pBlock->aBytes[TRACE_AT_USED] = (uint8_t)(nUsed + nLength);
+    pRing->tLast = tNow;
+    traceData.stats.anRecords[nStream]++;
+}
+/**
+ * @brief Trace a frame sent to the LEDs as a hash of every LED.  Only the
+ * render task may call this.
+ *
+ * @param tNow Time the frame was sent
+ * @param aColors Color (0x00RRGGBB) of every LED
+ * @param nLeds Number of LEDs
+ */
+void Trace_Frame(int64_t tNow, const uint32_t *aColors, int nLeds)
+{
+    // FNV-1a over the red, green and blue of each LED
+    uint32_t nHash = 2166136261u;
+    uint8_t aPayload[4];
+
+    for (int nLed = 0; nLed < nLeds; nLed++)
+    {
+        nHash = (nHash ^ RGB_GET_R(aColors[nLed])) * 16777619u;
+        nHash = (nHash ^ RGB_GET_G(aColors[nLed])) * 16777619u;
+        nHash = (nHash ^ RGB_GET_B(aColors[nLed])) * 16777619u;
+    }
+    for (int n = 0; n < 4; n++)
+    {
+        aPayload[n] = (uint8_t)(nHash >> (8 * n));
+    }
+    Trace_Write(TRACE_STREAM_FRAME, tNow, aPayload, sizeof(aPayload));
+}
+/**
+ * @brief Trace a command written to the DFPlayer.  Only the audio task may
+ * call this.
+ *
+ * @param tNow Time the command was written
+ * @param nCommand DFPlayer command
+ * @param nParam Its parameter
+ */
+void Trace_Audio(int64_t tNow, uint8_t nCommand, uint16_t nParam)
+{
+    uint8_t aPayload[1 + 3];
+
+    aPayload[0] = nCommand;
+    Trace_Write(TRACE_STREAM_AUDIO, tNow, aPayload, 1 + Trace_Put_Varint(&aPayload[1], nParam));
+}
+/**
+ * @brief Trace a change of the app state.  Only the app task may call this.
+ *
+ * @param tNow Time of the change
+ * @param nState State changed to
+ */
+void Trace_State(int64_t tNow, uint8_t nState)
+{
+    Trace_Write(TRACE_STREAM_STATE, tNow, &nState, 1);
+}
+/**
+ * @brief Hand the partly filled block of every stream to the sink, so a
+ * recorder has everything traced so far.  Only call this when no other
+ * task is tracing.
+ *
+ */
+void Trace_Flush(void)
+{
+    for (int nStream = 0; nStream < TRACE_STREAMS; nStream++)
+    {
+        TRACE_RING *pRing = &traceData.aRings[nStream];
+
+        if (pRing->pBlocks[pRing->nCurrent].aBytes[TRACE_AT_USED] != 0)
+        {
+            Trace_Next_Block(pRing);
+        }
+    }
+}
+/**
+ * @brief Write every block held, oldest first, to the console as
+ * TRACE_PREFIX lines for trace_diff.  Each block is copied before it is
+ * written, so the other tasks can carry on tracing.
+ *
+ */
+void Trace_Dump(void)
+{
+    static const char acHex[] = "0123456789abcdef";
+    char szLine[TRACE_LINE_MAX];
+
+    for (int nStream = 0; nStream < TRACE_STREAMS; nStream++)
+    {
+        const TRACE_RING *pRing = &traceData.aRings[nStream];
+        int nBlock = (pRing->nCurrent - pRing->nStored + 1 + pRing->nBlocks) % pRing->nBlocks;
+
+        for (int n = 0; n < pRing->nStored; n++, nBlock = (nBlock + 1) % pRing->nBlocks)
+        {
+            TRACE_BLOCK block = pRing->pBlocks[nBlock];
+            size_t nBytes = TRACE_HEADER_SIZE + block.aBytes[TRACE_AT_USED];
+            size_t nLength = sizeof(TRACE_PREFIX) - 1;
+
+            if (block.aBytes[TRACE_AT_USED] == 0 || nBytes > TRACE_BLOCK_SIZE)
+            {
+                continue;
+            }
+            memcpy(szLine, TRACE_PREFIX, nLength);
+            for (size_t nByte = 0; nByte < nBytes; nByte++)
+            {
+                szLine[nLength++] = acHex[block.aBytes[nByte] >> 4];
+                szLine[nLength++] = acHex[block.aBytes[nByte] & 0x0f];
+            }
+            szLine[nLength] = '\0';
+            HAL_Console_Write(szLine);
+        }
+    }
+    Trace_Log_Stats();
+}
+/**
+ * @brief Decode the records of a block
+ *
+ * @param pBlock Block to decode
+ * @param aRecords Where to put the records
+ * @param nMax Room in aRecords, TRACE_BLOCK_RECORDS is always enough
+ * @return int Number of records, -1 when the block is not valid
+ */
+int Trace_Decode(const TRACE_BLOCK *pBlock, TRACE_RECORD *aRecords, int nMax)
+{
+    const uint8_t *pIn = &pBlock->aBytes[TRACE_HEADER_SIZE];
+    const uint8_t *pEnd = pIn + pBlock->aBytes[TRACE_AT_USED];
+    uint8_t nStream = pBlock->aBytes[TRACE_AT_STREAM];
+    int64_t tTime = 0;
+    int nRecords = 0;
+
+    if (pBlock->aBytes[TRACE_AT_MAGIC] != TRACE_MAGIC || nStream >= TRACE_STREAMS ||
+        pBlock->aBytes[TRACE_AT_USED] > TRACE_BLOCK_DATA)
+    {
+        return -1;
+    }
+    for (int n = 0; n < 8; n++)
+    {
+        tTime |= (int64_t)pBlock->aBytes[TRACE_AT_BASE + n] << (8 * n);
+    }
+    while (pIn < pEnd && nRecords < nMax)
+    {
+        TRACE_RECORD *pRecord = &aRecords[nRecords];
+        uint64_t nValue;
+
+        if (!Trace_Get_Varint(&pIn, pEnd, &nValue))
+        {
+            return -1;
+        }
+        tTime += (int64_t)nValue;
+        memset(pRecord, 0, sizeof(*pRecord));
+        pRecord->tTime = tTime;
+        pRecord->nStream = nStream;
+        switch (nStream)
+        {
+        case TRACE_STREAM_FRAME:
+            if (pEnd - pIn < 4)
+            {
+                return -1;
+            }
+            pRecord->nValue = pIn[0] | (pIn[1] << 8) | (pIn[2] << 16) | ((uint32_t)pIn[3] << 24);
+            pIn += 4;
+            break;
+        case TRACE_STREAM_AUDIO:
+            if (pIn >= pEnd)
+            {
+                return -1;
+            }
+            pRecord->nCode = *pIn++;
+            if (!Trace_Get_Varint(&pIn, pEnd, &nValue))
+            {
+                return -1;
+            }
+            pRecord->nValue = (uint32_t)nValue;
+            break;
+        default:
+            if (pIn >= pEnd)
+            {
+                return -1;
+            }
+            pRecord->nCode = *pIn++;
+            break;
+        }
+        nRecords++;
+    }
+    return nRecords == pBlock->aBytes[TRACE_AT_RECORDS] ? nRecords : -1;
+}
+/**
+ * @brief Get the value of a hex digit
+ *
+ * @param ch Character to convert
+ * @return int Value 0-15, -1 if it is not a hex digit
+ */
+static int Trace_Hex_Value(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+    {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f')
+    {
+        return ch - 'a' + 10;
+    }
+    if (ch >= 'A' && ch <= 'F')
+    {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+/**
+ * @brief Read a block back from a line written by Trace_Dump, which may
+ * have a timestamp or the tail of other output in front of it
+ *
+ * @param pszLine Console line
+ * @param pBlock Returns the block, the unused bytes zeroed
+ * @return true The line held a block
+ * @return false It is some other line
+ */
+bool Trace_Parse_Line(const char *pszLine, TRACE_BLOCK *pBlock)
+{
+    size_t nBytes = 0;
+    const char *pch;
+
+    pch = strstr(pszLine, TRACE_PREFIX);
+    if (pch == NULL)
+    {
+        return false;
+    }
+    memset(pBlock, 0, sizeof(*pBlock));
+    for (pch += sizeof(TRACE_PREFIX) - 1; nBytes < TRACE_BLOCK_SIZE; pch += 2)
+    {
+        int nHigh = Trace_Hex_Value(pch[0]);
+        int nLow = nHigh < 0 ? -1 : Trace_Hex_Value(pch[1]);
+        if (nLow < 0)
+        {
+            break;
+        }
+        pBlock->aBytes[nBytes++] = (uint8_t)((nHigh << 4) | nLow);
+    }
+    return nBytes >= TRACE_HEADER_SIZE && nBytes == (size_t)(TRACE_HEADER_SIZE + pBlock->aBytes[TRACE_AT_USED]) &&
+           (*pch == '\0' || *pch == '\r' || *pch == '\n');
+}
+/**
+ * @brief Format a record as text
+ *
+ * @param pRecord Record to format
+ * @param pszText Where to put the text
+ * @param nMax Size of pszText, TRACE_TEXT_MAX is always enough
+ * @return int Length of the text, as snprintf
+ */
+int Trace_Format(const TRACE_RECORD *pRecord, char *pszText, size_t nMax)
+{
+    double dTime = pRecord->tTime / 1000000.0;
+
+    switch (pRecord->nStream)
+    {
+    case TRACE_STREAM_FRAME:
+        return snprintf(pszText, nMax, "%10.6f frame %08lx", dTime, (unsigned long)pRecord->nValue);
+    case TRACE_STREAM_AUDIO:
+        return snprintf(pszText, nMax, "%10.6f dfplayer cmd=%02x param=%lu", dTime, pRecord->nCode,
+                        (unsigned long)pRecord->nValue);
+    default:
+        return snprintf(pszText, nMax, "%10.6f state %u", dTime, pRecord->nCode);
+    }
+}
+/**
+ * @brief Get the counters kept by the trace
+ *
+ * @return const TRACE_STATS* Counters
+ */
+const TRACE_STATS *Trace_Get_Stats(void)
+{
+    return &traceData.stats;
+}
+/**
+ * @brief Report what has been traced
+ *
+ */
+void Trace_Log_Stats(void)
+{
+    ESP_LOGI(TAG, "%lu frames, %lu commands, %lu state changes traced, %lu blocks reused",
+             (unsigned long)traceData.stats.anRecords[TRACE_STREAM_FRAME],
+             (unsigned long)traceData.stats.anRecords[TRACE_STREAM_AUDIO],
+             (unsigned long)traceData.stats.anRecords[TRACE_STREAM_STATE],
+             (unsigned long)(traceData.stats.anBlocksReused[TRACE_STREAM_FRAME] +
+                             traceData.stats.anBlocksReused[TRACE_STREAM_AUDIO] +
+                             traceData.stats.anBlocksReused[TRACE_STREAM_STATE]));
+}
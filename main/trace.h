@@ -0,0 +1,138 @@
+/**
+ * @file trace.h
+ * @author John Toebes (john@toebes.com)
+ * @brief Golden trace of the frames, DFPlayer commands and state changes
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright
+ * Copyright (c) 2025 John A. Toebes
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus // Provide C++ Compatibility
+
+extern "C"
+{
+#endif
+// A block is a header and the records after it, always this many bytes
+#define TRACE_BLOCK_SIZE 128
+#define TRACE_HEADER_SIZE 12
+#define TRACE_BLOCK_DATA (TRACE_BLOCK_SIZE - TRACE_HEADER_SIZE)
+// First byte of every block
+#define TRACE_MAGIC 0xa5
+// Blocks kept for each stream, the oldest is reused once they are full.
+// A whole 50 minute event takes about 64 blocks of frames.
+#define TRACE_FRAME_BLOCKS 72
+#define TRACE_AUDIO_BLOCKS 4
+#define TRACE_STATE_BLOCKS 4
+// Most records a block can hold, two bytes each at the least
+#define TRACE_BLOCK_RECORDS (TRACE_BLOCK_DATA / 2)
+// Start of a dumped block on the console, followed by the block in hex
+#define TRACE_PREFIX "TRACE "
+#define TRACE_LINE_MAX (sizeof(TRACE_PREFIX) + 2 * TRACE_BLOCK_SIZE)
+// Longest formatted record
+#define TRACE_TEXT_MAX 64
+
+  /**
+   * @brief What is traced.  Each stream is written by one task, so they
+   * are kept and compared apart.
+   *
+   */
+  typedef enum
+  {
+    TRACE_STREAM_FRAME, // Frames sent to the LEDs, by the render task
+    TRACE_STREAM_AUDIO, // Commands sent to the DFPlayer, by the audio task
+    TRACE_STREAM_STATE, // State changes, by the app task
+    TRACE_STREAMS,      // Number of streams
+  } TRACE_STREAM;
+
+  /**
+   * @brief One decoded record
+   *
+   */
+  typedef struct
+  {
+    int64_t tTime;   // HAL_Get_Time when it was traced
+    uint8_t nStream; // TRACE_STREAM it came from
+    uint8_t nCode;   // DFPlayer command or APP_STATES, 0 for a frame
+    uint32_t nValue; // Hash of a frame or parameter of a command
+  } TRACE_RECORD;
+
+  /**
+   * @brief A block of one stream as stored, dumped and written to a trace
+   * file.  The header is the magic, the stream, the record count, the
+   * bytes of records used and the time of the first record as a little
+   * endian int64.  Each record is the time since the record before as a
+   * varint, then a frame hash (4 bytes, little endian), a DFPlayer command
+   * byte and its parameter as a varint, or a state byte.
+   *
+   */
+  typedef struct
+  {
+    uint8_t aBytes[TRACE_BLOCK_SIZE]; // Header then records
+  } TRACE_BLOCK;
+
+  /**
+   * @brief Counters kept by the trace
+   *
+   */
+  typedef struct
+  {
+    uint32_t anRecords[TRACE_STREAMS];      // Records written to each stream
+    uint32_t anBlocksReused[TRACE_STREAMS]; // Oldest blocks given up to make room
+  } TRACE_STATS;
+
+  /**
+   * @brief Called with each block of a stream as it fills up
+   *
+   * @param pBlock Block that is complete
+   */
+  typedef void (*TRACE_SINK)(const TRACE_BLOCK *pBlock);
+
+  extern void Trace_Initialize(void);
+  extern void Trace_Set_Sink(TRACE_SINK pfnSink);
+  extern void Trace_Frame(int64_t tNow, const uint32_t *aColors, int nLeds);
+  extern void Trace_Audio(int64_t tNow, uint8_t nCommand, uint16_t nParam);
+  extern void Trace_State(int64_t tNow, uint8_t nState);
+  extern void Trace_Flush(void);
+  extern void Trace_Dump(void);
+  extern int Trace_Decode(const TRACE_BLOCK *pBlock, TRACE_RECORD *aRecords, int nMax);
+  extern bool Trace_Parse_Line(const char *pszLine, TRACE_BLOCK *pBlock);
+  extern int Trace_Format(const TRACE_RECORD *pRecord, char *pszText, size_t nMax);
+  extern const TRACE_STATS *Trace_Get_Stats(void);
+  extern void Trace_Log_Stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TRACE_H */